@@ -0,0 +1,73 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace p2p {
+
+// Spreads incoming TCP connections over several threads. Each thread runs its
+// own io_context with its own acceptor, all bound to one port with
+// SO_REUSEPORT, so the kernel balances new connections between them and each
+// connection's handshake runs on the thread that accepted it. Where
+// SO_REUSEPORT isn't available a single acceptor is used.
+class AcceptorPool {
+public:
+    // Called on the accepting thread; the socket belongs to that thread's io_context
+    using AcceptHandler = std::function<void(boost::asio::ip::tcp::socket socket)>;
+
+    explicit AcceptorPool(size_t acceptorCount = GetDefaultAcceptorCount());
+    ~AcceptorPool();
+
+    AcceptorPool(const AcceptorPool&) = delete;
+    AcceptorPool& operator=(const AcceptorPool&) = delete;
+
+    // Binds every acceptor to the port (0 picks a free one) on every interface
+    // and starts accepting. Throws boost::system::system_error if the port
+    // can't be bound.
+    void Start(uint16_t port, AcceptHandler handler);
+    // The same, on one local address
+    void Start(const boost::asio::ip::tcp::endpoint& local, AcceptHandler handler);
+    // Stops accepting and stops the io_contexts, ending any sessions on them
+    void Stop();
+
+    uint16_t GetPort() const { return port_; }
+    size_t GetAcceptorCount() const { return acceptors_.size(); }
+    uint64_t GetAcceptedCount(size_t acceptor) const;
+    // Failed accepts over every acceptor, e.g. out of file descriptors
+    uint64_t GetAcceptErrorCount() const;
+
+    static bool IsReusePortSupported();
+    static size_t GetDefaultAcceptorCount();
+
+private:
+    struct Acceptor {
+        boost::asio::io_context context{1};
+        boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work{context.get_executor()};
+        boost::asio::ip::tcp::acceptor acceptor{context};
+        boost::asio::steady_timer retry{context}; // Holds off accepting after an error
+        std::thread thread;
+        std::atomic<uint64_t> accepted{0};
+        std::atomic<uint64_t> errors{0};
+    };
+
+    // No address for every interface
+    void Start(const std::optional<boost::asio::ip::address>& address, uint16_t port, AcceptHandler handler);
+    void Accept(Acceptor& acceptor);
+
+    std::vector<std::unique_ptr<Acceptor>> acceptors_;
+    AcceptHandler handler_;
+    uint16_t port_ = 0;
+    bool running_ = false;
+};
+
+} // namespace p2p
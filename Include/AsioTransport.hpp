@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Transport.hpp"
+#include "AcceptorPool.hpp"
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace p2p {
+
+// Transport over plain TCP with Boost.Asio. Each frame goes on the wire behind
+// a 4-byte big-endian length. Each Listen() gets an AcceptorPool, and an
+// incoming connection lives on the acceptor thread that took it, so accepts
+// and reads spread over cores; outgoing ones share one I/O thread. Sends from
+// other threads are queued to the connection's thread, and frames queued
+// together go out in one write. Endpoints are tcp://host:port (IPv6 hosts in
+// brackets), with * to listen on every interface, dual-stack where the host
+// has IPv6. Connects resolve and dial in the background; frames sent
+// meanwhile go out once the connection is up.
+class AsioTransport final : public Transport {
+public:
+    explicit AsioTransport(size_t acceptorCount = AcceptorPool::GetDefaultAcceptorCount());
+    ~AsioTransport() override;
+
+    AsioTransport(const AsioTransport&) = delete;
+    AsioTransport& operator=(const AsioTransport&) = delete;
+
+    // Throws std::invalid_argument for a malformed endpoint, or
+    // boost::system::system_error if it can't be bound
+    void Listen(const std::string& endpoint) override;
+    // kNoConnection for a malformed endpoint; one that can't be reached
+    // is reported closed to the connection handler
+    ConnectionId Connect(const std::string& endpoint) override;
+    // False, dropping the frame, once the connection has more than
+    // GetMaxQueuedBytes() waiting behind the write on the wire
+    bool Send(ConnectionId connection, std::span<const uint8_t> frame) override;
+    void Close(ConnectionId connection) override;
+    // Joins the acceptor threads, so not from a handler
+    void Stop() override;
+
+    // The port the last Listen() bound, for listening on port 0
+    uint16_t GetListenPort() const { return listenPort_; }
+
+    // Bounds what a peer that stops reading can pile up. Set before Listen() or Connect().
+    void SetMaxQueuedBytes(size_t bytes) { maxQueuedBytes_ = bytes; }
+    size_t GetMaxQueuedBytes() const { return maxQueuedBytes_; }
+
+private:
+    struct Session;
+
+    ConnectionId AddSession(const std::shared_ptr<Session>& session);
+    // On the acceptor thread that took the connection, which then runs it
+    void Accepted(boost::asio::ip::tcp::socket socket);
+    void Opened(const std::shared_ptr<Session>& session);
+    void Read(const std::shared_ptr<Session>& session);
+    void Write(const std::shared_ptr<Session>& session);
+    // I/O thread only. Closes the socket, and tells the handler unless the
+    // connection was already closed from our side.
+    void Drop(const std::shared_ptr<Session>& session);
+    // Runs the task on the I/O thread and waits for it, rethrowing what it throws
+    void RunOnIoThread(const std::function<void()>& task);
+
+    boost::asio::io_context context_{1};
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_{context_.get_executor()};
+    size_t acceptorCount_;
+    std::mutex poolsMutex_;
+    std::vector<std::unique_ptr<AcceptorPool>> pools_; // One per Listen()
+    std::mutex sessionsMutex_;
+    std::unordered_map<ConnectionId, std::shared_ptr<Session>> sessions_;
+    ConnectionId nextConnection_ = 0; // Never reused, so a stale ID can't reach a new peer
+    std::atomic<uint16_t> listenPort_{0};
+    size_t maxQueuedBytes_ = 64 * 1024 * 1024;
+    std::thread thread_;
+};
+
+} // namespace p2p
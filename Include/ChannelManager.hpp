@@ -0,0 +1,50 @@
+#pragma once
+
+#include "PeerHandle.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <optional>
+#include <mutex>
+#include <cstdint>
+
+namespace p2p {
+
+using ChannelId = uint32_t;
+
+class ChannelManager {
+public:
+    ChannelManager();
+    ~ChannelManager();
+
+    static ChannelId GetChannelId(const std::string& name);
+    static bool IsValidChannelName(const std::string& name);
+
+    // Local membership
+    bool Join(const std::string& name);
+    bool Part(const std::string& name);
+    bool IsJoined(ChannelId channelId) const;
+    std::vector<std::string> GetJoinedChannels() const;
+
+    // Remote membership, learned from CHANNEL_JOIN/CHANNEL_PART announcements
+    void AddMember(const std::string& name, PeerHandle peer);
+    void RemoveMember(const std::string& name, PeerHandle peer);
+    void RemovePeer(PeerHandle peer);
+
+    std::vector<PeerHandle> GetMembers(ChannelId channelId) const;
+    std::optional<std::string> GetChannelName(ChannelId channelId) const;
+
+private:
+    struct Channel {
+        std::string name;
+        bool joined = false;
+        std::vector<PeerHandle> members; // Sorted, unique
+    };
+
+    void EraseIfUnused(ChannelId channelId);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<ChannelId, Channel> channels_;
+};
+
+} // namespace p2p
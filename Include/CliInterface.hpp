@@ -1,5 +1,6 @@
 #pragma once
 
+#include "PeerHandle.hpp"
 #include <string>
 #include <memory>
 #include <functional>
@@ -22,6 +23,9 @@ public:
     void Stop();
 
     void DisplayMessage(const std::string& peerId, const std::string& message, bool incoming = true);
+    void DisplayMessage(PeerHandle peer, const std::string& message, bool incoming = true);
+    void DisplayChannelMessage(const std::string& channel, const std::string& peerId,
+                               const std::string& message, bool incoming = true);
     void DisplaySystemMessage(const std::string& message);
     void DisplayError(const std::string& error);
     void DisplaySuccess(const std::string& message);
@@ -40,6 +44,12 @@ private:
     void HandleHelp(const std::vector<std::string>& args);
     void HandleQuit(const std::vector<std::string>& args);
     void HandleInfo(const std::vector<std::string>& args);
+    void HandleJoin(const std::vector<std::string>& args);
+    void HandlePart(const std::vector<std::string>& args);
+    void HandleChannels(const std::vector<std::string>& args);
+    void HandleRelay(const std::vector<std::string>& args);
+
+    void SendChannelText(const std::string& channel, const std::string& text);
 
     struct Impl;
     std::unique_ptr<Impl> pImpl_;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <array>
@@ -8,6 +9,8 @@
 
 namespace p2p {
 
+class Executor;
+
 class CryptoManager {
 public:
     CryptoManager();
@@ -33,6 +36,24 @@ public:
                 const std::vector<uint8_t>& signature,
                 const std::vector<uint8_t>& publicKey);
     
+    struct VerifyRequest {
+        const std::vector<uint8_t>& data;
+        const std::vector<uint8_t>& signature;
+        const std::vector<uint8_t>& publicKey;
+    };
+    
+    // Verifies the requests in parallel on the executor; result[i] is 1 if
+    // request i carries a valid signature
+    std::vector<uint8_t> VerifyBatch(const std::vector<VerifyRequest>& requests, Executor& executor);
+    
+    // Cryptographically secure random bytes, for nonces; empty on failure
+    std::vector<uint8_t> RandomBytes(size_t count);
+    
+    // HKDF-SHA256 of the secret, so one node key can seed keys for other uses
+    // without them revealing it or each other; empty on failure
+    std::vector<uint8_t> DeriveKey(const std::vector<uint8_t>& secret, std::string_view context,
+                                   size_t length = 32);
+    
     std::string GeneratePeerId(const std::vector<uint8_t>& publicKey);
     
     std::array<uint8_t, 32> DeriveSharedSecret(const std::vector<uint8_t>& privateKey,
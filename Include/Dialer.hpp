@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ResolverCache.hpp"
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+namespace p2p {
+
+// Finds the quickest way to a host: its name comes from a resolver cache,
+// then TCP connects race across its addresses, happy-eyeballs style
+// (RFC 8305). IPv6 and IPv4 addresses take turns, and each attempt starts a
+// short delay after the last or as soon as it fails. The first to connect
+// wins and the rest are abandoned. The winning socket is only a probe and is
+// closed; the caller dials the winning address for real. One I/O thread runs
+// every dial, so any number can be under way at once.
+class Dialer {
+public:
+    // The winning address as a literal IP, or the error if none connected
+    using Callback = std::function<void(const std::string& address, std::exception_ptr error)>;
+
+    explicit Dialer(ResolverCache::Lookup lookup = ResolverCache::SystemLookup,
+                    size_t lookupThreads = ResolverCache::kDefaultThreads);
+    ~Dialer();
+
+    Dialer(const Dialer&) = delete;
+    Dialer& operator=(const Dialer&) = delete;
+
+    // Calls back on the I/O thread. Dials still under way when the Dialer
+    // is destroyed never call back.
+    void Dial(const std::string& host, uint16_t port, Callback callback);
+
+    // Wait before trying the next address while earlier ones are still
+    // connecting; RFC 8305 suggests 250 ms. Set before the first Dial().
+    void SetAttemptDelay(std::chrono::milliseconds delay) { attemptDelay_ = delay; }
+    // Time a dial gets once its addresses are known. Set before the first Dial().
+    void SetTimeout(std::chrono::milliseconds timeout) { timeout_ = timeout; }
+
+    ResolverCache& GetResolver() { return *resolver_; }
+
+    // Alternates address families, starting with the first address's and
+    // keeping each family's own order
+    static std::vector<std::string> Interleave(const std::vector<std::string>& addresses);
+
+private:
+    struct Race;
+
+    void Begin(const std::shared_ptr<Race>& race, const ResolverCache::Addresses& addresses);
+    void Attempt(const std::shared_ptr<Race>& race);
+    void Finish(const std::shared_ptr<Race>& race, const std::string& address, std::exception_ptr error);
+
+    boost::asio::io_context context_{1};
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_{context_.get_executor()};
+    std::unique_ptr<ResolverCache> resolver_;
+    std::chrono::milliseconds attemptDelay_{250};
+    std::chrono::milliseconds timeout_{5000};
+    std::thread thread_;
+};
+
+} // namespace p2p
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <compare>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace p2p {
+
+// An IP address and port in 18 bytes. IPv4 addresses are held IPv4-mapped
+// (::ffff:a.b.c.d), so both families compare, hash and sort alike. Peer
+// tables keep these rather than address strings; text is only made for
+// display, persistence and the zmq endpoint being dialled.
+class Endpoint {
+public:
+    using Address = std::array<uint8_t, 16>;
+
+    Endpoint() = default;
+    // The unspecified address (::), as for a node's own listener
+    explicit Endpoint(uint16_t port) : port_(port) {}
+    Endpoint(const Address& address, uint16_t port) : address_(address), port_(port) {}
+
+    // From an IPv4 address in host byte order
+    static Endpoint FromIpv4(uint32_t address, uint16_t port);
+    static Endpoint Loopback(uint16_t port) { return FromIpv4(0x7F000001, port); }
+    // A literal IPv4 or IPv6 address, the latter optionally in brackets;
+    // nullopt for anything else, host names included
+    static std::optional<Endpoint> FromAddress(std::string_view address, uint16_t port);
+    // "address:port" or "[ipv6]:port", optionally behind tcp://
+    static std::optional<Endpoint> Parse(std::string_view text);
+
+    const Address& GetAddress() const { return address_; }
+    uint16_t GetPort() const { return port_; }
+    bool IsIpv4() const;
+    bool IsLoopback() const;
+    // :: or 0.0.0.0
+    bool IsUnspecified() const;
+
+    // "10.0.0.1" or "::1"
+    std::string AddressString() const;
+    // "10.0.0.1:80" or "[::1]:80"
+    std::string ToString() const;
+
+    friend auto operator<=>(const Endpoint&, const Endpoint&) = default;
+
+private:
+    Address address_{};
+    uint16_t port_ = 0;
+};
+
+static_assert(sizeof(Endpoint) == 18, "Endpoint is meant to pack into 18 bytes");
+
+struct EndpointHash {
+    size_t operator()(const Endpoint& endpoint) const noexcept;
+};
+
+} // namespace p2p
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace p2p {
+
+// Work-stealing task scheduler shared by handler dispatch and batch crypto.
+// Each worker owns a Chase-Lev deque: tasks it submits go to the bottom and
+// it pops them LIFO, while idle workers steal FIFO from the top. Tasks from
+// other threads enter through a shared FIFO queue. With pinning enabled,
+// workers are bound to CPUs grouped by NUMA node and steal from workers on
+// their own node first.
+class Executor {
+public:
+    using Task = std::function<void()>;
+
+    Executor();
+    explicit Executor(size_t workerCount, bool pinThreads = false);
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    void Start();
+    // Runs every queued task, including ones they submit, then joins the workers
+    void Stop();
+
+    // From a worker, queues on that worker's own deque; otherwise on the
+    // shared queue. Tasks submitted before Start() wait for it.
+    void Submit(Task task);
+    // Always queues on the shared FIFO, behind work already waiting; for
+    // tasks that yield to let other work run
+    void Defer(Task task);
+
+    // Calls body(0..count-1) across the workers and returns once all calls
+    // have. The caller runs indices too, so it's safe to call from a task.
+    // The first exception thrown by body is rethrown here.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    size_t GetWorkerCount() const { return workerCount_; }
+    uint64_t GetStealCount() const { return steals_.load(std::memory_order_relaxed); }
+    bool IsWorkerThread() const;
+
+    static size_t GetDefaultWorkerCount();
+
+private:
+    class Worker;
+
+    void RunWorker(Worker& worker);
+    Task* FindTask(Worker& worker);
+    Task* TakeShared();
+    Task* Steal(Worker& thief);
+    void Enqueue(Task* task, bool shared);
+    void WakeOne();
+    void Pin(Worker& worker);
+
+    size_t workerCount_;
+    bool pinThreads_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> running_{false};
+
+    std::mutex sharedMutex_;
+    std::deque<Task*> sharedQueue_;
+    std::atomic<size_t> sharedSize_{0}; // Lets idle workers skip the lock
+
+    // Queued tasks not yet taken by a worker; workers park when it reaches 0
+    std::atomic<int64_t> queued_{0};
+    std::atomic<int> sleepers_{0};
+    std::mutex parkMutex_;
+    std::condition_variable parked_;
+
+    std::atomic<uint64_t> steals_{0};
+};
+
+} // namespace p2p
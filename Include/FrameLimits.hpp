@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Message.hpp"
+#include <array>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+namespace p2p {
+
+// Size limits for received frames: one for the whole frame, which the
+// transport enforces before reading it in, and one per message type on the
+// payload, checked on the header before anything is decoded. Control
+// messages get tight defaults; bulk types are bounded only by the frame limit.
+class FrameLimits {
+public:
+    static constexpr size_t kDefaultMaxFrameSize = 16 * 1024 * 1024;
+
+    explicit FrameLimits(size_t maxFrameSize = kDefaultMaxFrameSize);
+
+    void SetMaxFrameSize(size_t bytes);
+    size_t GetMaxFrameSize() const { return maxFrameSize_; }
+
+    // Never more than the frame limit allows, whatever is set here
+    void SetMaxPayloadSize(MessageType type, size_t bytes);
+    size_t GetMaxPayloadSize(MessageType type) const;
+
+    // The frame's header, if the frame is exactly header plus declared payload
+    // and the payload is within its type's limit
+    std::optional<Message::Header> Validate(const uint8_t* data, size_t size) const;
+
+private:
+    size_t maxFrameSize_;
+    std::array<uint32_t, 256> maxPayload_; // Indexed by the message type byte
+};
+
+} // namespace p2p
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Message.hpp"
+#include "PeerHandle.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace p2p {
+
+class Executor;
+
+// Runs message handlers off the network I/O threads. Every peer has a
+// mailbox; a peer's messages are handled one at a time in arrival order,
+// while different peers' mailboxes are drained in parallel on an Executor.
+class HandlerPool {
+public:
+    using Handler = std::function<void(PeerHandle, const Message&)>;
+
+    // Messages a worker takes from one mailbox before yielding to other peers
+    static constexpr size_t kMailboxBatch = 32;
+
+    // Runs handlers on a private executor with workerCount threads
+    explicit HandlerPool(Handler handler, size_t workerCount = GetDefaultWorkerCount());
+    // Runs handlers on a shared executor, which must be started separately
+    // and outlive the pool
+    HandlerPool(Handler handler, Executor& executor);
+    ~HandlerPool();
+
+    HandlerPool(const HandlerPool&) = delete;
+    HandlerPool& operator=(const HandlerPool&) = delete;
+
+    void Start();
+    // Waits for everything already posted to be handled
+    void Stop();
+
+    // Copies the message, so arena-backed payloads may be posted
+    void Post(PeerHandle peer, const Message& msg);
+    // Takes the payload's storage as it is; not for arena-backed messages
+    void Post(PeerHandle peer, Message&& msg);
+
+    size_t GetWorkerCount() const;
+    size_t GetPendingCount() const;
+
+    static size_t GetDefaultWorkerCount();
+
+private:
+    struct Mailbox {
+        std::deque<Message> messages;
+        bool scheduled = false; // A drain task is queued or running
+    };
+
+    void Enqueue(PeerHandle peer, Message&& msg);
+    void Drain(uint32_t index);
+
+    Handler handler_;
+    std::unique_ptr<Executor> ownedExecutor_;
+    Executor* executor_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable idle_;
+    std::vector<Mailbox> mailboxes_; // Indexed by PeerHandle
+    std::vector<uint32_t> waiting_;  // Scheduled before Start()
+    size_t pending_ = 0;
+    bool running_ = false;
+};
+
+} // namespace p2p
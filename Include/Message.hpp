@@ -1,9 +1,14 @@
 #pragma once
 
+#include "Payload.hpp"
 #include <string>
 #include <vector>
 #include <chrono>
 #include <variant>
+#include <optional>
+#include <string_view>
+#include <span>
+#include <memory_resource>
 #include <cstdint>
 
 namespace p2p {
@@ -15,34 +20,87 @@ enum class MessageType : uint8_t {
     PING = 3,
     PONG = 4,
     FILE_CHUNK = 5,
-    KEY_EXCHANGE = 6
+    KEY_EXCHANGE = 6,
+    CHANNEL_JOIN = 7,
+    CHANNEL_PART = 8,
+    CHANNEL_TEXT = 9,
+    RELAY = 10,
+    AUTH_CHALLENGE = 11,
+    AUTH_RESPONSE = 12
 };
 
 class Message {
 public:
+    // Wire header: [Type(1) | PayloadSize(4) | Timestamp(8)]
+    static constexpr size_t kHeaderSize = 13;
+
+    struct Header {
+        MessageType type;
+        uint32_t payloadSize;
+        int64_t timestampMs;
+    };
+
+    // Views into a serialized RELAY frame; nothing is copied
+    struct RelayRoute {
+        std::string_view sourceId;
+        std::string_view targetId;
+        std::span<const uint8_t> signature; // The source's, over the route and frame; may be empty
+        const uint8_t* frame;
+        size_t frameSize;
+    };
+
     Message() = default;
     Message(MessageType type, const std::vector<uint8_t>& payload);
+    Message(MessageType type, std::vector<uint8_t>&& payload);
+    Message(MessageType type, Payload&& payload);
 
     MessageType GetType() const { return type_; }
-    const std::vector<uint8_t>& GetPayload() const { return payload_; }
+    const Payload& GetPayload() const { return payload_; }
     std::chrono::system_clock::time_point GetTimestamp() const { return timestamp_; }
     
     void SetType(MessageType type) { type_ = type; }
-    void SetPayload(const std::vector<uint8_t>& payload) { payload_ = payload; }
+    void SetPayload(const std::vector<uint8_t>& payload) { SetPayload(std::span<const uint8_t>(payload)); }
+    void SetPayload(std::span<const uint8_t> payload) { payload_.assign(payload.data(), payload.data() + payload.size()); }
+    void SetPayload(std::vector<uint8_t>&& payload) { payload_ = Payload(std::move(payload)); }
+    void SetPayload(Payload&& payload) { payload_ = std::move(payload); }
     
     std::vector<uint8_t> Serialize() const;
+    // Serializes straight into a caller-owned buffer of GetSerializedSize() bytes
+    size_t GetSerializedSize() const { return kHeaderSize + payload_.size(); }
+    void SerializeTo(uint8_t* out) const;
     static Message Deserialize(const std::vector<uint8_t>& data);
+    // With an arena resource the payload lives only as long as the arena batch;
+    // copy the Message to keep it
+    static Message Deserialize(const uint8_t* data, size_t size,
+                               std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    static std::optional<Header> PeekHeader(const uint8_t* data, size_t size);
+    static std::optional<RelayRoute> PeekRelayRoute(const uint8_t* data, size_t size);
 
     static Message CreateTextMessage(const std::string& text);
-    static Message CreateHandshakeMessage(const std::string& peerId, 
-                                        const std::vector<uint8_t>& publicKey);
+    static Message CreateTextMessage(std::string&& text);
+    static Message CreateHandshakeMessage(std::string_view peerId,
+                                          std::span<const uint8_t> publicKey);
+    // Challenge-response handshake: the connecting side's challenge carries no
+    // signature; the answer carries a signature over that challenge's nonce
+    static Message CreateAuthChallengeMessage(std::string_view peerId, std::span<const uint8_t> publicKey,
+                                              std::span<const uint8_t> nonce,
+                                              std::span<const uint8_t> signature = {});
+    static Message CreateAuthResponseMessage(std::span<const uint8_t> signature);
     static Message CreatePeerListMessage(const std::vector<std::string>& peers);
     static Message CreatePingMessage();
     static Message CreatePongMessage();
+    static Message CreateChannelJoinMessage(std::string_view channel);
+    static Message CreateChannelPartMessage(std::string_view channel);
+    static Message CreateChannelTextMessage(uint32_t channelId, std::string_view text);
+    static Message CreateRelayMessage(std::string_view sourceId, std::string_view targetId,
+                                      const Message& inner, std::span<const uint8_t> signature = {});
 
 private:
+    Message(MessageType type, Payload&& payload, std::chrono::system_clock::time_point timestamp);
+
     MessageType type_ = MessageType::TEXT;
-    std::vector<uint8_t> payload_;
+    Payload payload_;
     std::chrono::system_clock::time_point timestamp_ = std::chrono::system_clock::now();
 };
 
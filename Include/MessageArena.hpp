@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory_resource>
+#include <optional>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace p2p {
+
+// Recycled arena for payloads decoded on one receive thread. A batch of
+// messages bump-allocates from it and Reset() frees them all at once after
+// the handlers return. If a batch overflows the buffer, Reset() grows the
+// buffer to cover it, so steady-state receives stop touching the heap. It
+// never grows past maxCapacity; a batch bigger than that spills to the heap
+// and gives it all back on Reset().
+class MessageArena {
+public:
+    static constexpr size_t kDefaultCapacity = 64 * 1024;
+    static constexpr size_t kDefaultMaxCapacity = 4 * 1024 * 1024;
+
+    explicit MessageArena(size_t capacity = kDefaultCapacity, size_t maxCapacity = kDefaultMaxCapacity);
+    ~MessageArena();
+
+    MessageArena(const MessageArena&) = delete;
+    MessageArena& operator=(const MessageArena&) = delete;
+
+    std::pmr::memory_resource* GetResource();
+    void Reset();
+
+    size_t GetCapacity() const { return buffer_.size(); }
+    uint64_t GetOverflowCount() const { return overflow_.count; }
+
+private:
+    // Upstream for the monotonic resource; records how far a batch spilled
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        size_t bytes = 0;
+        uint64_t count = 0;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    std::vector<std::byte> buffer_;
+    size_t maxCapacity_;
+    OverflowResource overflow_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+};
+
+} // namespace p2p
@@ -0,0 +1,369 @@
+#pragma once
+
+#include "Message.hpp"
+#include <array>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <limits>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+// Compile-time payload layouts. Each message type's wire format is declared
+// once as a Layout of field codecs; parsing, sizing and writing are all
+// generated from that declaration.
+namespace p2p::schema {
+
+namespace detail {
+
+template <typename View>
+View MakeView(const uint8_t* data, size_t size);
+
+template <>
+inline std::string_view MakeView<std::string_view>(const uint8_t* data, size_t size) {
+    return std::string_view(reinterpret_cast<const char*>(data), size);
+}
+
+template <>
+inline std::span<const uint8_t> MakeView<std::span<const uint8_t>>(const uint8_t* data, size_t size) {
+    return std::span<const uint8_t>(data, size);
+}
+
+inline uint8_t* CopyBytes(uint8_t* out, const void* data, size_t size) {
+    if (size > 0) {
+        std::memcpy(out, data, size);
+    }
+    return out + size;
+}
+
+} // namespace detail
+
+// Field codecs. Each one provides:
+//   Measure(data, available, size) - bounds-check the field, report its size
+//   Read(data, size)               - zero-copy view of a measured field
+//   SizeOf(value), Write(out, value) - exact sizing and single-pass writing
+
+// Big-endian unsigned integer
+template <typename T>
+struct Uint {
+    using ReadType = T;
+
+    static constexpr bool Measure(const uint8_t*, size_t available, size_t& size) {
+        size = sizeof(T);
+        return available >= sizeof(T);
+    }
+    static constexpr T Read(const uint8_t* data, size_t = sizeof(T)) {
+        T value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            value = static_cast<T>((static_cast<uint64_t>(value) << 8) | data[i]);
+        }
+        return value;
+    }
+    static constexpr size_t SizeOf(T) { return sizeof(T); }
+    static constexpr uint8_t* Write(uint8_t* out, T value) {
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            out[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> ((sizeof(T) - 1 - i) * 8));
+        }
+        return out + sizeof(T);
+    }
+};
+
+// Length-prefixed bytes; values longer than LengthT can count are truncated
+template <typename LengthT, typename View>
+struct Prefixed {
+    using ReadType = View;
+    static constexpr size_t kMaxLength = std::numeric_limits<LengthT>::max();
+
+    static constexpr bool Measure(const uint8_t* data, size_t available, size_t& size) {
+        if (available < sizeof(LengthT)) {
+            return false;
+        }
+        size = sizeof(LengthT) + Uint<LengthT>::Read(data);
+        return available >= size;
+    }
+    static View Read(const uint8_t* data, size_t size) {
+        return detail::MakeView<View>(data + sizeof(LengthT), size - sizeof(LengthT));
+    }
+    static size_t SizeOf(View value) {
+        return sizeof(LengthT) + std::min(value.size(), kMaxLength);
+    }
+    static uint8_t* Write(uint8_t* out, View value) {
+        size_t length = std::min(value.size(), kMaxLength);
+        out = Uint<LengthT>::Write(out, static_cast<LengthT>(length));
+        return detail::CopyBytes(out, value.data(), length);
+    }
+};
+
+template <typename LengthT>
+using String = Prefixed<LengthT, std::string_view>;
+
+template <typename LengthT>
+using Bytes = Prefixed<LengthT, std::span<const uint8_t>>;
+
+// Everything up to the end of the payload; only valid as the last field
+template <typename View>
+struct Remainder {
+    using ReadType = View;
+
+    static constexpr bool Measure(const uint8_t*, size_t available, size_t& size) {
+        size = available;
+        return true;
+    }
+    static View Read(const uint8_t* data, size_t size) {
+        return detail::MakeView<View>(data, size);
+    }
+    static size_t SizeOf(View value) { return value.size(); }
+    static uint8_t* Write(uint8_t* out, View value) {
+        return detail::CopyBytes(out, value.data(), value.size());
+    }
+};
+
+using RestString = Remainder<std::string_view>;
+using RestBytes = Remainder<std::span<const uint8_t>>;
+
+// Count-prefixed sequence of Element fields, decoded lazily while iterating
+template <typename CountT, typename Element>
+struct List {
+    static constexpr size_t kMaxCount = std::numeric_limits<CountT>::max();
+
+    class ReadType {
+    public:
+        class iterator {
+        public:
+            using value_type = typename Element::ReadType;
+            using difference_type = std::ptrdiff_t;
+
+            iterator() = default;
+            iterator(const uint8_t* data, size_t index) : data_(data), index_(index) {}
+
+            value_type operator*() const { return Element::Read(data_, ElementSize()); }
+            iterator& operator++() {
+                data_ += ElementSize();
+                ++index_;
+                return *this;
+            }
+            iterator operator++(int) {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+            bool operator==(const iterator& other) const { return index_ == other.index_; }
+
+        private:
+            // Already bounds-checked when the list was measured
+            size_t ElementSize() const {
+                size_t size = 0;
+                Element::Measure(data_, std::numeric_limits<size_t>::max(), size);
+                return size;
+            }
+
+            const uint8_t* data_ = nullptr;
+            size_t index_ = 0;
+        };
+
+        ReadType(const uint8_t* data, size_t count) : data_(data), count_(count) {}
+
+        iterator begin() const { return iterator(data_, 0); }
+        iterator end() const { return iterator(nullptr, count_); }
+        size_t size() const { return count_; }
+        bool empty() const { return count_ == 0; }
+
+    private:
+        const uint8_t* data_;
+        size_t count_;
+    };
+
+    static constexpr bool Measure(const uint8_t* data, size_t available, size_t& size) {
+        if (available < sizeof(CountT)) {
+            return false;
+        }
+        size_t count = Uint<CountT>::Read(data);
+        size = sizeof(CountT);
+        for (size_t i = 0; i < count; ++i) {
+            size_t elementSize = 0;
+            if (!Element::Measure(data + size, available - size, elementSize)) {
+                return false;
+            }
+            size += elementSize;
+        }
+        return true;
+    }
+    static ReadType Read(const uint8_t* data, size_t) {
+        return ReadType(data + sizeof(CountT), Uint<CountT>::Read(data));
+    }
+    template <typename Range>
+    static size_t SizeOf(const Range& values) {
+        size_t size = sizeof(CountT);
+        size_t count = 0;
+        for (const auto& value : values) {
+            if (count++ == kMaxCount) break;
+            size += Element::SizeOf(value);
+        }
+        return size;
+    }
+    template <typename Range>
+    static uint8_t* Write(uint8_t* out, const Range& values) {
+        size_t count = std::min<size_t>(std::size(values), kMaxCount);
+        out = Uint<CountT>::Write(out, static_cast<CountT>(count));
+        for (const auto& value : values) {
+            if (count-- == 0) break;
+            out = Element::Write(out, value);
+        }
+        return out;
+    }
+};
+
+// A message type's payload layout, as a sequence of field codecs
+template <MessageType Type, typename... Fields>
+class Layout {
+public:
+    static constexpr MessageType kType = Type;
+    static constexpr size_t kFieldCount = sizeof...(Fields);
+
+    template <size_t I>
+    using Field = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+    // Field offsets into a payload the view does not own
+    class View {
+    public:
+        template <size_t I>
+        typename Field<I>::ReadType Get() const {
+            return Field<I>::Read(data_ + offsets_[I], sizes_[I]);
+        }
+
+    private:
+        friend class Layout;
+
+        const uint8_t* data_ = nullptr;
+        std::array<size_t, kFieldCount> offsets_{};
+        std::array<size_t, kFieldCount> sizes_{};
+    };
+
+    // Validates every field in one pass; trailing bytes are ignored
+    static std::optional<View> Parse(std::span<const uint8_t> payload) {
+        View view;
+        view.data_ = payload.data();
+        size_t offset = 0;
+        if (!MeasureFields(view, payload, offset, std::index_sequence_for<Fields...>{})) {
+            return std::nullopt;
+        }
+        return view;
+    }
+
+    static std::optional<View> Parse(const Message& message) {
+        if (message.GetType() != kType) {
+            return std::nullopt;
+        }
+        const auto& payload = message.GetPayload();
+        return Parse(std::span<const uint8_t>(payload.data(), payload.size()));
+    }
+    // The view points into the message, so it has to outlive the call
+    static std::optional<View> Parse(const Message&&) = delete;
+
+    template <typename... Values>
+    static size_t SizeOf(const Values&... values) {
+        static_assert(sizeof...(Values) == kFieldCount, "One value per field");
+        return SizeOfFields(std::index_sequence_for<Fields...>{}, values...);
+    }
+
+    // Writes exactly SizeOf(values...) bytes and returns the end of them
+    template <typename... Values>
+    static uint8_t* WriteTo(uint8_t* out, const Values&... values) {
+        static_assert(sizeof...(Values) == kFieldCount, "One value per field");
+        return WriteFields(out, std::index_sequence_for<Fields...>{}, values...);
+    }
+
+    template <typename... Values>
+    static Payload Write(const Values&... values) {
+        Payload payload;
+        payload.resize(SizeOf(values...));
+        WriteTo(payload.data(), values...);
+        return payload;
+    }
+
+    template <typename... Values>
+    static Message Create(const Values&... values) {
+        return Message(kType, Write(values...));
+    }
+
+private:
+    template <size_t... I>
+    static bool MeasureFields(View& view, std::span<const uint8_t> payload, size_t& offset,
+                              std::index_sequence<I...>) {
+        return (MeasureField<I>(view, payload, offset) && ...);
+    }
+
+    template <size_t I>
+    static bool MeasureField(View& view, std::span<const uint8_t> payload, size_t& offset) {
+        size_t size = 0;
+        if (!Field<I>::Measure(payload.data() + offset, payload.size() - offset, size)) {
+            return false;
+        }
+        view.offsets_[I] = offset;
+        view.sizes_[I] = size;
+        offset += size;
+        return true;
+    }
+
+    template <size_t... I, typename... Values>
+    static size_t SizeOfFields(std::index_sequence<I...>, const Values&... values) {
+        return (Field<I>::SizeOf(values) + ... + 0);
+    }
+
+    template <size_t... I, typename... Values>
+    static uint8_t* WriteFields(uint8_t* out, std::index_sequence<I...>, const Values&... values) {
+        ((out = Field<I>::Write(out, values)), ...);
+        return out;
+    }
+};
+
+// [Text]
+struct Text : Layout<MessageType::TEXT, RestString> {
+    enum : size_t { kText };
+};
+
+// [IdLen(2) | PeerId | PublicKey]
+struct Handshake : Layout<MessageType::HANDSHAKE, String<uint16_t>, RestBytes> {
+    enum : size_t { kPeerId, kPublicKey };
+};
+
+// [IdLen(2) | PeerId | KeyLen(2) | PublicKey | NonceLen(1) | Nonce | SigLen(1) | Signature]
+struct AuthChallenge : Layout<MessageType::AUTH_CHALLENGE, String<uint16_t>, Bytes<uint16_t>,
+                              Bytes<uint8_t>, Bytes<uint8_t>> {
+    enum : size_t { kPeerId, kPublicKey, kNonce, kSignature };
+};
+
+// [SigLen(1) | Signature]
+struct AuthResponse : Layout<MessageType::AUTH_RESPONSE, Bytes<uint8_t>> {
+    enum : size_t { kSignature };
+};
+
+// [Count(2) | (Len(2) | Peer)...]
+struct PeerList : Layout<MessageType::PEER_LIST, List<uint16_t, String<uint16_t>>> {
+    enum : size_t { kPeers };
+};
+
+// [NameLen(1) | Name]
+struct ChannelJoin : Layout<MessageType::CHANNEL_JOIN, String<uint8_t>> {
+    enum : size_t { kChannel };
+};
+
+// [NameLen(1) | Name]
+struct ChannelPart : Layout<MessageType::CHANNEL_PART, String<uint8_t>> {
+    enum : size_t { kChannel };
+};
+
+// [ChannelId(4) | Text]
+struct ChannelText : Layout<MessageType::CHANNEL_TEXT, Uint<uint32_t>, RestString> {
+    enum : size_t { kChannelId, kText };
+};
+
+// [SourceLen(1) | SourceId | TargetLen(1) | TargetId | SigLen(1) | Signature | Frame]
+struct Relay : Layout<MessageType::RELAY, String<uint8_t>, String<uint8_t>, Bytes<uint8_t>, RestBytes> {
+    enum : size_t { kSourceId, kTargetId, kSignature, kFrame };
+};
+
+} // namespace p2p::schema
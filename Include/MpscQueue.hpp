@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace p2p {
+
+// Unbounded lock-free multi-producer, single-consumer queue (Vyukov's
+// intrusive node queue). Any thread may Push; only the consumer may Pop.
+// Pop can briefly miss an item whose Push is still in progress, so
+// producers should signal the consumer after pushing, not before.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+    ~MpscQueue() {
+        T value;
+        while (Pop(value)) {
+        }
+        if (tail_ != &stub_) {
+            delete tail_;
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void Push(T value) {
+        Node* node = new Node;
+        node->value.emplace(std::move(value));
+        Node* previous = head_.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    bool Pop(T& value) {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+
+        // next becomes the new (already consumed) tail
+        value = std::move(*next->value);
+        next->value.reset();
+        tail_ = next;
+        if (tail != &stub_) {
+            delete tail;
+        }
+        return true;
+    }
+
+private:
+    struct Node {
+        std::optional<T> value;
+        std::atomic<Node*> next{nullptr};
+    };
+
+    Node stub_;
+    std::atomic<Node*> head_; // Last pushed; producers swap themselves in here
+    Node* tail_;              // Consumer only
+};
+
+} // namespace p2p
@@ -1,21 +1,57 @@
 #pragma once
 
+#include "PeerHandle.hpp"
 #include <string>
 #include <vector>
+#include <exception>
 #include <functional>
+#include <future>
 #include <memory>
 #include <thread>
+#include <cstdint>
 
 namespace p2p {
 
 class Message;
 class PeerManager;
+class Executor;
+class CryptoManager;
+class Transport;
+class Endpoint;
+enum class MessageType : uint8_t;
 
 class NetworkManager {
 public:
-    using MessageHandler = std::function<void(const std::string& peerId, 
-                                            const Message& message)>;
-    using ConnectionHandler = std::function<void(const std::string& peerId, bool connected)>;
+    using MessageHandler = std::function<void(PeerHandle peer, const Message& message)>;
+    using ConnectionHandler = std::function<void(PeerHandle peer, bool connected)>;
+    // Null error once the connect is on its way
+    using ConnectCallback = std::function<void(std::exception_ptr error)>;
+    // Receive-side limits, checked on each frame's header before it's decoded.
+    // Rates are per second and 0 disables a bucket. The node-wide budgets are
+    // shared by the reactor shards, which lease tokens from them in batches.
+    struct RateLimits {
+        double peerMessageRate = 2000.0;     // Per connection
+        double peerMessageBurst = 4000.0;
+        double globalMessageRate = 200000.0;
+        double globalMessageBurst = 400000.0;
+        double handshakeRate = 500.0;        // Handshake frames, node-wide
+        double handshakeBurst = 1000.0;
+        // Connections with a peer, a handshake under way, or dialled by us.
+        // Past this new peers are refused; as many again may wait to send a
+        // handshake, for at most handshakeTimeout seconds.
+        size_t maxConnections = 4096;
+        double handshakeTimeout = 10.0;
+    };
+    
+    struct ThrottleStats {
+        uint64_t throttledMessages = 0;   // Dropped by a peer or global message bucket
+        uint64_t throttledHandshakes = 0; // Dropped by the handshake bucket
+        uint64_t refusedConnections = 0;  // Frames from new peers refused at the connection limit
+    };
+    
+    // Decides whether a peer's handshake is accepted; runs on the handshake pool
+    using HandshakeVerifier = std::function<bool(const std::string& peerId,
+                                                 const std::vector<uint8_t>& publicKey)>;
 
     NetworkManager(PeerManager& peerManager);
     ~NetworkManager();
@@ -23,16 +59,122 @@ public:
     void Start(uint16_t port);
     void Stop();
 
-    void ConnectToPeer(const std::string& address, uint16_t port);
+    // Reactor shards, each a thread owning a subset of the connections (shard 0
+    // also owns the listening socket). Sends to another shard's connections are
+    // queued to it lock-free. Takes effect on the next Start().
+    void SetShardCount(size_t count);
+
+    // Carry frames over this transport instead of the built-in ZMQ router,
+    // dealers and reactor shards; peers, handshakes, limits and relaying work
+    // the same over any of them. Start() listens on tcp://*:port and the
+    // AddListenEndpoint() endpoints, and ConnectToPeer() hands endpoints to
+    // the transport as they are. CURVE and the inproc/ipc shortcuts need the
+    // built-in transport. Set before Start() and any ConnectToPeer().
+    void SetTransport(std::unique_ptr<Transport> transport);
+
+    // With CURVE enabled the peer's CURVE public key is required. Loopback
+    // peers are reached over inproc when they're in this process, or ipc
+    // when they're on this host, unless local transports are turned off.
+    // Never blocks on a name lookup and never throws for one: a host name is
+    // handed to libzmq (or the transport) to resolve, and the peer is recorded
+    // without an address. Use ConnectToPeerAsync() to record the one reached.
+    void ConnectToPeer(const std::string& address, uint16_t port,
+                       const std::string& curveServerKey = {});
+    // A known address, such as a saved PeerInfo::endpoint; sends name the
+    // connection by Endpoint::ToString()
+    void ConnectToPeer(const Endpoint& endpoint, const std::string& curveServerKey = {});
+    // A full endpoint: tcp://host:port, ipc://path or inproc://name. Sends
+    // can name the connection by this endpoint.
+    void ConnectToPeer(const std::string& endpoint, const std::string& curveServerKey = {});
+    // Connects without blocking the caller. The host is looked up through a
+    // cache with a TTL, connects race across its addresses happy-eyeballs
+    // style, and the first to answer is dialled. The callback runs once the
+    // handshake is on its way, or with the error if the name doesn't resolve
+    // or no address answers in time; it may run on another thread. Any number
+    // can be under way at once. Local transports and a plugged-in transport
+    // connect as ConnectToPeer() does. Dials still racing when the manager
+    // is destroyed are dropped.
+    void ConnectToPeerAsync(const std::string& address, uint16_t port,
+                            const std::string& curveServerKey, ConnectCallback callback);
+    std::future<void> ConnectToPeerAsync(const std::string& address, uint16_t port,
+                                         const std::string& curveServerKey = {});
+    // Extra endpoints to listen on alongside the TCP port, such as ipc://path
+    // for sidecars. Set before Start().
+    void AddListenEndpoint(const std::string& endpoint);
+    // Each node also listens on inproc and ipc endpoints derived from its
+    // port, for co-located peers to find. On by default; set before Start().
+    void SetLocalTransportsEnabled(bool enabled);
     void DisconnectPeer(const std::string& peerId);
+    void DisconnectPeer(PeerHandle peer);
     
     void SendMessage(const std::string& peerId, const Message& message);
+    void SendMessage(PeerHandle peer, const Message& message);
     void BroadcastMessage(const Message& message);
+    void MulticastMessage(const std::vector<PeerHandle>& peers, const Message& message);
+
+    // Relay role: forward RELAY frames between peers that can't reach each other
+    void SetRelayEnabled(bool enabled);
+    void SendViaRelay(const std::string& relayPeerId, const std::string& targetPeerId,
+                      const Message& message);
+    uint64_t GetRelayedMessageCount() const;
 
+    // Typed subscription: the handler only sees messages of this type. Any number
+    // of handlers may subscribe to a type; they run in registration order.
+    // Subscribing is safe while running, but not from inside a handler.
+    template <MessageType Type>
+    void On(MessageHandler handler) {
+        Subscribe(Type, std::move(handler));
+    }
+    void Subscribe(MessageType type, MessageHandler handler);
+
+    // Catch-all handler, run after the typed handlers for every message
     void SetMessageHandler(MessageHandler handler);
     void SetConnectionHandler(ConnectionHandler handler);
 
-    std::vector<std::string> GetConnectedPeers() const;
+    // Message handlers run on a worker pool, not the I/O threads. Each peer's
+    // messages are handled in order; different peers' run in parallel.
+    // Takes effect on the next Start().
+    void SetHandlerThreadCount(size_t count);
+    // Run handlers on a shared, already started executor instead of a private
+    // one. The executor must outlive the network. Takes effect on the next Start().
+    void SetExecutor(Executor& executor);
+
+    // Handshakes are checked on a small pool of their own while the connection
+    // waits, so a reconnect storm doesn't hold up established peers' traffic.
+    // Frames a peer sends right behind its handshake are held until it's done.
+    // A rejected handshake drops the connection. Accepts everything by default.
+    void SetHandshakeVerifier(HandshakeVerifier verifier);
+    // Authenticate peers by challenge-response: each side signs a fresh nonce
+    // from the other with its node key, so a peer can't claim a key it doesn't
+    // hold. Plain handshakes are then refused. Malformed, replayed and excess
+    // handshakes are dropped before any crypto runs. Set before Start(); the
+    // crypto manager must outlive the network.
+    void SetIdentity(CryptoManager& crypto, std::vector<uint8_t> privateKey);
+    uint64_t GetRejectedHandshakeCount() const;
+    // Encrypt all traffic with CurveZMQ, using a key pair derived from the
+    // node key. libzmq encrypts on its own I/O threads, not ours. Peers are
+    // dialled with their CURVE public key (Z85), which pins who answers.
+    // Needs SetIdentity() first; set before Start() and any ConnectToPeer().
+    void SetCurveEnabled(bool enabled);
+    // Z85, 40 characters; empty unless CURVE is enabled
+    std::string GetCurvePublicKey() const;
+
+    // Takes effect on the next Start()
+    void SetRateLimits(const RateLimits& limits);
+    ThrottleStats GetThrottleStats() const;
+    // Received frames over the overall limit are refused by zmq before they're
+    // read in, and the peer is disconnected. Below that, each message type's
+    // payload is held to its own limit, checked on the header before anything
+    // is decoded. Control types default to their largest valid size; bulk
+    // types are only bounded by the frame limit (16 MB). Set before Start().
+    void SetMaxFrameSize(size_t bytes);
+    void SetMaxPayloadSize(MessageType type, size_t bytes);
+    // Frames dropped for their size or a malformed header
+    uint64_t GetRejectedFrameCount() const;
+    // Takes effect on the next Start()
+    void SetHandshakeThreadCount(size_t count);
+
+    std::vector<PeerHandle> GetConnectedPeers() const;
 
 private:
     struct Impl;
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <span>
+#include <memory_resource>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+namespace p2p {
+
+// Message payload bytes. Payloads up to kInlineCapacity live inside the
+// object, so chat lines and empty PING/PONG payloads never touch the heap.
+// Larger ones come from a std::pmr resource, or adopt the buffer of a
+// moved-in string or vector. Copies always land on the default resource, so
+// a copy of an arena-backed payload outlives the arena; moves keep the
+// source's storage.
+class Payload {
+public:
+    static constexpr size_t kInlineCapacity = 192;
+
+    using value_type = uint8_t;
+    using size_type = size_t;
+    using iterator = uint8_t*;
+    using const_iterator = const uint8_t*;
+
+    Payload() noexcept : Payload(std::pmr::get_default_resource()) {}
+    explicit Payload(std::pmr::memory_resource* resource) noexcept;
+    Payload(const std::vector<uint8_t>& bytes) : Payload(bytes.data(), bytes.size()) {}
+    Payload(const uint8_t* data, size_t size,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    Payload(std::span<const uint8_t> bytes,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : Payload(bytes.data(), bytes.size(), resource) {}
+    explicit Payload(std::string&& text);
+    explicit Payload(std::vector<uint8_t>&& bytes);
+
+    Payload(const Payload& other);
+    Payload(Payload&& other) noexcept;
+    Payload& operator=(const Payload& other);
+    Payload& operator=(Payload&& other) noexcept;
+    ~Payload();
+
+    const uint8_t* data() const { return data_; }
+    uint8_t* data() { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+    iterator begin() { return data_; }
+    iterator end() { return data_ + size_; }
+
+    uint8_t operator[](size_t index) const { return data_[index]; }
+    uint8_t& operator[](size_t index) { return data_[index]; }
+
+    void assign(const uint8_t* first, const uint8_t* last);
+    void resize(size_t size); // New bytes are left uninitialized
+    void clear() { size_ = 0; }
+
+    bool IsInline() const { return storage_ == Storage::Inline; }
+    std::pmr::memory_resource* GetResource() const { return resource_; }
+    std::vector<uint8_t> ToVector() const { return std::vector<uint8_t>(begin(), end()); }
+
+    friend bool operator==(const Payload& lhs, const Payload& rhs) {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+    friend bool operator==(const Payload& lhs, const std::vector<uint8_t>& rhs) {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+
+private:
+    enum class Storage : uint8_t { Inline, Heap, String, Vector };
+
+    void Allocate(size_t size);
+    void Release() noexcept;
+    void TakeFrom(Payload& other) noexcept;
+    size_t GetCapacity() const;
+
+    uint8_t* data_;
+    size_t size_ = 0;
+    std::pmr::memory_resource* resource_;
+    Storage storage_ = Storage::Inline;
+
+    union {
+        uint8_t inline_[kInlineCapacity];
+        struct {
+            uint8_t* bytes;
+            size_t capacity;
+        } heap_;
+        std::string string_;
+        std::vector<uint8_t> vector_;
+    };
+};
+
+} // namespace p2p
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <deque>
+#include <unordered_map>
+#include <shared_mutex>
+#include <functional>
+#include <cstdint>
+
+namespace p2p {
+
+// Interned peer identity: an index into a PeerIdTable
+class PeerHandle {
+public:
+    static constexpr uint32_t kInvalidIndex = 0xFFFFFFFF;
+
+    constexpr PeerHandle() = default;
+    constexpr explicit PeerHandle(uint32_t index) : index_(index) {}
+
+    constexpr uint32_t GetIndex() const { return index_; }
+    constexpr bool IsValid() const { return index_ != kInvalidIndex; }
+    constexpr explicit operator bool() const { return IsValid(); }
+
+    constexpr auto operator<=>(const PeerHandle&) const = default;
+
+private:
+    uint32_t index_ = kInvalidIndex;
+};
+
+// Binary form of a 16 hex character peer ID
+using RawPeerId = std::array<uint8_t, 8>;
+
+// Append-only table of peer IDs. Handles and the references returned
+// by GetId stay valid for the life of the table.
+class PeerIdTable {
+public:
+    PeerIdTable();
+    ~PeerIdTable();
+
+    PeerHandle Intern(std::string_view peerId);
+    PeerHandle Find(std::string_view peerId) const;
+
+    const std::string& GetId(PeerHandle peer) const;
+    const RawPeerId& GetRawId(PeerHandle peer) const;
+    size_t Size() const;
+
+    static bool ParseRawId(std::string_view peerId, RawPeerId& raw);
+
+private:
+    struct Entry {
+        std::string id;
+        RawPeerId raw{};
+    };
+
+    mutable std::shared_mutex mutex_;
+    std::deque<Entry> entries_;
+    std::unordered_map<std::string_view, uint32_t> index_; // Keys view into entries_
+};
+
+} // namespace p2p
+
+template <>
+struct std::hash<p2p::PeerHandle> {
+    size_t operator()(p2p::PeerHandle peer) const noexcept {
+        return peer.GetIndex();
+    }
+};
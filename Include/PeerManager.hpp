@@ -1,9 +1,12 @@
 #pragma once
 
+#include "Endpoint.hpp"
+#include "PeerHandle.hpp"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
-#include <unordered_map>
+#include <optional>
 #include <mutex>
 #include <chrono>
 
@@ -11,11 +14,12 @@ namespace p2p {
 
 struct PeerInfo {
     std::string id;
-    std::string address;
-    uint16_t port;
+    Endpoint endpoint; // Unspecified for peers that dialled us
+    std::string host;  // Name it was dialled by, while the endpoint has no address
     std::vector<uint8_t> publicKey;
     bool isConnected;
     std::chrono::system_clock::time_point lastSeen;
+    PeerHandle handle; // Assigned by PeerManager
 };
 
 class PeerManager {
@@ -23,14 +27,30 @@ public:
     PeerManager();
     ~PeerManager();
 
-    void AddPeer(const PeerInfo& peer);
+    PeerHandle AddPeer(const PeerInfo& peer);
     void RemovePeer(const std::string& peerId);
+    void RemovePeer(PeerHandle peer);
     void UpdatePeerStatus(const std::string& peerId, bool connected);
+    void UpdatePeerStatus(PeerHandle peer, bool connected);
     
     std::optional<PeerInfo> GetPeer(const std::string& peerId) const;
+    std::optional<PeerInfo> GetPeer(PeerHandle peer) const;
     std::vector<PeerInfo> GetAllPeers() const;
     std::vector<PeerInfo> GetConnectedPeers() const;
     
+    // Hot-path status; these only touch the packed per-peer arrays
+    void TouchPeer(PeerHandle peer);
+    void UpdatePeerRtt(PeerHandle peer, std::chrono::microseconds rtt);
+    std::chrono::microseconds GetPeerRtt(PeerHandle peer) const;
+    std::vector<PeerHandle> GetConnectedPeerHandles() const;
+    std::vector<PeerHandle> GetStalePeers(std::chrono::system_clock::time_point cutoff) const;
+    
+    // Interned peer IDs; handles index straight into the peer table
+    PeerHandle InternPeerId(std::string_view peerId);
+    PeerHandle FindPeerHandle(std::string_view peerId) const;
+    const std::string& GetPeerId(PeerHandle peer) const;
+    const RawPeerId& GetRawPeerId(PeerHandle peer) const;
+    
     void SetLocalPeer(const PeerInfo& localPeer);
     const PeerInfo& GetLocalPeer() const;
 
@@ -38,9 +58,38 @@ public:
     void LoadPeersFromFile(const std::string& filename);
 
 private:
+    enum PeerFlags : uint8_t {
+        kPresent = 1 << 0,
+        kConnected = 1 << 1,
+    };
+    
+    // Rarely read fields; the public key bytes live in keyArena_
+    struct ColdPeerInfo {
+        Endpoint endpoint;
+        std::string host;
+        uint32_t keyOffset = 0;
+        uint32_t keySize = 0;
+    };
+    
+    void StorePeer(PeerHandle handle, const PeerInfo& peer);
+    void StoreKey(ColdPeerInfo& cold, const std::vector<uint8_t>& key);
+    void CompactKeyArena();
+    PeerInfo LoadPeer(uint32_t index) const;
+    bool IsPresent(PeerHandle peer) const;
+
     mutable std::mutex mutex_;
-    std::unordered_map<std::string, PeerInfo> peers_;
+    PeerIdTable peerIds_;
+    
+    // Structure of arrays indexed by PeerHandle. Heartbeat and broadcast
+    // scans walk only the hot arrays.
+    std::vector<uint8_t> flags_;
+    std::vector<std::chrono::system_clock::time_point> lastSeen_;
+    std::vector<uint32_t> rttMicros_;
+    std::vector<ColdPeerInfo> cold_;
+    std::vector<uint8_t> keyArena_;
+    size_t keyArenaGarbage_ = 0;
+    
     PeerInfo localPeer_;
 };
 
-} // namespace p2p
\ No newline at end of file
+} // namespace p2p
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <span>
+#include <unordered_set>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace p2p {
+
+// Bounded set of recently seen handshake nonces, so a captured handshake
+// can't be replayed to make us spend crypto on it again. Once full, each new
+// nonce evicts the oldest one. Thread-safe.
+class ReplayCache {
+public:
+    static constexpr size_t kNonceSize = 16;
+    static constexpr size_t kDefaultCapacity = 4096;
+
+    using Nonce = std::array<uint8_t, kNonceSize>;
+
+    explicit ReplayCache(size_t capacity = kDefaultCapacity);
+
+    // Records the nonce. Returns false if it's already cached, or isn't kNonceSize bytes.
+    bool Insert(std::span<const uint8_t> nonce);
+    bool Contains(std::span<const uint8_t> nonce) const;
+
+    size_t GetSize() const;
+    size_t GetCapacity() const { return capacity_; }
+
+private:
+    // Folds both halves of the nonce together
+    struct NonceHash {
+        size_t operator()(const Nonce& nonce) const noexcept;
+    };
+
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    std::unordered_set<Nonce, NonceHash> seen_;
+    std::vector<Nonce> order_; // Ring of cached nonces, oldest at next_ once full
+    size_t next_ = 0;
+};
+
+} // namespace p2p
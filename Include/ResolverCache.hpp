@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Executor.hpp"
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace p2p {
+
+// Remembers host name lookups for a while, so reconnects and peers that share
+// a name don't each wait on DNS. Lookups block on a pool of their own, several
+// at once, and callers asking for a name already being looked up wait on that
+// one query. Literal addresses are answered on the spot. Thread-safe.
+class ResolverCache {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Addresses = std::vector<std::string>; // Literal IPs, most preferred first
+    // Blocking lookup of a host's addresses; throws if it doesn't resolve
+    using Lookup = std::function<Addresses(const std::string& host)>;
+    // Gets the addresses, or the lookup's error and no addresses. Mustn't throw.
+    using Callback = std::function<void(const Addresses& addresses, std::exception_ptr error)>;
+
+    static constexpr size_t kDefaultThreads = 8;
+
+    explicit ResolverCache(size_t threads = kDefaultThreads, Lookup lookup = SystemLookup);
+    ~ResolverCache();
+
+    ResolverCache(const ResolverCache&) = delete;
+    ResolverCache& operator=(const ResolverCache&) = delete;
+
+    // Calls back at once for a literal address or an unexpired answer,
+    // otherwise from a lookup thread once the query is done
+    void Resolve(const std::string& host, Callback callback, Clock::time_point now = Clock::now());
+
+    // How long answers are kept. Failures are kept briefly, so a bad name
+    // can't flood DNS but a fixed one is retried soon.
+    void SetTtl(Clock::duration ttl);
+    void SetFailureTtl(Clock::duration ttl);
+    // Forgets every finished lookup
+    void Clear();
+
+    // Queries actually sent to the lookup, as opposed to answered from cache
+    uint64_t GetLookupCount() const { return lookups_.load(std::memory_order_relaxed); }
+
+    // getaddrinfo for TCP, in the order it prefers
+    static Addresses SystemLookup(const std::string& host);
+
+private:
+    struct Entry {
+        bool pending = true;
+        Clock::time_point expires{};
+        Addresses addresses;
+        std::exception_ptr error;
+        std::vector<Callback> waiting; // Until the lookup finishes
+    };
+
+    void Finish(const std::string& host, Addresses addresses, std::exception_ptr error);
+    // Caller holds mutex_
+    void Prune(Clock::time_point now);
+
+    Lookup lookup_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    Clock::duration ttl_ = std::chrono::seconds(60);
+    Clock::duration failureTtl_ = std::chrono::seconds(5);
+    std::atomic<uint64_t> lookups_{0};
+    std::atomic<bool> stopping_{false};
+    Executor pool_; // Last, so its workers are gone before the rest
+};
+
+} // namespace p2p
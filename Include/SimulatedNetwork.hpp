@@ -0,0 +1,155 @@
+#pragma once
+
+#include "Transport.hpp"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+namespace p2p {
+
+class SimulatedTransport;
+
+// In-memory network on a virtual clock, for running large topologies without
+// sockets, threads or sleeps. Every frame, connect, close and timer is an
+// event; RunFor() delivers them in time order on the calling thread, so a run
+// depends only on the seed. One thread drives the clock, but transports may
+// be called from any thread, as a NetworkManager's workers do; runs are only
+// reproducible when every call comes from the driving thread.
+class SimulatedNetwork {
+public:
+    using Duration = std::chrono::microseconds; // Virtual time since the network was made
+
+    struct Link {
+        Duration latency = std::chrono::milliseconds(1);
+        double bandwidth = 0.0; // Bytes per second; 0 is unlimited
+        double lossRate = 0.0;  // Chance each frame is dropped
+    };
+
+    struct Stats {
+        uint64_t framesSent = 0;
+        uint64_t framesDelivered = 0;
+        uint64_t framesLost = 0; // To link loss, isolation, a closed connection, or the frame limit
+        uint64_t bytesSent = 0;
+    };
+
+    explicit SimulatedNetwork(uint64_t seed = 1);
+    ~SimulatedNetwork();
+
+    // The network must outlive its transports
+    std::unique_ptr<SimulatedTransport> CreateTransport();
+
+    // Applies to every link without an override of its own
+    void SetDefaultLink(const Link& link);
+    // Frames from `from` to `to`; set both ways for a symmetric link
+    void SetLink(const SimulatedTransport& from, const SimulatedTransport& to, const Link& link);
+    // An isolated node's frames, in and out, are lost, as if it had crashed
+    // without closing its connections
+    void SetIsolated(const SimulatedTransport& node, bool isolated);
+
+    void Schedule(Duration delay, std::function<void()> task);
+    Duration Now() const;
+
+    // Delivers the events due within `duration`, then moves the clock to its end
+    size_t RunFor(Duration duration);
+    // Delivers events until none are left; returns how many ran
+    size_t RunUntilIdle();
+
+    Stats GetStats() const;
+
+private:
+    friend class SimulatedTransport;
+    using ConnectionId = Transport::ConnectionId;
+
+    struct Connection {
+        uint32_t peerNode = 0;
+        ConnectionId peerConnection = Transport::kNoConnection;
+        bool open = false;
+        Duration busyUntil{0}; // When the link is done sending what's queued on it
+    };
+
+    struct Node {
+        SimulatedTransport* transport = nullptr; // Null once destroyed
+        std::vector<std::string> endpoints;
+        bool isolated = false;
+        std::vector<Connection> connections;
+    };
+
+    enum class EventKind : uint8_t { Open, Frame, Close, Task };
+
+    struct Event {
+        Duration time;
+        uint64_t sequence; // Breaks ties in the order events were made
+        EventKind kind;
+        uint32_t node;
+        ConnectionId connection;
+        std::vector<uint8_t> frame;
+        std::function<void()> task;
+    };
+
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const {
+            return a.time != b.time ? a.time > b.time : a.sequence > b.sequence;
+        }
+    };
+
+    uint32_t AddNode(SimulatedTransport* transport);
+    void RemoveNode(uint32_t node);
+    void Listen(uint32_t node, const std::string& endpoint);
+    ConnectionId Connect(uint32_t node, const std::string& endpoint);
+    bool Send(uint32_t node, ConnectionId connection, std::span<const uint8_t> frame);
+    void Close(uint32_t node, ConnectionId connection);
+    void Stop(uint32_t node);
+
+    const Link& GetLink(uint32_t from, uint32_t to) const;
+    // Queues an event across the link behind whatever it's already carrying
+    void Transmit(uint32_t from, ConnectionId connection, EventKind kind, std::vector<uint8_t> frame);
+    void Push(Duration time, EventKind kind, uint32_t node, ConnectionId connection,
+              std::vector<uint8_t> frame = {}, std::function<void()> task = {});
+    // Applies the event to the network, under the lock; returns the transport
+    // whose handler should then hear of it, if any
+    SimulatedTransport* Apply(Event& event);
+    // Runs the handlers outside the lock, so they can call back in
+    static void Deliver(SimulatedTransport* transport, Event& event);
+    bool Lost(double lossRate);
+
+    mutable std::mutex mutex_;
+    Duration now_{0};
+    uint64_t sequence_ = 0;
+    std::mt19937_64 random_;
+    Link defaultLink_;
+    std::unordered_map<uint64_t, Link> links_; // Keyed by from << 32 | to
+    std::vector<Node> nodes_;
+    std::unordered_map<std::string, uint32_t> listeners_;
+    std::vector<Event> events_; // Heap ordered by Later, soonest at the front
+    Stats stats_;
+};
+
+// One node's view of a SimulatedNetwork
+class SimulatedTransport final : public Transport {
+public:
+    ~SimulatedTransport() override;
+
+    void Listen(const std::string& endpoint) override;
+    ConnectionId Connect(const std::string& endpoint) override;
+    bool Send(ConnectionId connection, std::span<const uint8_t> frame) override;
+    void Close(ConnectionId connection) override;
+    void Stop() override;
+
+    SimulatedNetwork& GetNetwork() const { return network_; }
+
+private:
+    friend class SimulatedNetwork;
+
+    SimulatedTransport(SimulatedNetwork& network) : network_(network) {}
+
+    SimulatedNetwork& network_;
+    uint32_t node_ = 0;
+};
+
+} // namespace p2p
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+
+namespace p2p {
+
+// Classic token bucket: holds up to `burst` tokens and refills at `rate`
+// tokens per second. A rate of 0 means unlimited. Not thread-safe; each
+// bucket belongs to the thread that checks it.
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket() = default;
+    TokenBucket(double ratePerSecond, double burst);
+
+    // Takes the tokens if there are enough, refilling first for the time since the last call
+    bool TryTake(Clock::time_point now, double tokens = 1.0);
+    // Takes whatever is available, up to `tokens`, and returns how much that was.
+    // Lets one shared bucket hand out tokens in batches.
+    double TakeUpTo(Clock::time_point now, double tokens);
+
+    bool IsUnlimited() const { return rate_ <= 0.0; }
+    double GetRate() const { return rate_; }
+    double GetBurst() const { return burst_; }
+
+private:
+    void Refill(Clock::time_point now);
+
+    double rate_ = 0.0;
+    double burst_ = 0.0;
+    double tokens_ = 0.0;
+    Clock::time_point last_{}; // Starts full: the first refill covers all time since the epoch
+};
+
+} // namespace p2p
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+#include <span>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace p2p {
+
+// Moves whole frames between this node and its peers, so the peer, handshake
+// and routing logic above it doesn't care what carries them. ZeroMQ isn't a
+// backend: NetworkManager's own router, dealers and reactor shards carry it
+// when no transport is set. Connections are numbered by the transport; an
+// incoming one appears with the peer's connect.
+// Handlers run on the transport's own threads (for the simulator, inside its
+// Run calls) and must be set before Listen() or Connect(). The other calls
+// are safe from any thread, including from inside a handler. NetworkManager
+// calls Connect() and Close() without holding its locks, so a backend may run
+// handlers from inside them; Send() is called under its connection lock and
+// must not.
+class Transport {
+public:
+    using ConnectionId = uint32_t;
+    static constexpr ConnectionId kNoConnection = 0xFFFFFFFF;
+
+    // The frame is only valid during the call
+    using FrameHandler = std::function<void(ConnectionId connection, std::span<const uint8_t> frame)>;
+    // Incoming connections as they arrive, and any connection the other side
+    // closes or that fails to open. Never called for our own Close().
+    using ConnectionHandler = std::function<void(ConnectionId connection, bool connected)>;
+
+    virtual ~Transport() = default;
+
+    virtual void Listen(const std::string& endpoint) = 0;
+    // kNoConnection if the endpoint can't be reached at all
+    virtual ConnectionId Connect(const std::string& endpoint) = 0;
+    // False if the frame wasn't queued, e.g. the connection is closed
+    virtual bool Send(ConnectionId connection, std::span<const uint8_t> frame) = 0;
+    virtual void Close(ConnectionId connection) = 0;
+    // Closes every connection and stops listening; Listen() may be called again after
+    virtual void Stop() = 0;
+
+    void SetFrameHandler(FrameHandler handler) { frameHandler_ = std::move(handler); }
+    void SetConnectionHandler(ConnectionHandler handler) { connectionHandler_ = std::move(handler); }
+    // Received frames larger than this are dropped, and so is the connection
+    // where the wire can't skip them. Set before Listen() or Connect().
+    void SetMaxFrameSize(size_t bytes) { maxFrameSize_ = bytes; }
+    size_t GetMaxFrameSize() const { return maxFrameSize_; }
+
+protected:
+    FrameHandler frameHandler_;
+    ConnectionHandler connectionHandler_;
+    size_t maxFrameSize_ = 16 * 1024 * 1024;
+};
+
+} // namespace p2p
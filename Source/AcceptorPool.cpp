@@ -0,0 +1,158 @@
+#include "AcceptorPool.hpp"
+#include <boost/asio/ip/v6_only.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/socket_base.hpp>
+#include <algorithm>
+#include <chrono>
+
+namespace p2p {
+
+using boost::asio::ip::tcp;
+
+// How long an acceptor waits after a failed accept. Errors such as EMFILE
+// leave the connection queued, so retrying at once would just spin.
+static constexpr auto kAcceptRetryDelay = std::chrono::milliseconds(100);
+
+#ifdef SO_REUSEPORT
+using ReusePort = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
+AcceptorPool::AcceptorPool(size_t acceptorCount) {
+    size_t count = IsReusePortSupported() ? std::max<size_t>(acceptorCount, 1) : 1;
+    for (size_t i = 0; i < count; ++i) {
+        acceptors_.push_back(std::make_unique<Acceptor>());
+    }
+}
+
+AcceptorPool::~AcceptorPool() {
+    Stop();
+}
+
+bool AcceptorPool::IsReusePortSupported() {
+#ifdef SO_REUSEPORT
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t AcceptorPool::GetDefaultAcceptorCount() {
+    return IsReusePortSupported() ? std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 8) : 1;
+}
+
+uint64_t AcceptorPool::GetAcceptedCount(size_t acceptor) const {
+    return acceptors_[acceptor]->accepted.load(std::memory_order_relaxed);
+}
+
+uint64_t AcceptorPool::GetAcceptErrorCount() const {
+    uint64_t errors = 0;
+    for (const auto& acceptor : acceptors_) {
+        errors += acceptor->errors.load(std::memory_order_relaxed);
+    }
+    return errors;
+}
+
+void AcceptorPool::Start(uint16_t port, AcceptHandler handler) {
+    Start(std::nullopt, port, std::move(handler));
+}
+
+void AcceptorPool::Start(const tcp::endpoint& local, AcceptHandler handler) {
+    Start(local.address(), local.port(), std::move(handler));
+}
+
+// A pool is started at most once; make a new one to listen again
+void AcceptorPool::Start(const std::optional<boost::asio::ip::address>& address, uint16_t port,
+                         AcceptHandler handler) {
+    if (running_) return;
+    handler_ = std::move(handler);
+
+    try {
+        // Dual-stack on every interface, so IPv6 and IPv4 peers both get in,
+        // unless the host has no IPv6
+        auto protocol = address ? tcp::endpoint(*address, 0).protocol() : tcp::v6();
+        for (size_t i = 0; i < acceptors_.size(); ++i) {
+            auto& acceptor = acceptors_[i]->acceptor;
+            boost::system::error_code noIpv6;
+            if (!address && protocol == tcp::v6()) {
+                acceptor.open(protocol, noIpv6);
+                if (noIpv6) {
+                    protocol = tcp::v4();
+                } else {
+                    acceptor.set_option(boost::asio::ip::v6_only(false));
+                }
+            }
+            if (address || protocol == tcp::v4()) {
+                acceptor.open(protocol);
+            }
+
+            // The first bind resolves port 0; the rest share whatever it got
+            tcp::endpoint endpoint(protocol, i == 0 ? port : port_);
+            if (address) {
+                endpoint.address(*address);
+            }
+            acceptor.set_option(tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+            if (acceptors_.size() > 1) {
+                acceptor.set_option(ReusePort(true));
+            }
+#endif
+            acceptor.bind(endpoint);
+            acceptor.listen(boost::asio::socket_base::max_listen_connections);
+            if (i == 0) {
+                port_ = acceptor.local_endpoint().port();
+            }
+        }
+    } catch (...) {
+        for (auto& acceptor : acceptors_) {
+            boost::system::error_code ec;
+            acceptor->acceptor.close(ec);
+        }
+        throw;
+    }
+
+    running_ = true;
+    for (auto& acceptor : acceptors_) {
+        Accept(*acceptor);
+        acceptor->thread = std::thread([a = acceptor.get()]() { a->context.run(); });
+    }
+}
+
+void AcceptorPool::Stop() {
+    if (!running_) return;
+    running_ = false;
+
+    for (auto& acceptor : acceptors_) {
+        acceptor->work.reset();
+        acceptor->context.stop();
+    }
+    for (auto& acceptor : acceptors_) {
+        if (acceptor->thread.joinable()) {
+            acceptor->thread.join();
+        }
+        boost::system::error_code ec;
+        acceptor->acceptor.close(ec);
+    }
+}
+
+void AcceptorPool::Accept(Acceptor& acceptor) {
+    acceptor.acceptor.async_accept([this, &acceptor](boost::system::error_code ec, tcp::socket socket) {
+        if (ec == boost::asio::error::operation_aborted || !acceptor.acceptor.is_open()) {
+            return;
+        }
+        if (ec) {
+            acceptor.errors.fetch_add(1, std::memory_order_relaxed);
+            acceptor.retry.expires_after(kAcceptRetryDelay);
+            acceptor.retry.async_wait([this, &acceptor](boost::system::error_code ec) {
+                if (!ec) {
+                    Accept(acceptor);
+                }
+            });
+            return;
+        }
+        acceptor.accepted.fetch_add(1, std::memory_order_relaxed);
+        handler_(std::move(socket));
+        Accept(acceptor);
+    });
+}
+
+} // namespace p2p
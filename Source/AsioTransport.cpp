@@ -0,0 +1,356 @@
+#include "AsioTransport.hpp"
+#include <boost/asio/connect.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/write.hpp>
+#include <charconv>
+#include <cstring>
+#include <future>
+#include <optional>
+#include <stdexcept>
+
+namespace p2p {
+
+using boost::asio::ip::tcp;
+
+// Bytes of length ahead of each frame, and the least room left for each read
+static constexpr size_t kLengthSize = 4;
+static constexpr size_t kReadChunk = 64 * 1024;
+
+struct AsioTransport::Session {
+    explicit Session(tcp::socket socket) : socket(std::move(socket)) {}
+
+    ConnectionId id = kNoConnection;
+    tcp::socket socket;
+
+    // Guarded by the transport's sessionsMutex_
+    bool open = false;    // Connected; until then sends only queue
+    bool writing = false; // A write is posted or on the wire
+    bool closed = false;
+    std::vector<std::vector<uint8_t>> queued; // Length-prefixed frames for the next write
+    size_t queuedBytes = 0;
+
+    // I/O thread only
+    std::vector<std::vector<uint8_t>> inFlight;
+    std::vector<uint8_t> buffer; // Bytes read but not yet handed out as frames
+    size_t buffered = 0;
+};
+
+static size_t ReadLength(const uint8_t* bytes) {
+    return static_cast<size_t>(bytes[0]) << 24 | static_cast<size_t>(bytes[1]) << 16 |
+           static_cast<size_t>(bytes[2]) << 8 | bytes[3];
+}
+
+struct HostPort {
+    std::string host;
+    std::string port;
+};
+
+// tcp://host:port, with an IPv6 host in brackets
+static std::optional<HostPort> ParseEndpoint(const std::string& endpoint) {
+    static constexpr std::string_view kScheme = "tcp://";
+    if (!endpoint.starts_with(kScheme)) {
+        return std::nullopt;
+    }
+    std::string_view rest(endpoint);
+    rest.remove_prefix(kScheme.size());
+    auto colon = rest.rfind(':');
+    if (colon == std::string_view::npos || colon == 0 || colon + 1 == rest.size()) {
+        return std::nullopt;
+    }
+    auto host = rest.substr(0, colon);
+    if (host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    return HostPort{ std::string(host), std::string(rest.substr(colon + 1)) };
+}
+
+AsioTransport::AsioTransport(size_t acceptorCount) : acceptorCount_(acceptorCount) {
+    thread_ = std::thread([this]() { context_.run(); });
+}
+
+AsioTransport::~AsioTransport() {
+    Stop();
+    work_.reset();
+    context_.stop();
+    thread_.join();
+}
+
+void AsioTransport::RunOnIoThread(const std::function<void()>& task) {
+    if (context_.get_executor().running_in_this_thread()) {
+        task();
+        return;
+    }
+    std::promise<void> done;
+    boost::asio::post(context_, [&]() {
+        try {
+            task();
+            done.set_value();
+        } catch (...) {
+            done.set_exception(std::current_exception());
+        }
+    });
+    done.get_future().get();
+}
+
+void AsioTransport::Listen(const std::string& endpoint) {
+    auto parsed = ParseEndpoint(endpoint);
+    if (!parsed) {
+        throw std::invalid_argument("Can't listen on " + endpoint + "; use tcp://host:port");
+    }
+
+    auto pool = std::make_unique<AcceptorPool>(acceptorCount_);
+    auto accepted = [this](tcp::socket socket) { Accepted(std::move(socket)); };
+    if (parsed->host == "*") {
+        uint16_t port = 0;
+        auto [end, error] = std::from_chars(parsed->port.data(), parsed->port.data() + parsed->port.size(), port);
+        if (error != std::errc() || end != parsed->port.data() + parsed->port.size()) {
+            throw std::invalid_argument("Can't listen on " + endpoint + "; bad port");
+        }
+        pool->Start(port, accepted);
+    } else {
+        tcp::resolver resolver(context_);
+        pool->Start(*resolver.resolve(parsed->host, parsed->port, tcp::resolver::passive).begin(), accepted);
+    }
+
+    listenPort_ = pool->GetPort();
+    std::lock_guard<std::mutex> lock(poolsMutex_);
+    pools_.push_back(std::move(pool));
+}
+
+Transport::ConnectionId AsioTransport::Connect(const std::string& endpoint) {
+    auto parsed = ParseEndpoint(endpoint);
+    if (!parsed) {
+        return kNoConnection;
+    }
+
+    auto session = std::make_shared<Session>(tcp::socket(context_));
+    auto id = AddSession(session);
+    auto resolver = std::make_shared<tcp::resolver>(context_);
+    resolver->async_resolve(parsed->host, parsed->port,
+        [this, session, resolver](const boost::system::error_code& ec, tcp::resolver::results_type results) {
+            if (ec) {
+                Drop(session);
+                return;
+            }
+            boost::asio::async_connect(session->socket, results,
+                [this, session](const boost::system::error_code& ec, const tcp::endpoint&) {
+                    if (ec) {
+                        Drop(session);
+                        return;
+                    }
+                    Opened(session);
+                });
+        });
+    return id;
+}
+
+bool AsioTransport::Send(ConnectionId connection, std::span<const uint8_t> frame) {
+    std::vector<uint8_t> framed(kLengthSize + frame.size());
+    auto length = static_cast<uint32_t>(frame.size());
+    framed[0] = static_cast<uint8_t>(length >> 24);
+    framed[1] = static_cast<uint8_t>(length >> 16);
+    framed[2] = static_cast<uint8_t>(length >> 8);
+    framed[3] = static_cast<uint8_t>(length);
+    std::memcpy(framed.data() + kLengthSize, frame.data(), frame.size());
+
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    auto it = sessions_.find(connection);
+    if (it == sessions_.end()) {
+        return false;
+    }
+    auto& session = it->second;
+    if (session->queuedBytes + framed.size() > maxQueuedBytes_) {
+        return false;
+    }
+    session->queuedBytes += framed.size();
+    session->queued.push_back(std::move(framed));
+
+    // One write is posted at a time; anything queued meanwhile rides along with the next
+    if (session->open && !session->writing) {
+        session->writing = true;
+        boost::asio::post(session->socket.get_executor(), [this, session]() { Write(session); });
+    }
+    return true;
+}
+
+void AsioTransport::Close(ConnectionId connection) {
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        auto it = sessions_.find(connection);
+        if (it == sessions_.end()) {
+            return;
+        }
+        session = it->second;
+        session->closed = true;
+        sessions_.erase(it);
+    }
+    boost::asio::post(session->socket.get_executor(), [session]() {
+        boost::system::error_code ignored;
+        session->socket.close(ignored);
+    });
+}
+
+void AsioTransport::Stop() {
+    // Once their threads are joined, nothing runs the accepted sessions, and
+    // their sockets can be closed from the I/O thread. The pools go after.
+    std::vector<std::unique_ptr<AcceptorPool>> pools;
+    {
+        std::lock_guard<std::mutex> lock(poolsMutex_);
+        pools.swap(pools_);
+    }
+    for (auto& pool : pools) {
+        pool->Stop();
+    }
+    listenPort_ = 0;
+
+    RunOnIoThread([this]() {
+        std::unordered_map<ConnectionId, std::shared_ptr<Session>> sessions;
+        {
+            std::lock_guard<std::mutex> lock(sessionsMutex_);
+            sessions.swap(sessions_);
+            for (auto& [id, session] : sessions) {
+                session->closed = true;
+            }
+        }
+        for (auto& [id, session] : sessions) {
+            boost::system::error_code ignored;
+            session->socket.close(ignored);
+        }
+    });
+}
+
+Transport::ConnectionId AsioTransport::AddSession(const std::shared_ptr<Session>& session) {
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    session->id = nextConnection_++;
+    if (nextConnection_ == kNoConnection) {
+        nextConnection_ = 0;
+    }
+    sessions_.emplace(session->id, session);
+    return session->id;
+}
+
+void AsioTransport::Accepted(tcp::socket socket) {
+    auto session = std::make_shared<Session>(std::move(socket));
+    AddSession(session);
+    if (connectionHandler_) {
+        connectionHandler_(session->id, true);
+    }
+    Opened(session);
+}
+
+// Starts reading, and writes whatever was sent while the connect was under way
+void AsioTransport::Opened(const std::shared_ptr<Session>& session) {
+    boost::system::error_code ignored;
+    session->socket.set_option(tcp::no_delay(true), ignored);
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        if (session->closed) {
+            return;
+        }
+        session->open = true;
+        if (!session->queued.empty() && !session->writing) {
+            session->writing = true;
+            boost::asio::post(session->socket.get_executor(), [this, session]() { Write(session); });
+        }
+    }
+    Read(session);
+}
+
+void AsioTransport::Read(const std::shared_ptr<Session>& session) {
+    if (session->buffer.size() - session->buffered < kReadChunk) {
+        session->buffer.resize(session->buffered + kReadChunk);
+    }
+    auto space = boost::asio::buffer(session->buffer.data() + session->buffered,
+                                     session->buffer.size() - session->buffered);
+    session->socket.async_read_some(space, [this, session](const boost::system::error_code& ec, size_t bytes) {
+        if (ec) {
+            Drop(session);
+            return;
+        }
+        session->buffered += bytes;
+
+        // Hand out every whole frame in the buffer, straight from it
+        size_t offset = 0;
+        while (session->buffered - offset >= kLengthSize) {
+            const uint8_t* header = session->buffer.data() + offset;
+            size_t length = ReadLength(header);
+            if (length > maxFrameSize_) {
+                Drop(session); // No way to skip it without reading it in
+                return;
+            }
+            if (session->buffered - offset - kLengthSize < length) {
+                break;
+            }
+            if (frameHandler_) {
+                frameHandler_(session->id, std::span<const uint8_t>(header + kLengthSize, length));
+            }
+            offset += kLengthSize + length;
+        }
+
+        // Keep the partial frame at the front, with room for all of it
+        if (offset > 0) {
+            std::memmove(session->buffer.data(), session->buffer.data() + offset, session->buffered - offset);
+            session->buffered -= offset;
+        }
+        if (session->buffered >= kLengthSize) {
+            size_t length = ReadLength(session->buffer.data());
+            if (session->buffer.size() < kLengthSize + length) {
+                session->buffer.resize(kLengthSize + length);
+            }
+        }
+
+        bool closed;
+        {
+            std::lock_guard<std::mutex> lock(sessionsMutex_);
+            closed = session->closed;
+        }
+        if (!closed) {
+            Read(session);
+        }
+    });
+}
+
+void AsioTransport::Write(const std::shared_ptr<Session>& session) {
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        if (session->closed || session->queued.empty()) {
+            session->writing = false;
+            return;
+        }
+        session->inFlight.swap(session->queued);
+        session->queuedBytes = 0;
+    }
+
+    std::vector<boost::asio::const_buffer> buffers;
+    buffers.reserve(session->inFlight.size());
+    for (const auto& frame : session->inFlight) {
+        buffers.push_back(boost::asio::buffer(frame));
+    }
+    boost::asio::async_write(session->socket, buffers, [this, session](const boost::system::error_code& ec, size_t) {
+        session->inFlight.clear();
+        if (ec) {
+            Drop(session);
+            return;
+        }
+        Write(session);
+    });
+}
+
+void AsioTransport::Drop(const std::shared_ptr<Session>& session) {
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        if (session->closed) {
+            return;
+        }
+        session->closed = true;
+        sessions_.erase(session->id);
+    }
+    boost::system::error_code ignored;
+    session->socket.close(ignored);
+    if (connectionHandler_) {
+        connectionHandler_(session->id, false);
+    }
+}
+
+} // namespace p2p
@@ -0,0 +1,137 @@
+#include "ChannelManager.hpp"
+#include <algorithm>
+
+namespace p2p {
+
+ChannelManager::ChannelManager() = default;
+ChannelManager::~ChannelManager() = default;
+
+ChannelId ChannelManager::GetChannelId(const std::string& name) {
+    // FNV-1a, so every peer derives the same ID from the channel name
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool ChannelManager::IsValidChannelName(const std::string& name) {
+    if (name.size() < 2 || name.size() > 64 || name[0] != '#') {
+        return false;
+    }
+    return std::none_of(name.begin(), name.end(), [](unsigned char c) {
+        return c <= ' ' || c == 0x7F;
+    });
+}
+
+bool ChannelManager::Join(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& channel = channels_[GetChannelId(name)];
+    channel.name = name;
+    if (channel.joined) {
+        return false;
+    }
+    channel.joined = true;
+    return true;
+}
+
+bool ChannelManager::Part(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto id = GetChannelId(name);
+    auto it = channels_.find(id);
+    if (it == channels_.end() || !it->second.joined) {
+        return false;
+    }
+    it->second.joined = false;
+    EraseIfUnused(id);
+    return true;
+}
+
+bool ChannelManager::IsJoined(ChannelId channelId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(channelId);
+    return it != channels_.end() && it->second.joined;
+}
+
+std::vector<std::string> ChannelManager::GetJoinedChannels() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> result;
+    for (const auto& [id, channel] : channels_) {
+        if (channel.joined) {
+            result.push_back(channel.name);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void ChannelManager::AddMember(const std::string& name, PeerHandle peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& channel = channels_[GetChannelId(name)];
+    channel.name = name;
+
+    auto& members = channel.members;
+    auto it = std::lower_bound(members.begin(), members.end(), peer);
+    if (it == members.end() || *it != peer) {
+        members.insert(it, peer);
+    }
+}
+
+void ChannelManager::RemoveMember(const std::string& name, PeerHandle peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto id = GetChannelId(name);
+    auto it = channels_.find(id);
+    if (it == channels_.end()) return;
+
+    auto& members = it->second.members;
+    auto memberIt = std::lower_bound(members.begin(), members.end(), peer);
+    if (memberIt != members.end() && *memberIt == peer) {
+        members.erase(memberIt);
+    }
+    EraseIfUnused(id);
+}
+
+void ChannelManager::RemovePeer(PeerHandle peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = channels_.begin(); it != channels_.end();) {
+        auto& members = it->second.members;
+        auto memberIt = std::lower_bound(members.begin(), members.end(), peer);
+        if (memberIt != members.end() && *memberIt == peer) {
+            members.erase(memberIt);
+        }
+
+        if (!it->second.joined && members.empty()) {
+            it = channels_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::vector<PeerHandle> ChannelManager::GetMembers(ChannelId channelId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(channelId);
+    if (it != channels_.end()) {
+        return it->second.members;
+    }
+    return {};
+}
+
+std::optional<std::string> ChannelManager::GetChannelName(ChannelId channelId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(channelId);
+    if (it != channels_.end()) {
+        return it->second.name;
+    }
+    return std::nullopt;
+}
+
+void ChannelManager::EraseIfUnused(ChannelId channelId) {
+    auto it = channels_.find(channelId);
+    if (it != channels_.end() && !it->second.joined && it->second.members.empty()) {
+        channels_.erase(it);
+    }
+}
+
+} // namespace p2p
@@ -3,6 +3,8 @@
 #include "PeerManager.hpp"
 #include "Crypto.hpp"
 #include "Message.hpp"
+#include "MessageSchema.hpp"
+#include "ChannelManager.hpp"
 #include <rang.hpp>
 #include <replxx.hxx>
 #include <iostream>
@@ -19,6 +21,8 @@ struct CLIInterface::Impl {
     NetworkManager& network;
     PeerManager& peerManager;
     CryptoManager& crypto;
+    ChannelManager channels;
+    std::string activeChannel;
     replxx::Replxx rx;
     std::atomic<bool> running{false};
     std::unordered_map<std::string, CommandHandler> commands;
@@ -81,33 +85,76 @@ void CLIInterface::Run() {
     DisplaySystemMessage("P2P Chat System Started");
     DisplaySystemMessage("Type 'help' for available commands");
     
-    // Set up message handler
-    pImpl_->network.SetMessageHandler([this](const std::string& peerId, const Message& msg) {
-        if (msg.GetType() == MessageType::TEXT) {
-            std::string text(msg.GetPayload().begin(), msg.GetPayload().end());
-            DisplayMessage(peerId, text, true);
-        } else if (msg.GetType() == MessageType::HANDSHAKE) {
-            // Handle handshake
-            auto payload = msg.GetPayload();
-            if (payload.size() >= 2) {
-                uint16_t idLen = (static_cast<uint16_t>(payload[0]) << 8) | payload[1];
-                if (payload.size() >= static_cast<size_t>(2 + idLen)) {
-                    std::string peerId(payload.begin() + 2, payload.begin() + 2 + idLen);
-                    std::vector<uint8_t> publicKey(payload.begin() + 2 + idLen, payload.end());
-                    
-                    // NetworkManager handles peer creation with proper address/port
-                    DisplaySystemMessage("Handshake received from " + peerId);
-                }
+    // Subscribe to the message types the CLI displays
+    auto& network = pImpl_->network;
+    network.On<MessageType::TEXT>([this](PeerHandle peer, const Message& msg) {
+        if (auto text = schema::Text::Parse(msg)) {
+            DisplayMessage(peer, std::string(text->Get<schema::Text::kText>()), true);
+        }
+    });
+    
+    network.On<MessageType::HANDSHAKE>([this](PeerHandle peer, const Message&) {
+        // NetworkManager handles peer creation with proper address/port
+        DisplaySystemMessage("Handshake received from " + pImpl_->peerManager.GetPeerId(peer));
+    });
+    
+    // Join and part share a layout
+    auto onChannelAnnouncement = [this](bool joined) {
+        return [this, joined](PeerHandle peer, const Message& msg) {
+            auto announcement = schema::ChannelJoin::Parse(
+                std::span<const uint8_t>(msg.GetPayload().data(), msg.GetPayload().size()));
+            if (!announcement) {
+                return;
             }
+            std::string channel(announcement->Get<schema::ChannelJoin::kChannel>());
+            if (!ChannelManager::IsValidChannelName(channel)) {
+                return;
+            }
+            
+            if (joined) {
+                pImpl_->channels.AddMember(channel, peer);
+            } else {
+                pImpl_->channels.RemoveMember(channel, peer);
+            }
+            
+            if (pImpl_->channels.IsJoined(ChannelManager::GetChannelId(channel))) {
+                const auto& peerId = pImpl_->peerManager.GetPeerId(peer);
+                DisplaySystemMessage(peerId.substr(0, 8) + (joined ? " joined " : " left ") + channel);
+            }
+        };
+    };
+    network.On<MessageType::CHANNEL_JOIN>(onChannelAnnouncement(true));
+    network.On<MessageType::CHANNEL_PART>(onChannelAnnouncement(false));
+    
+    network.On<MessageType::CHANNEL_TEXT>([this](PeerHandle peer, const Message& msg) {
+        auto channelText = schema::ChannelText::Parse(msg);
+        if (!channelText) {
+            return;
         }
+        ChannelId channelId = channelText->Get<schema::ChannelText::kChannelId>();
+        
+        // Only members receive channel traffic, but drop anything for channels we've left
+        if (!pImpl_->channels.IsJoined(channelId)) {
+            return;
+        }
+        auto channel = pImpl_->channels.GetChannelName(channelId);
+        std::string text(channelText->Get<schema::ChannelText::kText>());
+        DisplayChannelMessage(channel.value_or("#?"), pImpl_->peerManager.GetPeerId(peer), text, true);
     });
     
     // Set up connection handler
-    pImpl_->network.SetConnectionHandler([this](const std::string& peerId, bool connected) {
-        pImpl_->peerManager.UpdatePeerStatus(peerId, connected);
+    pImpl_->network.SetConnectionHandler([this](PeerHandle peer, bool connected) {
+        pImpl_->peerManager.UpdatePeerStatus(peer, connected);
+        const auto& peerId = pImpl_->peerManager.GetPeerId(peer);
         if (connected) {
             DisplaySuccess("Connected to peer: " + peerId);
+            
+            // Tell the new peer which channels we're in
+            for (const auto& channel : pImpl_->channels.GetJoinedChannels()) {
+                pImpl_->network.SendMessage(peer, Message::CreateChannelJoinMessage(channel));
+            }
         } else {
+            pImpl_->channels.RemovePeer(peer);
             DisplayWarning("Disconnected from peer: " + peerId);
         }
     });
@@ -167,6 +214,33 @@ void CLIInterface::DisplayMessage(const std::string& peerId, const std::string&
     });
 }
 
+void CLIInterface::DisplayMessage(PeerHandle peer, const std::string& message, bool incoming) {
+    DisplayMessage(pImpl_->peerManager.GetPeerId(peer), message, incoming);
+}
+
+void CLIInterface::DisplayChannelMessage(const std::string& channel, const std::string& peerId,
+                                         const std::string& message, bool incoming) {
+    pImpl_->queueDisplay([=]() {
+        auto now = std::chrono::system_clock::now();
+        auto time_t = std::chrono::system_clock::to_time_t(now);
+        auto tm = *std::localtime(&time_t);
+        
+        std::cout << rang::style::dim << "[" 
+                  << std::put_time(&tm, "%H:%M:%S") << "] " 
+                  << rang::style::reset
+                  << rang::fg::magenta << channel << rang::style::reset << " ";
+        
+        if (incoming) {
+            std::cout << rang::fg::cyan << peerId.substr(0, 8);
+        } else {
+            std::cout << rang::fg::green << "You";
+        }
+        
+        std::cout << rang::style::reset << ": "
+                  << rang::fg::yellow << message << rang::style::reset << std::endl;
+    });
+}
+
 void CLIInterface::DisplaySystemMessage(const std::string& message) {
     pImpl_->queueDisplay([=]() {
         std::cout << rang::fg::blue << "[SYSTEM] " 
@@ -209,6 +283,10 @@ void CLIInterface::RegisterCommands() {
     pImpl_->commands["quit"] = [this](const auto& args) { HandleQuit(args); };
     pImpl_->commands["exit"] = [this](const auto& args) { HandleQuit(args); };
     pImpl_->commands["info"] = [this](const auto& args) { HandleInfo(args); };
+    pImpl_->commands["join"] = [this](const auto& args) { HandleJoin(args); };
+    pImpl_->commands["part"] = [this](const auto& args) { HandlePart(args); };
+    pImpl_->commands["channels"] = [this](const auto& args) { HandleChannels(args); };
+    pImpl_->commands["relay"] = [this](const auto& args) { HandleRelay(args); };
 }
 
 void CLIInterface::ProcessCommand(const std::string& input) {
@@ -218,6 +296,9 @@ void CLIInterface::ProcessCommand(const std::string& input) {
     auto it = pImpl_->commands.find(args[0]);
     if (it != pImpl_->commands.end()) {
         it->second(args);
+    } else if (!pImpl_->activeChannel.empty()) {
+        // Unrecognized input goes to the active channel once one is joined
+        SendChannelText(pImpl_->activeChannel, input);
     } else {
         // Treat unrecognized input as broadcast message
         auto msg = Message::CreateTextMessage(input);
@@ -244,17 +325,35 @@ std::vector<std::string> CLIInterface::ParseCommand(const std::string& input) {
 }
 
 void CLIInterface::HandleConnect(const std::vector<std::string>& args) {
+    // A full endpoint, e.g. ipc:///tmp/chat.ipc
+    if (args.size() >= 2 && args[1].find("://") != std::string::npos) {
+        try {
+            pImpl_->network.ConnectToPeer(args[1], args.size() > 2 ? args[2] : "");
+            DisplaySystemMessage("Connecting to " + args[1] + "...");
+        } catch (const std::exception& e) {
+            DisplayError(e.what());
+        }
+        return;
+    }
+    
     if (args.size() < 3) {
-        DisplayError("Usage: connect <address> <port>");
+        DisplayError("Usage: connect <address> <port> [curve_key] | connect <endpoint> [curve_key]");
         return;
     }
     
+    uint16_t port;
     try {
-        uint16_t port = static_cast<uint16_t>(std::stoul(args[2]));
-        pImpl_->network.ConnectToPeer(args[1], port);
-        DisplaySystemMessage("Connecting to " + args[1] + ":" + args[2] + "...");
+        port = static_cast<uint16_t>(std::stoul(args[2]));
     } catch (const std::exception& e) {
         DisplayError("Invalid port number");
+        return;
+    }
+    
+    try {
+        pImpl_->network.ConnectToPeer(args[1], port, args.size() > 3 ? args[3] : "");
+        DisplaySystemMessage("Connecting to " + args[1] + ":" + args[2] + "...");
+    } catch (const std::exception& e) {
+        DisplayError(e.what());
     }
 }
 
@@ -285,11 +384,13 @@ void CLIInterface::HandleList(const std::vector<std::string>& args) {
             statusStream << rang::fg::red << "[OFFLINE]";
         }
         std::string status = statusStream.str();
+        std::string address = peer.host.empty() ? peer.endpoint.ToString()
+                                                : peer.host + ":" + std::to_string(peer.endpoint.GetPort());
         
         pImpl_->queueDisplay([=]() {
             std::cout << "  " << status << rang::style::reset 
                       << " " << peer.id << " - " 
-                      << peer.address << ":" << peer.port << std::endl;
+                      << address << std::endl;
         });
     }
 }
@@ -306,6 +407,11 @@ void CLIInterface::HandleSend(const std::vector<std::string>& args) {
         message += args[i];
     }
     
+    if (args[1][0] == '#') {
+        SendChannelText(args[1], message);
+        return;
+    }
+    
     auto msg = Message::CreateTextMessage(message);
     pImpl_->network.SendMessage(args[1], msg);
     DisplayMessage(args[1], message, false);
@@ -331,15 +437,22 @@ void CLIInterface::HandleBroadcast(const std::vector<std::string>& args) {
 void CLIInterface::HandleHelp(const std::vector<std::string>& args) {
     DisplaySystemMessage("Available commands:");
     pImpl_->queueDisplay([]() {
-        std::cout << "  connect <address> <port> - Connect to a peer\n"
+        std::cout << "  connect <address> <port> [curve_key] - Connect to a peer\n"
+                  << "  connect <endpoint> [curve_key] - Connect over tcp://, ipc:// or inproc://\n"
                   << "  disconnect <peer_id>     - Disconnect from a peer\n"
                   << "  list                     - List all peers\n"
                   << "  send <peer_id> <message> - Send message to a peer\n"
+                  << "  send <#channel> <message>- Send message to a channel\n"
                   << "  broadcast <message>      - Send message to all peers\n"
+                  << "  relay <via> <peer_id> <message> - Send via a relay peer\n"
+                  << "  join <#channel>          - Join a channel and make it active\n"
+                  << "  part [#channel]          - Leave a channel (default: active)\n"
+                  << "  channels                 - List joined channels and members\n"
                   << "  info                     - Show local peer information\n"
                   << "  help                     - Show this help\n"
                   << "  quit/exit                - Exit the program\n"
-                  << "\nNote: Any text that is not a command is sent as a broadcast message.\n";
+                  << "\nNote: Any text that is not a command is sent to the active channel,\n"
+                  << "      or as a broadcast message when no channel is active.\n";
     });
 }
 
@@ -350,12 +463,98 @@ void CLIInterface::HandleQuit(const std::vector<std::string>& args) {
 
 void CLIInterface::HandleInfo(const std::vector<std::string>& args) {
     auto localPeer = pImpl_->peerManager.GetLocalPeer();
+    auto relayed = pImpl_->network.GetRelayedMessageCount();
+    auto curveKey = pImpl_->network.GetCurvePublicKey();
     DisplaySystemMessage("Local peer information:");
     pImpl_->queueDisplay([=]() {
         std::cout << "  ID: " << localPeer.id << "\n"
-                  << "  Address: " << localPeer.address << ":" << localPeer.port << "\n"
-                  << "  Public Key Size: " << localPeer.publicKey.size() << " bytes\n";
+                  << "  Address: " << localPeer.endpoint.ToString() << "\n"
+                  << "  Public Key Size: " << localPeer.publicKey.size() << " bytes\n"
+                  << "  CURVE Key: " << (curveKey.empty() ? "disabled" : curveKey) << "\n"
+                  << "  Relayed Messages: " << relayed << "\n";
     });
 }
 
+void CLIInterface::HandleJoin(const std::vector<std::string>& args) {
+    if (args.size() < 2 || !ChannelManager::IsValidChannelName(args[1])) {
+        DisplayError("Usage: join <#channel>");
+        return;
+    }
+    
+    const auto& channel = args[1];
+    if (pImpl_->channels.Join(channel)) {
+        // Membership is announced to every peer; channel text only goes to members
+        pImpl_->network.BroadcastMessage(Message::CreateChannelJoinMessage(channel));
+    }
+    pImpl_->activeChannel = channel;
+    DisplaySystemMessage("Joined " + channel);
+}
+
+void CLIInterface::HandlePart(const std::vector<std::string>& args) {
+    std::string channel = args.size() >= 2 ? args[1] : pImpl_->activeChannel;
+    if (channel.empty()) {
+        DisplayError("Usage: part [#channel]");
+        return;
+    }
+    
+    if (!pImpl_->channels.Part(channel)) {
+        DisplayError("Not in channel " + channel);
+        return;
+    }
+    
+    pImpl_->network.BroadcastMessage(Message::CreateChannelPartMessage(channel));
+    if (pImpl_->activeChannel == channel) {
+        pImpl_->activeChannel.clear();
+    }
+    DisplaySystemMessage("Left " + channel);
+}
+
+void CLIInterface::HandleChannels(const std::vector<std::string>&) {
+    auto joined = pImpl_->channels.GetJoinedChannels();
+    if (joined.empty()) {
+        DisplaySystemMessage("Not in any channels");
+        return;
+    }
+    
+    DisplaySystemMessage("Joined channels:");
+    for (const auto& channel : joined) {
+        auto members = pImpl_->channels.GetMembers(ChannelManager::GetChannelId(channel));
+        bool active = channel == pImpl_->activeChannel;
+        
+        pImpl_->queueDisplay([=]() {
+            std::cout << "  " << (active ? "* " : "  ")
+                      << rang::fg::magenta << channel << rang::style::reset
+                      << " (" << members.size() << " remote members)" << std::endl;
+        });
+    }
+}
+
+void CLIInterface::SendChannelText(const std::string& channel, const std::string& text) {
+    auto channelId = ChannelManager::GetChannelId(channel);
+    if (!pImpl_->channels.IsJoined(channelId)) {
+        DisplayError("Not in channel " + channel + " (use: join " + channel + ")");
+        return;
+    }
+    
+    auto members = pImpl_->channels.GetMembers(channelId);
+    pImpl_->network.MulticastMessage(members, Message::CreateChannelTextMessage(channelId, text));
+    DisplayChannelMessage(channel, "", text, false);
+}
+
+void CLIInterface::HandleRelay(const std::vector<std::string>& args) {
+    if (args.size() < 4) {
+        DisplayError("Usage: relay <relay_peer_id> <peer_id> <message>");
+        return;
+    }
+    
+    std::string message;
+    for (size_t i = 3; i < args.size(); ++i) {
+        if (i > 3) message += " ";
+        message += args[i];
+    }
+    
+    pImpl_->network.SendViaRelay(args[1], args[2], Message::CreateTextMessage(message));
+    DisplayMessage(args[2], message, false);
+}
+
 } // namespace p2p
\ No newline at end of file
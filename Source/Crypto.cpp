@@ -1,4 +1,5 @@
 #include "Crypto.hpp"
+#include "Executor.hpp"
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 #include <openssl/pem.h>
@@ -9,6 +10,7 @@
 #include <openssl/ecdh.h>
 #include <openssl/ecdsa.h>
 #include <openssl/err.h>
+#include <openssl/kdf.h>
 #include <sstream>
 #include <iomanip>
 
@@ -262,6 +264,50 @@ bool CryptoManager::Verify(const std::vector<uint8_t>& data,
     return result == 1;
 }
 
+std::vector<uint8_t> CryptoManager::VerifyBatch(const std::vector<VerifyRequest>& requests,
+                                                Executor& executor) {
+    std::vector<uint8_t> results(requests.size(), 0);
+    executor.ParallelFor(requests.size(), [&](size_t i) {
+        const auto& request = requests[i];
+        results[i] = Verify(request.data, request.signature, request.publicKey) ? 1 : 0;
+    });
+    return results;
+}
+
+std::vector<uint8_t> CryptoManager::RandomBytes(size_t count) {
+    std::vector<uint8_t> bytes(count);
+    if (count > 0 && RAND_bytes(bytes.data(), static_cast<int>(count)) != 1) {
+        return {};
+    }
+    return bytes;
+}
+
+std::vector<uint8_t> CryptoManager::DeriveKey(const std::vector<uint8_t>& secret, std::string_view context,
+                                              size_t length) {
+    if (secret.empty()) {
+        return {};
+    }
+
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+    if (!ctx) {
+        return {};
+    }
+
+    std::vector<uint8_t> key(length);
+    size_t keyLen = length;
+    bool ok = EVP_PKEY_derive_init(ctx) > 0 &&
+              EVP_PKEY_CTX_set_hkdf_md(ctx, EVP_sha256()) > 0 &&
+              EVP_PKEY_CTX_set1_hkdf_key(ctx, secret.data(), static_cast<int>(secret.size())) > 0 &&
+              EVP_PKEY_CTX_add1_hkdf_info(ctx, reinterpret_cast<const unsigned char*>(context.data()),
+                                          static_cast<int>(context.size())) > 0 &&
+              EVP_PKEY_derive(ctx, key.data(), &keyLen) > 0 && keyLen == length;
+    EVP_PKEY_CTX_free(ctx);
+    if (!ok) {
+        return {};
+    }
+    return key;
+}
+
 std::string CryptoManager::GeneratePeerId(const std::vector<uint8_t>& publicKey) {
     unsigned char hash[SHA256_DIGEST_LENGTH];
     SHA256(publicKey.data(), publicKey.size(), hash);
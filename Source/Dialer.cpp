@@ -0,0 +1,158 @@
+#include "Dialer.hpp"
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <stdexcept>
+#include <system_error>
+
+namespace p2p {
+
+using boost::asio::ip::tcp;
+
+// One dial, on the I/O thread only
+struct Dialer::Race {
+    explicit Race(boost::asio::io_context& context) : stagger(context), deadline(context) {}
+
+    std::string host;
+    uint16_t port = 0;
+    Callback callback;
+    std::vector<tcp::endpoint> targets;
+    size_t next = 0;    // Next target to try
+    size_t pending = 0; // Attempts still connecting
+    bool done = false;
+    std::vector<std::shared_ptr<tcp::socket>> sockets;
+    boost::asio::steady_timer stagger;  // Starts the next attempt
+    boost::asio::steady_timer deadline;
+    boost::system::error_code lastError;
+};
+
+Dialer::Dialer(ResolverCache::Lookup lookup, size_t lookupThreads)
+    : resolver_(std::make_unique<ResolverCache>(lookupThreads, std::move(lookup))) {
+    thread_ = std::thread([this]() { context_.run(); });
+}
+
+Dialer::~Dialer() {
+    // Joins the lookups first, so none posts to the I/O thread as it goes
+    resolver_.reset();
+    work_.reset();
+    context_.stop();
+    thread_.join();
+}
+
+void Dialer::Dial(const std::string& host, uint16_t port, Callback callback) {
+    auto race = std::make_shared<Race>(context_);
+    race->host = host;
+    race->port = port;
+    race->callback = std::move(callback);
+
+    resolver_->Resolve(host, [this, race](const ResolverCache::Addresses& addresses, std::exception_ptr error) {
+        boost::asio::post(context_, [this, race, addresses, error]() {
+            if (error) {
+                Finish(race, {}, error);
+                return;
+            }
+            Begin(race, addresses);
+        });
+    });
+}
+
+void Dialer::Begin(const std::shared_ptr<Race>& race, const ResolverCache::Addresses& addresses) {
+    for (const auto& address : Interleave(addresses)) {
+        boost::system::error_code ec;
+        auto ip = boost::asio::ip::make_address(address, ec);
+        if (!ec) {
+            race->targets.emplace_back(ip, race->port);
+        }
+    }
+    if (race->targets.empty()) {
+        Finish(race, {}, std::make_exception_ptr(std::runtime_error("No usable addresses for " + race->host)));
+        return;
+    }
+
+    race->deadline.expires_after(timeout_);
+    race->deadline.async_wait([this, race](const boost::system::error_code& ec) {
+        if (!ec && !race->done) {
+            Finish(race, {}, std::make_exception_ptr(std::runtime_error(
+                "Timed out connecting to " + race->host + ":" + std::to_string(race->port))));
+        }
+    });
+    Attempt(race);
+}
+
+void Dialer::Attempt(const std::shared_ptr<Race>& race) {
+    if (race->done || race->next == race->targets.size()) {
+        return;
+    }
+
+    auto target = race->targets[race->next++];
+    auto socket = std::make_shared<tcp::socket>(context_);
+    race->sockets.push_back(socket);
+    ++race->pending;
+    socket->async_connect(target, [this, race, target](const boost::system::error_code& ec) {
+        --race->pending;
+        if (race->done) {
+            return;
+        }
+        if (!ec) {
+            Finish(race, target.address().to_string(), nullptr);
+            return;
+        }
+
+        // A failure starts the next address straight away
+        race->lastError = ec;
+        if (race->next < race->targets.size()) {
+            Attempt(race);
+        } else if (race->pending == 0) {
+            Finish(race, {}, std::make_exception_ptr(std::system_error(ec,
+                "Can't connect to " + race->host + ":" + std::to_string(race->port))));
+        }
+    });
+
+    // Re-arming cancels the previous wait, so only the newest attempt's timer runs
+    if (race->next < race->targets.size()) {
+        race->stagger.expires_after(attemptDelay_);
+        race->stagger.async_wait([this, race](const boost::system::error_code& ec) {
+            if (!ec) {
+                Attempt(race);
+            }
+        });
+    }
+}
+
+void Dialer::Finish(const std::shared_ptr<Race>& race, const std::string& address, std::exception_ptr error) {
+    race->done = true;
+    race->stagger.cancel();
+    race->deadline.cancel();
+    for (auto& socket : race->sockets) {
+        boost::system::error_code ignored;
+        socket->close(ignored);
+    }
+    race->sockets.clear();
+
+    auto callback = std::move(race->callback);
+    if (callback) {
+        callback(address, error);
+    }
+}
+
+std::vector<std::string> Dialer::Interleave(const std::vector<std::string>& addresses) {
+    std::vector<std::string> v6;
+    std::vector<std::string> v4;
+    for (const auto& address : addresses) {
+        (address.find(':') != std::string::npos ? v6 : v4).push_back(address);
+    }
+
+    bool v6First = !addresses.empty() && addresses.front().find(':') != std::string::npos;
+    auto& first = v6First ? v6 : v4;
+    auto& second = v6First ? v4 : v6;
+
+    std::vector<std::string> ordered;
+    ordered.reserve(addresses.size());
+    for (size_t i = 0; i < first.size() || i < second.size(); ++i) {
+        if (i < first.size()) ordered.push_back(first[i]);
+        if (i < second.size()) ordered.push_back(second[i]);
+    }
+    return ordered;
+}
+
+} // namespace p2p
@@ -0,0 +1,106 @@
+#include "Endpoint.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <arpa/inet.h>
+
+namespace p2p {
+
+// ::ffff:0:0/96, the prefix of an IPv4-mapped address
+static constexpr std::array<uint8_t, 12> kMappedPrefix = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+
+Endpoint Endpoint::FromIpv4(uint32_t address, uint16_t port) {
+    Address bytes{};
+    std::copy(kMappedPrefix.begin(), kMappedPrefix.end(), bytes.begin());
+    bytes[12] = static_cast<uint8_t>(address >> 24);
+    bytes[13] = static_cast<uint8_t>(address >> 16);
+    bytes[14] = static_cast<uint8_t>(address >> 8);
+    bytes[15] = static_cast<uint8_t>(address);
+    return Endpoint(bytes, port);
+}
+
+std::optional<Endpoint> Endpoint::FromAddress(std::string_view address, uint16_t port) {
+    if (address.size() > 2 && address.front() == '[' && address.back() == ']') {
+        address = address.substr(1, address.size() - 2);
+    }
+    if (address.empty() || address.size() >= INET6_ADDRSTRLEN) {
+        return std::nullopt;
+    }
+    char text[INET6_ADDRSTRLEN] = {};
+    std::memcpy(text, address.data(), address.size());
+
+    in_addr v4;
+    if (inet_pton(AF_INET, text, &v4) == 1) {
+        return FromIpv4(ntohl(v4.s_addr), port);
+    }
+    Address bytes;
+    if (inet_pton(AF_INET6, text, bytes.data()) == 1) {
+        return Endpoint(bytes, port);
+    }
+    return std::nullopt;
+}
+
+std::optional<Endpoint> Endpoint::Parse(std::string_view text) {
+    if (text.starts_with("tcp://")) {
+        text.remove_prefix(6);
+    }
+    auto colon = text.rfind(':');
+    if (colon == std::string_view::npos) {
+        return std::nullopt;
+    }
+    auto host = text.substr(0, colon);
+    // An unbracketed IPv6 address has colons of its own, so the port is ambiguous
+    if (host.find(':') != std::string_view::npos && !host.starts_with('[')) {
+        return std::nullopt;
+    }
+
+    uint16_t port = 0;
+    auto digits = text.substr(colon + 1);
+    auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), port);
+    if (digits.empty() || error != std::errc() || end != digits.data() + digits.size()) {
+        return std::nullopt;
+    }
+    return FromAddress(host, port);
+}
+
+bool Endpoint::IsIpv4() const {
+    return std::equal(kMappedPrefix.begin(), kMappedPrefix.end(), address_.begin());
+}
+
+bool Endpoint::IsLoopback() const {
+    if (IsIpv4()) {
+        return address_[12] == 127;
+    }
+    static constexpr Address kIpv6Loopback = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+    return address_ == kIpv6Loopback;
+}
+
+bool Endpoint::IsUnspecified() const {
+    auto begin = address_.begin() + (IsIpv4() ? kMappedPrefix.size() : 0);
+    return std::all_of(begin, address_.end(), [](uint8_t byte) { return byte == 0; });
+}
+
+std::string Endpoint::AddressString() const {
+    char text[INET6_ADDRSTRLEN] = {};
+    if (IsIpv4()) {
+        inet_ntop(AF_INET, address_.data() + kMappedPrefix.size(), text, sizeof(text));
+    } else {
+        inet_ntop(AF_INET6, address_.data(), text, sizeof(text));
+    }
+    return text;
+}
+
+std::string Endpoint::ToString() const {
+    auto port = std::to_string(port_);
+    return IsIpv4() ? AddressString() + ":" + port : "[" + AddressString() + "]:" + port;
+}
+
+size_t EndpointHash::operator()(const Endpoint& endpoint) const noexcept {
+    uint64_t high;
+    uint64_t low;
+    std::memcpy(&high, endpoint.GetAddress().data(), sizeof(high));
+    std::memcpy(&low, endpoint.GetAddress().data() + sizeof(high), sizeof(low));
+    return static_cast<size_t>((high * 0x9E3779B97F4A7C15ull) ^ low ^ (uint64_t(endpoint.GetPort()) << 48));
+}
+
+} // namespace p2p
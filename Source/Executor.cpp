@@ -0,0 +1,409 @@
+#include "Executor.hpp"
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <utility>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace p2p {
+
+namespace {
+
+// Set on executor threads, so Submit can find the calling worker's deque
+thread_local const Executor* tExecutor = nullptr;
+thread_local size_t tWorkerIndex = 0;
+
+// Worker loops that find nothing before parking
+constexpr int kSpinRounds = 64;
+
+// Every this many tasks a worker checks the shared queue before its own deque
+constexpr uint32_t kSharedCheckInterval = 32;
+
+// Chase-Lev deque. Only the owning worker pushes and pops at the bottom;
+// any thread may steal from the top. Arrays replaced by growth are kept
+// until the deque is destroyed, since a thief may still be reading one.
+class WorkStealingDeque {
+public:
+    using Task = Executor::Task;
+
+    WorkStealingDeque() {
+        arrays_.push_back(std::make_unique<Array>(kInitialCapacity));
+        array_.store(arrays_.back().get(), std::memory_order_relaxed);
+    }
+
+    ~WorkStealingDeque() {
+        while (Task* task = Pop()) {
+            delete task;
+        }
+    }
+
+    void Push(Task* task) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        Array* array = array_.load(std::memory_order_relaxed);
+        if (bottom - top >= static_cast<int64_t>(array->capacity)) {
+            array = Grow(array, top, bottom);
+        }
+        array->Put(bottom, task);
+        bottom_.store(bottom + 1, std::memory_order_release);
+    }
+
+    Task* Pop() {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        Array* array = array_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_seq_cst);
+
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Task* task = array->Get(bottom);
+        if (top == bottom) {
+            // Last task: race the thieves for it
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                task = nullptr;
+            }
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    Task* Steal() {
+        int64_t top = top_.load(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_seq_cst);
+        if (top >= bottom) {
+            return nullptr;
+        }
+
+        Task* task = array_.load(std::memory_order_acquire)->Get(top);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr; // Lost to the owner or another thief
+        }
+        return task;
+    }
+
+private:
+    static constexpr size_t kInitialCapacity = 256;
+
+    struct Array {
+        explicit Array(size_t capacity)
+            : capacity(capacity), slots(std::make_unique<std::atomic<Task*>[]>(capacity)) {}
+
+        Task* Get(int64_t index) const {
+            return slots[static_cast<size_t>(index) & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+        void Put(int64_t index, Task* task) {
+            slots[static_cast<size_t>(index) & (capacity - 1)].store(task, std::memory_order_relaxed);
+        }
+
+        size_t capacity; // Power of two
+        std::unique_ptr<std::atomic<Task*>[]> slots;
+    };
+
+    Array* Grow(Array* array, int64_t top, int64_t bottom) {
+        auto grown = std::make_unique<Array>(array->capacity * 2);
+        for (int64_t i = top; i < bottom; ++i) {
+            grown->Put(i, array->Get(i));
+        }
+        arrays_.push_back(std::move(grown));
+        array_.store(arrays_.back().get(), std::memory_order_release);
+        return arrays_.back().get();
+    }
+
+    std::atomic<int64_t> top_{0};
+    std::atomic<int64_t> bottom_{0};
+    std::atomic<Array*> array_{nullptr};
+    std::vector<std::unique_ptr<Array>> arrays_; // Owner only
+};
+
+// Allowed CPUs as (node, cpu), grouped by NUMA node
+std::vector<std::pair<int, int>> GetCpuTopology() {
+    std::vector<std::pair<int, int>> cpus;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return cpus;
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+
+        // On NUMA systems the CPU's sysfs directory links to its nodeN
+        int node = 0;
+        std::error_code ec;
+        std::filesystem::directory_iterator it("/sys/devices/system/cpu/cpu" + std::to_string(cpu), ec);
+        for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            auto name = it->path().filename().string();
+            if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+                std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+                node = std::stoi(name.substr(4));
+                break;
+            }
+        }
+        cpus.emplace_back(node, cpu);
+    }
+    std::sort(cpus.begin(), cpus.end());
+#endif
+    return cpus;
+}
+
+} // namespace
+
+class Executor::Worker {
+public:
+    explicit Worker(size_t index) : index(index) {}
+
+    WorkStealingDeque deque;
+    size_t index;
+    int node = 0;
+    int cpu = -1;                // Pinned CPU, if pinning
+    std::vector<size_t> victims; // Steal order: same node first
+    uint32_t ticks = 0;
+};
+
+Executor::Executor() : Executor(GetDefaultWorkerCount()) {}
+
+Executor::Executor(size_t workerCount, bool pinThreads)
+    : workerCount_(std::max<size_t>(workerCount, 1)), pinThreads_(pinThreads) {
+    auto cpus = pinThreads_ ? GetCpuTopology() : std::vector<std::pair<int, int>>{};
+
+    for (size_t i = 0; i < workerCount_; ++i) {
+        auto worker = std::make_unique<Worker>(i);
+        if (!cpus.empty()) {
+            worker->node = cpus[i % cpus.size()].first;
+            worker->cpu = cpus[i % cpus.size()].second;
+        }
+        workers_.push_back(std::move(worker));
+    }
+
+    // Start each steal scan just past the thief, so thieves spread across victims
+    for (auto& worker : workers_) {
+        for (int pass = 0; pass < 2; ++pass) {
+            for (size_t offset = 1; offset < workerCount_; ++offset) {
+                size_t victim = (worker->index + offset) % workerCount_;
+                bool sameNode = workers_[victim]->node == worker->node;
+                if (sameNode == (pass == 0)) {
+                    worker->victims.push_back(victim);
+                }
+            }
+        }
+    }
+}
+
+Executor::~Executor() {
+    Stop();
+    for (Task* task : sharedQueue_) {
+        delete task;
+    }
+}
+
+size_t Executor::GetDefaultWorkerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool Executor::IsWorkerThread() const {
+    return tExecutor == this;
+}
+
+void Executor::Start() {
+    if (running_.exchange(true)) return;
+
+    for (auto& worker : workers_) {
+        threads_.emplace_back([this, &worker]() { RunWorker(*worker); });
+    }
+}
+
+void Executor::Stop() {
+    if (!running_.exchange(false)) return;
+
+    {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+    }
+    parked_.notify_all();
+
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+}
+
+void Executor::Submit(Task task) {
+    Enqueue(new Task(std::move(task)), !IsWorkerThread());
+}
+
+void Executor::Defer(Task task) {
+    Enqueue(new Task(std::move(task)), true);
+}
+
+void Executor::Enqueue(Task* task, bool shared) {
+    // Counted first, so a worker that sees zero can't miss a queued task
+    queued_.fetch_add(1, std::memory_order_seq_cst);
+    if (shared) {
+        std::lock_guard<std::mutex> lock(sharedMutex_);
+        sharedQueue_.push_back(task);
+        sharedSize_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        workers_[tWorkerIndex]->deque.Push(task);
+    }
+    WakeOne();
+}
+
+void Executor::WakeOne() {
+    if (sleepers_.load(std::memory_order_seq_cst) == 0) return;
+
+    // Taking the lock orders this wakeup after a parking worker's predicate check
+    {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+    }
+    parked_.notify_one();
+}
+
+void Executor::ParallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) return;
+
+    // Helpers may start after the loop is done, so they share ownership of
+    // the state and never touch body once the indices run out
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        size_t count = 0;
+        const std::function<void(size_t)>* body = nullptr;
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    state->count = count;
+    state->body = &body;
+
+    auto run = [](State& s) {
+        for (size_t i = s.next.fetch_add(1); i < s.count; i = s.next.fetch_add(1)) {
+            try {
+                (*s.body)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                if (!s.error) {
+                    s.error = std::current_exception();
+                }
+            }
+            if (s.done.fetch_add(1) + 1 == s.count) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(count - 1, workerCount_);
+    for (size_t i = 0; i < helpers; ++i) {
+        Submit([state, run]() { run(*state); });
+    }
+    run(*state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->done.load() == count; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+void Executor::RunWorker(Worker& worker) {
+    tExecutor = this;
+    tWorkerIndex = worker.index;
+    if (pinThreads_) {
+        Pin(worker);
+    }
+
+    int idleRounds = 0;
+    while (true) {
+        if (Task* task = FindTask(worker)) {
+            queued_.fetch_sub(1, std::memory_order_seq_cst);
+            idleRounds = 0;
+            try {
+                (*task)();
+            } catch (const std::exception& e) {
+                std::cerr << "Executor task error: " << e.what() << std::endl;
+            }
+            delete task;
+            continue;
+        }
+
+        // Stop() drains: only leave once nothing is queued anywhere
+        if (!running_ && queued_.load() <= 0) {
+            break;
+        }
+
+        if (++idleRounds < kSpinRounds) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(parkMutex_);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        parked_.wait(lock, [this]() { return queued_.load() > 0 || !running_; });
+        sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+        idleRounds = 0;
+    }
+
+    tExecutor = nullptr;
+}
+
+Executor::Task* Executor::FindTask(Worker& worker) {
+    // Periodically favour the shared queue so outside submissions can't starve
+    if (++worker.ticks % kSharedCheckInterval == 0) {
+        if (Task* task = TakeShared()) return task;
+    }
+    if (Task* task = worker.deque.Pop()) return task;
+    if (Task* task = TakeShared()) return task;
+    return Steal(worker);
+}
+
+Executor::Task* Executor::TakeShared() {
+    if (sharedSize_.load(std::memory_order_relaxed) == 0) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(sharedMutex_);
+    if (sharedQueue_.empty()) {
+        return nullptr;
+    }
+    Task* task = sharedQueue_.front();
+    sharedQueue_.pop_front();
+    sharedSize_.fetch_sub(1, std::memory_order_relaxed);
+    return task;
+}
+
+Executor::Task* Executor::Steal(Worker& thief) {
+    for (size_t victim : thief.victims) {
+        if (Task* task = workers_[victim]->deque.Steal()) {
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void Executor::Pin(Worker& worker) {
+#ifdef __linux__
+    if (worker.cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(worker.cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)worker;
+#endif
+}
+
+} // namespace p2p
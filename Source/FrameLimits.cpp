@@ -0,0 +1,45 @@
+#include "FrameLimits.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace p2p {
+
+FrameLimits::FrameLimits(size_t maxFrameSize) {
+    SetMaxFrameSize(maxFrameSize);
+    maxPayload_.fill(std::numeric_limits<uint32_t>::max());
+
+    // Largest well-formed payload of each control type, rounded up
+    SetMaxPayloadSize(MessageType::PING, 0);
+    SetMaxPayloadSize(MessageType::PONG, 0);
+    SetMaxPayloadSize(MessageType::HANDSHAKE, 1024);
+    SetMaxPayloadSize(MessageType::AUTH_CHALLENGE, 1024);
+    SetMaxPayloadSize(MessageType::AUTH_RESPONSE, 256);
+    SetMaxPayloadSize(MessageType::KEY_EXCHANGE, 4096);
+    SetMaxPayloadSize(MessageType::CHANNEL_JOIN, 256);
+    SetMaxPayloadSize(MessageType::CHANNEL_PART, 256);
+    SetMaxPayloadSize(MessageType::PEER_LIST, 64 * 1024);
+}
+
+void FrameLimits::SetMaxFrameSize(size_t bytes) {
+    maxFrameSize_ = std::max(bytes, Message::kHeaderSize);
+}
+
+void FrameLimits::SetMaxPayloadSize(MessageType type, size_t bytes) {
+    maxPayload_[static_cast<uint8_t>(type)] =
+        static_cast<uint32_t>(std::min<size_t>(bytes, std::numeric_limits<uint32_t>::max()));
+}
+
+size_t FrameLimits::GetMaxPayloadSize(MessageType type) const {
+    return std::min<size_t>(maxPayload_[static_cast<uint8_t>(type)], maxFrameSize_ - Message::kHeaderSize);
+}
+
+std::optional<Message::Header> FrameLimits::Validate(const uint8_t* data, size_t size) const {
+    auto header = Message::PeekHeader(data, size);
+    if (!header || header->payloadSize > GetMaxPayloadSize(header->type) ||
+        size != Message::kHeaderSize + header->payloadSize) {
+        return std::nullopt;
+    }
+    return header;
+}
+
+} // namespace p2p
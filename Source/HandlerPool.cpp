@@ -0,0 +1,137 @@
+#include "HandlerPool.hpp"
+#include "Executor.hpp"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace p2p {
+
+HandlerPool::HandlerPool(Handler handler, size_t workerCount)
+    : handler_(std::move(handler)),
+      ownedExecutor_(std::make_unique<Executor>(workerCount)),
+      executor_(ownedExecutor_.get()) {}
+
+HandlerPool::HandlerPool(Handler handler, Executor& executor)
+    : handler_(std::move(handler)), executor_(&executor) {}
+
+HandlerPool::~HandlerPool() {
+    Stop();
+}
+
+size_t HandlerPool::GetDefaultWorkerCount() {
+    return std::clamp<size_t>(std::thread::hardware_concurrency(), 2, 8);
+}
+
+size_t HandlerPool::GetWorkerCount() const {
+    return executor_->GetWorkerCount();
+}
+
+void HandlerPool::Start() {
+    std::vector<uint32_t> waiting;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) return;
+        running_ = true;
+        waiting.swap(waiting_);
+    }
+
+    if (ownedExecutor_) {
+        ownedExecutor_->Start();
+    }
+    for (uint32_t index : waiting) {
+        executor_->Submit([this, index]() { Drain(index); });
+    }
+}
+
+void HandlerPool::Stop() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!running_) return;
+
+        // No drain task outlives the last pending message
+        idle_.wait(lock, [this]() { return pending_ == 0; });
+        running_ = false;
+    }
+
+    if (ownedExecutor_) {
+        ownedExecutor_->Stop();
+    }
+}
+
+void HandlerPool::Post(PeerHandle peer, const Message& msg) {
+    Enqueue(peer, Message(msg));
+}
+
+void HandlerPool::Post(PeerHandle peer, Message&& msg) {
+    Enqueue(peer, std::move(msg));
+}
+
+size_t HandlerPool::GetPendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+void HandlerPool::Enqueue(PeerHandle peer, Message&& msg) {
+    if (!peer) return;
+
+    uint32_t index = peer.GetIndex();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index >= mailboxes_.size()) {
+            mailboxes_.resize(index + 1);
+        }
+        auto& mailbox = mailboxes_[index];
+        mailbox.messages.push_back(std::move(msg));
+        ++pending_;
+
+        // A scheduled mailbox is already being drained
+        if (mailbox.scheduled) return;
+        mailbox.scheduled = true;
+        if (!running_) {
+            waiting_.push_back(index);
+            return;
+        }
+    }
+    executor_->Submit([this, index]() { Drain(index); });
+}
+
+// Only one drain task per mailbox exists at a time, so it owns the mailbox
+void HandlerPool::Drain(uint32_t index) {
+    std::vector<Message> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& messages = mailboxes_[index].messages;
+        size_t count = std::min(messages.size(), kMailboxBatch);
+        batch.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            batch.push_back(std::move(messages.front()));
+            messages.pop_front();
+        }
+    }
+
+    for (const auto& msg : batch) {
+        try {
+            handler_(PeerHandle(index), msg);
+        } catch (const std::exception& e) {
+            std::cerr << "Message handler error: " << e.what() << std::endl;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ -= batch.size();
+        auto& mailbox = mailboxes_[index];
+        if (mailbox.messages.empty()) {
+            mailbox.scheduled = false;
+            if (pending_ == 0) {
+                idle_.notify_all();
+            }
+            return;
+        }
+    }
+
+    // Requeue behind other work so one busy peer can't starve the others
+    executor_->Defer([this, index]() { Drain(index); });
+}
+
+} // namespace p2p
@@ -2,11 +2,13 @@
 #include "PeerManager.hpp"
 #include "Crypto.hpp"
 #include "CliInterface.hpp"
+#include "Executor.hpp"
 #include <boost/program_options.hpp>
 #include <iostream>
 #include <thread>
 #include <csignal>
 #include <atomic>
+#include <vector>
 
 namespace po = boost::program_options;
 
@@ -23,8 +25,12 @@ int main(int argc, char* argv[]) {
         desc.add_options()
             ("help,h", "Show help message")
             ("port,p", po::value<uint16_t>()->default_value(8080), "Local port to listen on")
-            ("connect,c", po::value<std::string>(), "Connect to peer (format: address:port)")
-            ("peers-file,f", po::value<std::string>()->default_value("peers.txt"), "File to save/load peers");
+            ("connect,c", po::value<std::string>(), "Connect to peer (format: address:port, [ipv6]:port, or an ipc:// or inproc:// endpoint)")
+            ("listen,l", po::value<std::vector<std::string>>(), "Also listen on this endpoint, e.g. ipc:///tmp/chat.ipc")
+            ("peers-file,f", po::value<std::string>()->default_value("peers.txt"), "File to save/load peers")
+            ("relay", "Forward messages between peers that can't reach each other")
+            ("curve", "Encrypt connections with CurveZMQ, keyed from the node key")
+            ("peer-key", po::value<std::string>(), "CURVE public key of the --connect peer");
         
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -42,10 +48,13 @@ int main(int argc, char* argv[]) {
         std::signal(SIGINT, signalHandler);
         std::signal(SIGTERM, signalHandler);
         
-        // Initialize components
+        // Initialize components; the executor outlives everything that submits to it
+        p2p::Executor executor;
+        executor.Start();
         p2p::CryptoManager crypto;
         p2p::PeerManager peerManager;
         p2p::NetworkManager network(peerManager);
+        network.SetExecutor(executor);
         
         // Generate local peer identity
         auto keyPair = crypto.GenerateKeyPair();
@@ -53,8 +62,7 @@ int main(int argc, char* argv[]) {
         
         p2p::PeerInfo localPeer;
         localPeer.id = peerId;
-        localPeer.address = "0.0.0.0";
-        localPeer.port = port;
+        localPeer.endpoint = p2p::Endpoint(port);
         localPeer.publicKey = keyPair.publicKey;
         localPeer.isConnected = true;
         peerManager.SetLocalPeer(localPeer);
@@ -66,18 +74,40 @@ int main(int argc, char* argv[]) {
         // Load peers from file
         peerManager.LoadPeersFromFile(peersFile);
         
+        // Peers prove they hold the key they present, and their ID must be its hash
+        network.SetIdentity(crypto, keyPair.privateKey);
+        network.SetHandshakeVerifier([&crypto](const std::string& id, const std::vector<uint8_t>& publicKey) {
+            return crypto.GeneratePeerId(publicKey) == id;
+        });
+        if (vm.count("curve")) {
+            network.SetCurveEnabled(true);
+            std::cout << "CURVE public key: " << network.GetCurvePublicKey() << std::endl;
+        }
+        
         // Start network
+        network.SetRelayEnabled(vm.count("relay") > 0);
+        if (vm.count("listen")) {
+            for (const auto& endpoint : vm["listen"].as<std::vector<std::string>>()) {
+                network.AddListenEndpoint(endpoint);
+            }
+        }
         network.Start(port);
         
         // Connect to initial peer if specified
         if (vm.count("connect")) {
             std::string connectStr = vm["connect"].as<std::string>();
-            size_t colonPos = connectStr.find(':');
-            if (colonPos != std::string::npos) {
+            std::string peerKey = vm.count("peer-key") ? vm["peer-key"].as<std::string>() : "";
+            size_t colonPos = connectStr.rfind(':');
+            if (connectStr.find("://") != std::string::npos) {
+                network.ConnectToPeer(connectStr, peerKey);
+            } else if (colonPos != std::string::npos) {
                 std::string address = connectStr.substr(0, colonPos);
+                if (address.size() > 2 && address.front() == '[' && address.back() == ']') {
+                    address = address.substr(1, address.size() - 2);
+                }
                 uint16_t peerPort = static_cast<uint16_t>(
                     std::stoul(connectStr.substr(colonPos + 1)));
-                network.ConnectToPeer(address, peerPort);
+                network.ConnectToPeer(address, peerPort, peerKey);
             }
         }
         
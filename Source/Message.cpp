@@ -1,4 +1,6 @@
 #include "Message.hpp"
+#include "MessageSchema.hpp"
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
 
@@ -7,103 +9,142 @@ namespace p2p {
 Message::Message(MessageType type, const std::vector<uint8_t>& payload)
     : type_(type), payload_(payload) {}
 
+Message::Message(MessageType type, std::vector<uint8_t>&& payload)
+    : type_(type), payload_(std::move(payload)) {}
+
+Message::Message(MessageType type, Payload&& payload)
+    : type_(type), payload_(std::move(payload)) {}
+
+Message::Message(MessageType type, Payload&& payload, std::chrono::system_clock::time_point timestamp)
+    : type_(type), payload_(std::move(payload)), timestamp_(timestamp) {}
+
 std::vector<uint8_t> Message::Serialize() const {
-    std::vector<uint8_t> result;
-    
+    std::vector<uint8_t> result(GetSerializedSize());
+    SerializeTo(result.data());
+    return result;
+}
+
+void Message::SerializeTo(uint8_t* out) const {
     // Header: [Type(1) | PayloadSize(4) | Timestamp(8)]
-    result.push_back(static_cast<uint8_t>(type_));
-    
-    uint32_t payloadSize = static_cast<uint32_t>(payload_.size());
-    result.push_back((payloadSize >> 24) & 0xFF);
-    result.push_back((payloadSize >> 16) & 0xFF);
-    result.push_back((payloadSize >> 8) & 0xFF);
-    result.push_back(payloadSize & 0xFF);
-    
     auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
         timestamp_.time_since_epoch()).count();
-    for (int i = 7; i >= 0; --i) {
-        result.push_back((timestamp >> (i * 8)) & 0xFF);
-    }
     
-    result.insert(result.end(), payload_.begin(), payload_.end());
+    out = schema::Uint<uint8_t>::Write(out, static_cast<uint8_t>(type_));
+    out = schema::Uint<uint32_t>::Write(out, static_cast<uint32_t>(payload_.size()));
+    out = schema::Uint<uint64_t>::Write(out, static_cast<uint64_t>(timestamp));
     
-    return result;
+    if (!payload_.empty()) {
+        std::memcpy(out, payload_.data(), payload_.size());
+    }
 }
 
 Message Message::Deserialize(const std::vector<uint8_t>& data) {
-    if (data.size() < 13) {
+    return Deserialize(data.data(), data.size());
+}
+
+Message Message::Deserialize(const uint8_t* data, size_t size,
+                             std::pmr::memory_resource* resource) {
+    auto header = PeekHeader(data, size);
+    if (!header) {
         throw std::runtime_error("Invalid message: too short");
     }
     
-    Message msg;
-    msg.type_ = static_cast<MessageType>(data[0]);
-    
-    uint32_t payloadSize = (static_cast<uint32_t>(data[1]) << 24) |
-                          (static_cast<uint32_t>(data[2]) << 16) |
-                          (static_cast<uint32_t>(data[3]) << 8) |
-                          static_cast<uint32_t>(data[4]);
-    
-    if (data.size() < 13 + payloadSize) {
+    if (size < kHeaderSize + header->payloadSize) {
         throw std::runtime_error("Invalid message: payload size mismatch");
     }
     
-    int64_t timestamp = 0;
-    for (int i = 0; i < 8; ++i) {
-        timestamp = (timestamp << 8) | data[5 + i];
+    // Construct in place; assigning would copy the payload off the caller's resource
+    return Message(header->type,
+                   Payload(data + kHeaderSize, header->payloadSize, resource),
+                   std::chrono::system_clock::time_point(std::chrono::milliseconds(header->timestampMs)));
+}
+
+std::optional<Message::Header> Message::PeekHeader(const uint8_t* data, size_t size) {
+    if (size < kHeaderSize) {
+        return std::nullopt;
     }
-    msg.timestamp_ = std::chrono::system_clock::time_point(
-        std::chrono::milliseconds(timestamp));
     
-    msg.payload_.assign(data.begin() + 13, data.begin() + 13 + payloadSize);
+    Header header;
+    header.type = static_cast<MessageType>(data[0]);
+    header.payloadSize = schema::Uint<uint32_t>::Read(data + 1);
+    header.timestampMs = static_cast<int64_t>(schema::Uint<uint64_t>::Read(data + 5));
     
-    return msg;
+    return header;
+}
+
+std::optional<Message::RelayRoute> Message::PeekRelayRoute(const uint8_t* data, size_t size) {
+    auto header = PeekHeader(data, size);
+    if (!header || header->type != MessageType::RELAY ||
+        size < kHeaderSize + header->payloadSize) {
+        return std::nullopt;
+    }
+    
+    auto relay = schema::Relay::Parse(std::span<const uint8_t>(data + kHeaderSize, header->payloadSize));
+    if (!relay) {
+        return std::nullopt;
+    }
+    
+    auto frame = relay->Get<schema::Relay::kFrame>();
+    return RelayRoute{relay->Get<schema::Relay::kSourceId>(), relay->Get<schema::Relay::kTargetId>(),
+                      relay->Get<schema::Relay::kSignature>(), frame.data(), frame.size()};
 }
 
 Message Message::CreateTextMessage(const std::string& text) {
-    std::vector<uint8_t> payload(text.begin(), text.end());
-    return Message(MessageType::TEXT, payload);
+    return schema::Text::Create(std::string_view(text));
 }
 
-Message Message::CreateHandshakeMessage(const std::string& peerId,
-                                      const std::vector<uint8_t>& publicKey) {
-    std::vector<uint8_t> payload;
-    
-    // PeerId length (2 bytes) + PeerId + PublicKey
-    uint16_t idLen = static_cast<uint16_t>(peerId.size());
-    payload.push_back((idLen >> 8) & 0xFF);
-    payload.push_back(idLen & 0xFF);
-    
-    payload.insert(payload.end(), peerId.begin(), peerId.end());
-    payload.insert(payload.end(), publicKey.begin(), publicKey.end());
-    
-    return Message(MessageType::HANDSHAKE, payload);
+Message Message::CreateTextMessage(std::string&& text) {
+    return Message(MessageType::TEXT, Payload(std::move(text)));
+}
+
+Message Message::CreateHandshakeMessage(std::string_view peerId,
+                                      std::span<const uint8_t> publicKey) {
+    return schema::Handshake::Create(peerId, publicKey);
+}
+
+Message Message::CreateAuthChallengeMessage(std::string_view peerId, std::span<const uint8_t> publicKey,
+                                          std::span<const uint8_t> nonce,
+                                          std::span<const uint8_t> signature) {
+    return schema::AuthChallenge::Create(peerId, publicKey, nonce, signature);
+}
+
+Message Message::CreateAuthResponseMessage(std::span<const uint8_t> signature) {
+    return schema::AuthResponse::Create(signature);
 }
 
 Message Message::CreatePeerListMessage(const std::vector<std::string>& peers) {
-    std::vector<uint8_t> payload;
-    
-    // Number of peers (2 bytes)
-    uint16_t peerCount = static_cast<uint16_t>(peers.size());
-    payload.push_back((peerCount >> 8) & 0xFF);
-    payload.push_back(peerCount & 0xFF);
-    
-    // Each peer: length (2 bytes) + address string
-    for (const auto& peer : peers) {
-        uint16_t len = static_cast<uint16_t>(peer.size());
-        payload.push_back((len >> 8) & 0xFF);
-        payload.push_back(len & 0xFF);
-        payload.insert(payload.end(), peer.begin(), peer.end());
-    }
-    
-    return Message(MessageType::PEER_LIST, payload);
+    return schema::PeerList::Create(peers);
 }
 
 Message Message::CreatePingMessage() {
-    return Message(MessageType::PING, {});
+    return Message(MessageType::PING, Payload());
 }
 
 Message Message::CreatePongMessage() {
-    return Message(MessageType::PONG, {});
+    return Message(MessageType::PONG, Payload());
+}
+
+Message Message::CreateChannelJoinMessage(std::string_view channel) {
+    return schema::ChannelJoin::Create(channel);
+}
+
+Message Message::CreateChannelPartMessage(std::string_view channel) {
+    return schema::ChannelPart::Create(channel);
+}
+
+Message Message::CreateChannelTextMessage(uint32_t channelId, std::string_view text) {
+    return schema::ChannelText::Create(channelId, text);
+}
+
+Message Message::CreateRelayMessage(std::string_view sourceId, std::string_view targetId,
+                                   const Message& inner, std::span<const uint8_t> signature) {
+    // Write the route, then serialize the inner message straight in behind it
+    std::span<const uint8_t> noFrame;
+    Payload payload;
+    payload.resize(schema::Relay::SizeOf(sourceId, targetId, signature, noFrame) + inner.GetSerializedSize());
+    inner.SerializeTo(schema::Relay::WriteTo(payload.data(), sourceId, targetId, signature, noFrame));
+    
+    return Message(MessageType::RELAY, std::move(payload));
 }
 
-} // namespace p2p
\ No newline at end of file
+} // namespace p2p
@@ -0,0 +1,46 @@
+#include "MessageArena.hpp"
+#include <algorithm>
+
+namespace p2p {
+
+MessageArena::MessageArena(size_t capacity, size_t maxCapacity)
+    : buffer_(capacity > 0 ? capacity : 1), maxCapacity_(std::max(maxCapacity, buffer_.size())) {
+    resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+}
+
+MessageArena::~MessageArena() = default;
+
+std::pmr::memory_resource* MessageArena::GetResource() {
+    return &*resource_;
+}
+
+void MessageArena::Reset() {
+    // The batch spilled to the heap; grow once so the next one fits, up to
+    // the cap. Past it the spill is just freed.
+    size_t capacity = std::min(buffer_.size() + overflow_.bytes, maxCapacity_);
+    overflow_.bytes = 0;
+    if (capacity == buffer_.size()) {
+        resource_->release();
+        return;
+    }
+
+    resource_.reset();
+    buffer_ = std::vector<std::byte>(capacity);
+    resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+}
+
+void* MessageArena::OverflowResource::do_allocate(size_t bytes, size_t alignment) {
+    this->bytes += bytes;
+    ++count;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void MessageArena::OverflowResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool MessageArena::OverflowResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+} // namespace p2p
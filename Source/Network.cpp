@@ -1,359 +1,1939 @@
 #include "Network.hpp"
 #include "Message.hpp"
+#include "MessageSchema.hpp"
 #include "PeerManager.hpp"
+#include "MessageArena.hpp"
+#include "HandlerPool.hpp"
+#include "Executor.hpp"
+#include "MpscQueue.hpp"
+#include "ReplayCache.hpp"
+#include "TokenBucket.hpp"
+#include "FrameLimits.hpp"
+#include "Crypto.hpp"
+#include "Transport.hpp"
+#include "Dialer.hpp"
+#include "Endpoint.hpp"
 #include <zmq.hpp>
 #include <memory>
 #include <unordered_map>
 #include <mutex>
+#include <shared_mutex>
 #include <thread>
 #include <atomic>
 #include <iostream>
 #include <sstream>
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <future>
+#include <unordered_set>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace p2p {
 
+// Index into the connection table; stable for the life of the connection
+using ConnectionHandle = uint32_t;
+
+static constexpr ConnectionHandle kNoConnection = 0xFFFFFFFF;
+
+// Frames drained from a socket per wakeup; their payloads share one arena reset
+static constexpr int kReceiveBatch = 64;
+
+// Inbox commands a shard applies per lock of the connection table, and the
+// number of such batches before it goes back to polling
+static constexpr size_t kInboxBatch = 64;
+static constexpr int kInboxBatchesPerWakeup = 4;
+
+// Frames a peer may pipeline behind its handshake while it's being verified;
+// any beyond this are dropped
+static constexpr size_t kMaxParkedMessages = 64;
+
+// Cheap bounds every handshake must meet before any crypto is spent on it
+static constexpr size_t kNonceSize = ReplayCache::kNonceSize;
+static constexpr size_t kMaxPeerIdSize = 64;
+static constexpr size_t kMaxPublicKeySize = 512;
+static constexpr size_t kMaxHandshakesInFlight = 256;
+
+// CurveZMQ keys are derived from the node key under this HKDF context, and
+// travel Z85-encoded: 32 bytes as 40 characters
+static constexpr std::string_view kCurveKeyContext = "p2pchat-curve-v1";
+static constexpr size_t kCurveKeySize = 32;
+static constexpr size_t kCurveZ85Length = 40;
+
+// One zmq context per process, as libzmq recommends: inproc endpoints only
+// reach sockets on the same context. Freed once the last node is gone.
+static std::shared_ptr<zmq::context_t> SharedContext() {
+    static std::mutex mutex;
+    static std::weak_ptr<zmq::context_t> shared;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto context = shared.lock();
+    if (!context) {
+        context = std::make_shared<zmq::context_t>(1);
+        shared = context;
+    }
+    return context;
+}
+
+// Nodes in this process listening on inproc, by TCP port. Connects to a port
+// with no listener here fall back to ipc or tcp rather than wait on inproc.
+static std::mutex inprocPortsMutex;
+static std::unordered_set<uint16_t> inprocPorts;
+
+// Every node also listens on these alongside its TCP port, so co-located
+// peers dialling it by loopback address skip the TCP stack
+static std::string InprocEndpoint(uint16_t port) {
+    return "inproc://p2pchat-" + std::to_string(port);
+}
+
+static std::filesystem::path IpcPath(uint16_t port) {
+    return std::filesystem::temp_directory_path() / ("p2pchat-" + std::to_string(port) + ".ipc");
+}
+
+// IPv6 addresses go in brackets so the port stays unambiguous
+static std::string FormatHostPort(std::string_view address, uint16_t port) {
+    bool bracket = address.find(':') != std::string_view::npos && !address.starts_with('[');
+    return (bracket ? "[" + std::string(address) + "]" : std::string(address)) + ":" + std::to_string(port);
+}
+
+// An address we can reach without a lookup: a literal, or localhost
+static std::optional<Endpoint> LiteralEndpoint(std::string_view address, uint16_t port) {
+    return address == "localhost" ? Endpoint::Loopback(port) : Endpoint::FromAddress(address, port);
+}
+
+// Tokens a shard takes from a node-wide bucket at a time, so it locks the
+// bucket once per this many frames rather than on every one
+static constexpr double kGlobalTokenLease = 32.0;
+
+struct Connection {
+    enum class Kind : uint8_t { Free, Outgoing, Incoming };
+    
+    Kind kind = Kind::Free;
+    PeerHandle peer;        // Invalid until the peer's handshake arrives
+    std::string routingId;  // Router identity, for incoming connections
+    std::string endpoint;   // "address:port", for outgoing connections
+    Endpoint remote;        // The address it was dialled at; unspecified for ipc, inproc and incoming
+    std::string host;       // The name it was dialled by, when `remote` has no address
+    std::unique_ptr<zmq::socket_t> socket; // Dealer socket, for outgoing connections
+    Transport::ConnectionId transportId = Transport::kNoConnection; // Over a plugged-in transport
+    uint16_t shard = 0;     // Reactor that owns the socket; incoming ones share the router's
+    uint32_t generation = 0; // Bumped on release, so queued sends can't reach a reused handle
+    bool handshakePending = false; // Parked while a handshake is verified off the reactor
+    bool admitted = false;  // Counted against maxConnections: it's ours, or has begun a handshake
+    std::chrono::steady_clock::time_point opened; // Incoming: the handshake timeout runs from here
+    std::vector<Message> parked;   // Frames received meanwhile, handled once it completes
+    
+    // Challenge-response progress, when the network has an identity to sign with
+    struct Auth {
+        std::vector<uint8_t> challenge; // Nonce we sent; the peer signs it once
+        std::vector<uint8_t> peerNonce; // Incoming: the challenge our answer signed
+        std::string peerId;             // Incoming: identity the peer's response must prove
+        std::vector<uint8_t> publicKey;
+        bool awaitingResponse = false;
+    } auth;
+};
+
+// A handshake step copied off the reactor's arena for the handshake pool
+struct PendingHandshake {
+    enum class Step : uint8_t {
+        Plain,     // Unauthenticated HANDSHAKE
+        Challenge, // Incoming: sign the peer's challenge and send our own
+        Answer,    // Outgoing: check the answer to our challenge, sign theirs
+        Response   // Incoming: check the signature over our challenge
+    };
+    
+    Step step = Step::Plain;
+    ConnectionHandle handle = kNoConnection;
+    uint32_t generation = 0;
+    bool incoming = false;
+    Endpoint remote;
+    std::string host;
+    std::string peerId;
+    std::vector<uint8_t> publicKey;
+    std::vector<uint8_t> challenge; // Our nonce, which the peer's signature covers
+    std::vector<uint8_t> nonce;     // The peer's nonce
+    std::vector<uint8_t> signature;
+    Message message;
+};
+
+// What a handshake signature covers: the verifier's challenge, the signer's
+// own nonce and ID, and which side signed. Tying both nonces in binds it to
+// one connection; the role stops it being reflected back at its maker.
+static std::vector<uint8_t> AuthTranscript(bool answer, std::span<const uint8_t> challenge,
+                                           std::span<const uint8_t> nonce, std::string_view signerId) {
+    static constexpr std::string_view kContext = "p2pchat-auth-v1";
+    std::vector<uint8_t> transcript;
+    transcript.reserve(kContext.size() + 1 + challenge.size() + nonce.size() + signerId.size());
+    transcript.insert(transcript.end(), kContext.begin(), kContext.end());
+    transcript.push_back(answer ? 'A' : 'R');
+    transcript.insert(transcript.end(), challenge.begin(), challenge.end());
+    transcript.insert(transcript.end(), nonce.begin(), nonce.end());
+    transcript.insert(transcript.end(), signerId.begin(), signerId.end());
+    return transcript;
+}
+
+// What a relayed frame's source signs: the route, down to the relay it was
+// handed to, and the frame. A relay can't pass it off as coming from anyone
+// else, and nobody can reuse it through another relay or for another target.
+static std::vector<uint8_t> RelayTranscript(std::string_view sourceId, std::string_view relayId,
+                                            std::string_view targetId, std::span<const uint8_t> frame) {
+    static constexpr std::string_view kContext = "p2pchat-relay-v1";
+    std::vector<uint8_t> transcript;
+    transcript.reserve(kContext.size() + 3 + sourceId.size() + relayId.size() + targetId.size() + frame.size());
+    transcript.insert(transcript.end(), kContext.begin(), kContext.end());
+    for (auto id : {sourceId, relayId, targetId}) {
+        transcript.push_back(static_cast<uint8_t>(id.size()));
+        transcript.insert(transcript.end(), id.begin(), id.end());
+    }
+    transcript.insert(transcript.end(), frame.begin(), frame.end());
+    return transcript;
+}
+
+// Lets the router identity index be probed with a string_view, without allocating
+struct StringViewHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view value) const noexcept {
+        return std::hash<std::string_view>{}(value);
+    }
+};
+
+// Work handed to a shard's reactor: a frame to send on one of its
+// connections, or a released socket to close
+struct ShardCommand {
+    ConnectionHandle handle = kNoConnection;
+    uint32_t generation = 0;
+    zmq::message_t frame;
+    std::unique_ptr<zmq::socket_t> socket;
+};
+
+// One reactor thread and the sockets it owns. No other thread touches those
+// sockets: sends and closes from elsewhere arrive through the lock-free inbox,
+// and a pipe wakes the reactor out of zmq::poll when there's something new.
+struct Shard {
+    explicit Shard(size_t index) : index(index) {
+        if (pipe(wakeFds) != 0) {
+            throw std::runtime_error("Failed to create shard wake pipe");
+        }
+        fcntl(wakeFds[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakeFds[1], F_SETFL, O_NONBLOCK);
+    }
+    
+    ~Shard() {
+        ::close(wakeFds[0]);
+        ::close(wakeFds[1]);
+    }
+    
+    void Post(ShardCommand command) {
+        inbox.Push(std::move(command));
+        Wake();
+    }
+    
+    // At most one wake byte is in flight until the reactor clears it
+    void Wake() {
+        if (!wakePending.exchange(true, std::memory_order_acq_rel)) {
+            char byte = 1;
+            if (write(wakeFds[1], &byte, 1) < 0) {
+                // Pipe full: a wakeup is already pending
+            }
+        }
+    }
+    
+    // Reactor only; call before draining the inbox so no wakeup is lost
+    void ClearWake() {
+        char buffer[64];
+        while (read(wakeFds[0], buffer, sizeof(buffer)) > 0) {
+        }
+        wakePending.exchange(false, std::memory_order_acq_rel);
+    }
+    
+    size_t index;
+    std::thread thread;
+    MpscQueue<ShardCommand> inbox;
+    std::atomic<bool> wakePending{false};
+    int wakeFds[2] = {-1, -1};
+};
+
+// A node-wide token bucket that shards lease tokens from in batches
+struct SharedBucket {
+    std::mutex mutex;
+    TokenBucket bucket;
+};
+
+// One shard's receive-side budgets. Only its reactor touches them, so the
+// per-connection buckets and the leased global tokens need no lock.
+struct ShardLimiter {
+    struct PeerBudget {
+        uint32_t generation = 0;
+        bool active = false;
+        TokenBucket bucket;
+    };
+    
+    std::vector<PeerBudget> peers; // Indexed by ConnectionHandle, reset when a handle is reused
+    double messageTokens = 0.0;    // Leased from the global message bucket
+    double handshakeTokens = 0.0;  // Leased from the handshake bucket
+    TokenBucket::Clock::time_point now; // Sampled once per poll
+};
+
+// The shard whose reactor is running on this thread, if any
+static thread_local const Shard* tCurrentShard = nullptr;
+
 struct NetworkManager::Impl {
     PeerManager& peerManager_;
     MessageHandler userMessageHandler_;
+    
+    // Typed handlers, indexed directly by the message type byte
+    std::array<std::vector<MessageHandler>, 256> typedHandlers_;
+    std::shared_mutex handlersMutex_;
     ConnectionHandler connectionHandler_;
     
-    // ZeroMQ context
-    zmq::context_t context_;
+    // ZeroMQ context, shared by every node in the process
+    std::shared_ptr<zmq::context_t> context_;
     
     // Router socket for incoming connections
     std::unique_ptr<zmq::socket_t> routerSocket_;
     
-    // Dealer sockets for outgoing connections
-    std::unordered_map<std::string, std::unique_ptr<zmq::socket_t>> dealerSockets_;
-    std::mutex socketsMutex_;
+    // One table for incoming and outgoing connections, indexed by handle.
+    // Each peer maps to exactly one handle, which carries all sends to that peer.
+    std::vector<Connection> connections_;
+    std::vector<ConnectionHandle> freeHandles_;
+    std::vector<ConnectionHandle> peerConnections_; // Indexed by PeerHandle
+    std::unordered_map<std::string, ConnectionHandle> endpointIndex_;
+    std::unordered_map<std::string, ConnectionHandle, StringViewHash, std::equal_to<>> routingIndex_;
+    mutable std::mutex socketsMutex_;
     
-    // Worker threads
-    std::thread routerThread_;
-    std::thread pollerThread_;
+    // Relay role
+    std::atomic<bool> relayEnabled_{false};
+    std::atomic<uint64_t> relayedMessages_{0};
+    std::atomic<size_t> relayChecksInFlight_{0}; // Relay signatures waiting on the handshake pool
+    
+    // Reactor shards; shard 0 also owns the router. Guarded by socketsMutex_.
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t shardCount_ = std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, 16);
+    std::atomic<uint64_t> socketsVersion_{0}; // Bumped when outgoing sockets come or go
     std::atomic<bool> running_{false};
     
+    // Message handlers run here, off the I/O threads
+    std::unique_ptr<HandlerPool> handlerPool_;
+    size_t handlerThreads_ = HandlerPool::GetDefaultWorkerCount();
+    Executor* executor_ = nullptr;
+    
+    // Handshakes are verified here so the reactors never wait on crypto
+    std::unique_ptr<Executor> handshakeExecutor_;
+    size_t handshakeThreads_ = std::clamp<size_t>(std::thread::hardware_concurrency() / 4, 1, 4);
+    HandshakeVerifier handshakeVerifier_;
+    bool acceptingHandshakes_ = false; // Guarded by socketsMutex_
+    std::atomic<size_t> handshakesInFlight_{0};
+    std::atomic<uint64_t> rejectedHandshakes_{0};
+    
+    // Node key for challenge-response handshakes; plain handshakes without one
+    CryptoManager* crypto_ = nullptr;
+    std::vector<uint8_t> privateKey_;
+    ReplayCache replayCache_;
+    
+    // CurveZMQ transport encryption, keyed from the node key. Set before Start().
+    bool curveEnabled_ = false;
+    std::string curvePublicKey_; // Z85
+    std::string curveSecretKey_; // Z85
+    
+    // Receive-side rate limits and what they've dropped
+    RateLimits rateLimits_;
+    SharedBucket globalMessages_;
+    SharedBucket globalHandshakes_;
+    std::atomic<uint64_t> throttledMessages_{0};
+    std::atomic<uint64_t> throttledHandshakes_{0};
+    std::atomic<uint64_t> refusedConnections_{0};
+    size_t admittedConnections_ = 0; // Guarded by socketsMutex_
+    std::chrono::steady_clock::time_point nextHandshakeSweep_; // Guarded by socketsMutex_
+    
+    // Received frames past these are dropped undecoded. Set before Start().
+    FrameLimits frameLimits_;
+    std::atomic<uint64_t> rejectedFrames_{0};
+    
     // Port we're listening on
     uint16_t listenPort_ = 0;
     
-    Impl(PeerManager& pm) : peerManager_(pm), context_(1) {}
+    // Co-located peers: extra endpoints the router binds, and whether loopback
+    // peers are reached over inproc or ipc instead of tcp. Set before Start().
+    std::vector<std::string> listenEndpoints_;
+    bool localTransports_ = true;
+    bool inprocRegistered_ = false;
+    
+    // Plugged-in transport, which replaces the router, dealers and shards.
+    // Its threads deliver frames one at a time, through one limiter and arena.
+    std::unique_ptr<Transport> transport_;
+    std::unordered_map<Transport::ConnectionId, ConnectionHandle> transportIndex_; // Guarded by socketsMutex_
+    std::vector<Transport::ConnectionId> transportClosing_; // Released under socketsMutex_, closed once it's let go
+    std::mutex transportReceiveMutex_;
+    ShardLimiter transportLimiter_;
+    MessageArena transportArena_;
+    
+    // Looks up and races addresses for ConnectToPeerAsync(); made on first use
+    std::once_flag dialerOnce_;
+    std::unique_ptr<Dialer> dialer_;
+    
+    // Numbers our dealers' routing IDs
+    std::atomic<uint32_t> dealerCount_{0};
+    
+    Impl(PeerManager& pm) : peerManager_(pm), context_(SharedContext()) {
+        // Heartbeat responder
+        Subscribe(MessageType::PING, [this](PeerHandle peer, const Message&) {
+            SendMessage(peer, Message::CreatePongMessage());
+        });
+    }
+    
+    ~Impl() {
+        dialer_.reset(); // Its thread calls back into us
+        Stop();
+        transport_.reset(); // Joins its threads, which call back into us
+    }
+    
+    void Start(uint16_t port) {
+        if (running_) return;
+        
+        listenPort_ = port;
+        
+        try {
+            // Everything a frame needs is in place before the first can arrive:
+            // a transport may deliver from its own threads as soon as it listens
+            auto dispatch = [this](PeerHandle sender, const Message& msg) { DispatchMessage(sender, msg); };
+            handlerPool_ = executor_ ? std::make_unique<HandlerPool>(dispatch, *executor_)
+                                     : std::make_unique<HandlerPool>(dispatch, handlerThreads_);
+            handlerPool_->Start();
+            handshakeExecutor_ = std::make_unique<Executor>(handshakeThreads_);
+            handshakeExecutor_->Start();
+            globalMessages_.bucket = TokenBucket(rateLimits_.globalMessageRate, rateLimits_.globalMessageBurst);
+            globalHandshakes_.bucket = TokenBucket(rateLimits_.handshakeRate, rateLimits_.handshakeBurst);
+            
+            {
+                std::lock_guard<std::mutex> lock(socketsMutex_);
+                acceptingHandshakes_ = true;
+                // A transport runs its own threads; only the router needs reactors
+                for (size_t i = 0; !transport_ && i < shardCount_; ++i) {
+                    shards_.push_back(std::make_unique<Shard>(i));
+                }
+                // Connections made before Start() may have used another shard count
+                for (auto& conn : connections_) {
+                    conn.shard = static_cast<uint16_t>(conn.shard % std::max<size_t>(shards_.size(), 1));
+                }
+            }
+            running_ = true;
+            
+            if (transport_) {
+                StartTransport(port);
+            } else {
+                StartRouter(port);
+            }
+            ++socketsVersion_;
+            
+            for (auto& shard : shards_) {
+                shard->thread = std::thread([this, s = shard.get()]() { RunShard(*s); });
+            }
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(socketsMutex_);
+                acceptingHandshakes_ = false;
+            }
+            running_ = false;
+            UnregisterInproc();
+            routerSocket_.reset();
+            if (transport_) {
+                { std::lock_guard<std::mutex> lock(transportReceiveMutex_); }
+                transport_->Stop();
+            }
+            handshakeExecutor_.reset();
+            handlerPool_.reset();
+            std::lock_guard<std::mutex> lock(socketsMutex_);
+            shards_.clear();
+            throw;
+        }
+    }
+    
+    void StartRouter(uint16_t port) {
+        // Create router socket for incoming connections
+        routerSocket_ = std::make_unique<zmq::socket_t>(*context_, zmq::socket_type::router);
+        routerSocket_->set(zmq::sockopt::router_mandatory, 1);
+        routerSocket_->set(zmq::sockopt::linger, 0);
+        routerSocket_->set(zmq::sockopt::maxmsgsize, static_cast<int64_t>(frameLimits_.GetMaxFrameSize()));
+        routerSocket_->set(zmq::sockopt::ipv6, true); // tcp://* binds dual-stack, or IPv4 where there's no IPv6
+        if (curveEnabled_) {
+            routerSocket_->set(zmq::sockopt::curve_server, 1);
+            routerSocket_->set(zmq::sockopt::curve_secretkey, curveSecretKey_);
+        }
+        
+        std::string bindAddr = "tcp://*:" + std::to_string(port);
+        routerSocket_->bind(bindAddr);
+        for (const auto& endpoint : listenEndpoints_) {
+            routerSocket_->bind(endpoint);
+        }
+        if (localTransports_) {
+            BindLocalTransports(port);
+        }
+    }
+    
+    void StartTransport(uint16_t port) {
+        transport_->SetMaxFrameSize(frameLimits_.GetMaxFrameSize());
+        transport_->Listen("tcp://*:" + std::to_string(port));
+        for (const auto& endpoint : listenEndpoints_) {
+            transport_->Listen(endpoint);
+        }
+    }
+    
+    void Stop() {
+        if (!running_) return;
+        
+        // Finish the handshakes in flight; they post to the handler pool and the shards
+        {
+            std::lock_guard<std::mutex> lock(socketsMutex_);
+            acceptingHandshakes_ = false;
+        }
+        if (handshakeExecutor_) {
+            handshakeExecutor_->Stop();
+        }
+        
+        // Let queued handlers finish while the shards can still send for them
+        if (handlerPool_) {
+            handlerPool_->Stop();
+        }
+        
+        running_ = false;
+        
+        // Reactors flush their inboxes on the way out
+        for (auto& shard : shards_) {
+            shard->Wake();
+        }
+        for (auto& shard : shards_) {
+            if (shard->thread.joinable()) {
+                shard->thread.join();
+            }
+        }
+        
+        // A frame the transport is delivering finishes first; any after it see we've stopped
+        if (transport_) {
+            { std::lock_guard<std::mutex> lock(transportReceiveMutex_); }
+            transport_->Stop();
+        }
+        handlerPool_.reset();
+        handshakeExecutor_.reset();
+        
+        // Close all sockets once nothing is polling them
+        {
+            std::lock_guard<std::mutex> lock(socketsMutex_);
+            connections_.clear();
+            freeHandles_.clear();
+            peerConnections_.clear();
+            endpointIndex_.clear();
+            routingIndex_.clear();
+            transportIndex_.clear();
+            transportClosing_.clear();
+            shards_.clear();
+        }
+        
+        UnregisterInproc();
+        if (routerSocket_) {
+            routerSocket_->close();
+            routerSocket_.reset();
+        }
+    }
+    
+    // Best effort: peers can always fall back to the TCP port
+    void BindLocalTransports(uint16_t port) {
+        // The ipc path is ours once the TCP port is, so a file left there is
+        // stale. libzmq removes ours when the router closes.
+        try {
+            std::error_code error;
+            auto path = IpcPath(port);
+            std::filesystem::remove(path, error);
+            routerSocket_->bind("ipc://" + path.string());
+        } catch (const zmq::error_t& e) {
+            std::cerr << "Not listening on ipc: " << e.what() << std::endl;
+        }
+        
+        // inproc skips the security handshake, so it's never offered with CURVE
+        if (curveEnabled_) {
+            return;
+        }
+        try {
+            routerSocket_->bind(InprocEndpoint(port));
+            std::lock_guard<std::mutex> lock(inprocPortsMutex);
+            inprocPorts.insert(port);
+            inprocRegistered_ = true;
+        } catch (const zmq::error_t& e) {
+            std::cerr << "Not listening on inproc: " << e.what() << std::endl;
+        }
+    }
+    
+    void UnregisterInproc() {
+        if (inprocRegistered_) {
+            std::lock_guard<std::mutex> lock(inprocPortsMutex);
+            inprocPorts.erase(listenPort_);
+            inprocRegistered_ = false;
+        }
+    }
+    
+    // Fastest way to reach a loopback peer: inproc if it's a node in this
+    // process, ipc if it's listening on this host, otherwise tcp
+    std::string LocalEndpoint(const Endpoint& remote) const {
+        if (transport_ || !localTransports_ || !remote.IsLoopback()) {
+            return {};
+        }
+        if (!curveEnabled_) {
+            std::lock_guard<std::mutex> lock(inprocPortsMutex);
+            if (inprocPorts.count(remote.GetPort())) {
+                return InprocEndpoint(remote.GetPort());
+            }
+        }
+        std::error_code error;
+        auto path = IpcPath(remote.GetPort());
+        if (std::filesystem::is_socket(path, error)) {
+            return "ipc://" + path.string();
+        }
+        return {};
+    }
+    
+    Dialer& GetDialer() {
+        std::call_once(dialerOnce_, [this]() { dialer_ = std::make_unique<Dialer>(); });
+        return *dialer_;
+    }
+    
+    void ConnectToPeer(const std::string& address, uint16_t port, const std::string& curveServerKey) {
+        std::string endpoint = FormatHostPort(address, port);
+        auto literal = LiteralEndpoint(address, port);
+        if (transport_ || !literal) {
+            // A host name is left to libzmq or the transport to resolve, so this
+            // never waits on a lookup; the peer is recorded by name and port
+            Connect(endpoint, "tcp://" + endpoint, curveServerKey, literal.value_or(Endpoint(port)),
+                    literal ? std::string() : address);
+            return;
+        }
+        Connect(endpoint, *literal, curveServerKey);
+    }
+    
+    void ConnectToPeer(const Endpoint& remote, const std::string& curveServerKey) {
+        if (transport_) {
+            auto endpoint = remote.ToString();
+            Connect(endpoint, "tcp://" + endpoint, curveServerKey, remote);
+            return;
+        }
+        Connect(remote.ToString(), remote, curveServerKey);
+    }
+    
+    void ConnectToPeerAsync(const std::string& address, uint16_t port, const std::string& curveServerKey,
+                            ConnectCallback callback) {
+        // Nothing to look up or race for these
+        auto literal = LiteralEndpoint(address, port);
+        if (transport_ || (literal && !LocalEndpoint(*literal).empty())) {
+            std::exception_ptr error;
+            try {
+                ConnectToPeer(address, port, curveServerKey);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            callback(error);
+            return;
+        }
+        
+        std::string endpoint = FormatHostPort(address, port);
+        GetDialer().Dial(address, port,
+            [this, endpoint, port, curveServerKey, callback = std::move(callback)](
+                const std::string& winner, std::exception_ptr error) {
+                if (!error) {
+                    // Dial the address that answered, so libzmq has no lookup of its own to do
+                    try {
+                        Connect(endpoint, Endpoint::FromAddress(winner, port).value(), curveServerKey);
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                }
+                callback(error);
+            });
+    }
+    
+    void ConnectToEndpoint(const std::string& endpoint, const std::string& curveServerKey) {
+        // A plugged-in transport decides for itself which endpoints it can reach
+        bool inproc = endpoint.starts_with("inproc://");
+        if (!transport_ && !inproc && !endpoint.starts_with("tcp://") && !endpoint.starts_with("ipc://")) {
+            throw std::invalid_argument("Unsupported endpoint " + endpoint + "; use tcp://, ipc:// or inproc://");
+        }
+        if (inproc && curveEnabled_) {
+            throw std::invalid_argument("inproc connections can't use CURVE");
+        }
+        Connect(endpoint, endpoint, curveServerKey, Endpoint::Parse(endpoint).value_or(Endpoint()));
+    }
+    
+    // To a known address over the fastest local transport, or else tcp
+    void Connect(const std::string& endpoint, const Endpoint& remote, const std::string& curveServerKey) {
+        std::string connectAddr = LocalEndpoint(remote);
+        Connect(endpoint, connectAddr.empty() ? "tcp://" + remote.ToString() : connectAddr, curveServerKey, remote);
+    }
+    
+    // `endpoint` names the connection for sends and dedupe; `connectAddr` is
+    // where the dealer actually goes, and `remote` the address recorded for
+    // the peer, or `host` where there's only a name
+    void Connect(const std::string& endpoint, const std::string& connectAddr, const std::string& curveServerKey,
+                 const Endpoint& remote, const std::string& host = {}) {
+        // One outgoing connection per endpoint; zmq reconnects it for us
+        {
+            std::lock_guard<std::mutex> lock(socketsMutex_);
+            if (endpointIndex_.count(endpoint)) {
+                return;
+            }
+        }
+        
+        // The dealer or transport connection and the handshake are made outside
+        // the lock, so connects don't hold up the reactors or each other, and a
+        // transport may call back into us from Connect()
+        std::unique_ptr<zmq::socket_t> dealer;
+        auto transportId = Transport::kNoConnection;
+        if (transport_) {
+            transportId = transport_->Connect(connectAddr);
+            if (transportId == Transport::kNoConnection) {
+                throw std::runtime_error("Failed to connect to peer " + endpoint);
+            }
+        } else {
+            dealer = MakeDealer(endpoint, connectAddr, curveServerKey);
+        }
+        
+        // Send handshake, or challenge the peer to prove its key
+        const auto& localPeer = peerManager_.GetLocalPeer();
+        std::vector<uint8_t> challenge;
+        if (crypto_) {
+            challenge = crypto_->RandomBytes(kNonceSize);
+        }
+        auto hello = SerializeFrame(crypto_
+            ? Message::CreateAuthChallengeMessage(localPeer.id, localPeer.publicKey, challenge)
+            : Message::CreateHandshakeMessage(localPeer.id, localPeer.publicKey));
+        
+        ConnectionsLock lock(*this);
+        if (endpointIndex_.count(endpoint)) {
+            // Another connect got there first; our dealer just closes
+            if (transportId != Transport::kNoConnection) {
+                transportClosing_.push_back(transportId);
+            }
+            return;
+        }
+        auto handle = transport_ ? AddTransportConnection(endpoint, transportId)
+                                 : AddDealer(endpoint, std::move(dealer));
+        endpointIndex_[endpoint] = handle;
+        connections_[handle].remote = remote;
+        connections_[handle].host = host;
+        connections_[handle].auth.challenge = std::move(challenge);
+        SendFrame(handle, hello);
+    }
+    
+    std::unique_ptr<zmq::socket_t> MakeDealer(const std::string& endpoint, const std::string& connectAddr,
+                                              const std::string& curveServerKey) {
+        // The server key pins who we're talking to; without it CURVE can't start
+        if (curveEnabled_ && curveServerKey.size() != kCurveZ85Length) {
+            throw std::invalid_argument("Connecting to " + endpoint + " needs its CURVE public key");
+        }
+        
+        try {
+            // Create a dealer socket for this peer
+            auto dealer = std::make_unique<zmq::socket_t>(*context_, zmq::socket_type::dealer);
+            
+            // Our peer ID plus a serial number. A router drops a second connection
+            // that reuses a routing ID, and two of our dealers can reach the same
+            // node, say over ipc and inproc.
+            const auto& localPeer = peerManager_.GetLocalPeer();
+            dealer->set(zmq::sockopt::routing_id, localPeer.id + "-" + std::to_string(++dealerCount_));
+            dealer->set(zmq::sockopt::linger, 0);
+            dealer->set(zmq::sockopt::maxmsgsize, static_cast<int64_t>(frameLimits_.GetMaxFrameSize()));
+            dealer->set(zmq::sockopt::ipv6, true);
+            if (curveEnabled_) {
+                dealer->set(zmq::sockopt::curve_serverkey, curveServerKey);
+                dealer->set(zmq::sockopt::curve_publickey, curvePublicKey_);
+                dealer->set(zmq::sockopt::curve_secretkey, curveSecretKey_);
+            }
+            
+            // Connect to peer
+            dealer->connect(connectAddr);
+            return dealer;
+        } catch (const zmq::error_t& e) {
+            std::cerr << "Failed to connect to peer " << endpoint << ": " << e.what() << std::endl;
+            throw;
+        }
+    }
+    
+    // Caller holds socketsMutex_
+    ConnectionHandle AddDealer(const std::string& endpoint, std::unique_ptr<zmq::socket_t> dealer) {
+        auto handle = AllocateConnection(Connection::Kind::Outgoing);
+        auto& conn = connections_[handle];
+        conn.endpoint = endpoint;
+        conn.socket = std::move(dealer);
+        conn.shard = static_cast<uint16_t>(std::hash<std::string>{}(endpoint) % shardCount_);
+        ++socketsVersion_;
+        return handle;
+    }
+    
+    // Caller holds socketsMutex_
+    ConnectionHandle AddTransportConnection(const std::string& endpoint, Transport::ConnectionId id) {
+        auto handle = AllocateConnection(Connection::Kind::Outgoing);
+        connections_[handle].endpoint = endpoint;
+        connections_[handle].transportId = id;
+        transportIndex_[id] = handle;
+        return handle;
+    }
+    
+    void DisconnectPeer(const std::string& peerId) {
+        PeerHandle peer;
+        {
+            ConnectionsLock lock(*this);
+            auto handle = ResolveHandle(peerId);
+            if (!handle) return;
+            
+            // Not handshaken yet: there's no peer to report, just drop the socket
+            peer = connections_[*handle].peer;
+            if (!peer) {
+                ReleaseConnection(*handle);
+                return;
+            }
+        }
+        DisconnectPeer(peer);
+    }
+    
+    void DisconnectPeer(PeerHandle peer) {
+        {
+            ConnectionsLock lock(*this);
+            if (PrimaryConnection(peer) == kNoConnection) return;
+            
+            // Drop every connection to this peer, not just the one we send on
+            for (ConnectionHandle h = 0; h < connections_.size(); ++h) {
+                if (connections_[h].kind != Connection::Kind::Free && connections_[h].peer == peer) {
+                    ReleaseConnection(h);
+                }
+            }
+        }
+        
+        if (connectionHandler_) {
+            connectionHandler_(peer, false);
+        }
+    }
+    
+    void SendMessage(const std::string& peerId, const Message& message) {
+        auto frame = SerializeFrame(message);
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        if (auto handle = ResolveHandle(peerId)) {
+            SendFrame(*handle, frame);
+        }
+    }
+    
+    void SendMessage(PeerHandle peer, const Message& message) {
+        auto frame = SerializeFrame(message);
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        auto handle = PrimaryConnection(peer);
+        if (handle != kNoConnection) {
+            SendFrame(handle, frame);
+        }
+    }
+    
+    void BroadcastMessage(const Message& message) {
+        auto frame = SerializeFrame(message);
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        
+        // Exactly one copy per peer, on the connection indexed for it
+        for (ConnectionHandle h = 0; h < connections_.size(); ++h) {
+            if (IsPrimary(h)) {
+                SendSharedFrame(h, frame);
+            }
+        }
+    }
+    
+    void MulticastMessage(const std::vector<PeerHandle>& peers, const Message& message) {
+        if (peers.empty()) return;
+        
+        auto frame = SerializeFrame(message);
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        
+        // Serialize once and fan out only to the listed peers
+        for (auto peer : peers) {
+            auto handle = PrimaryConnection(peer);
+            if (handle != kNoConnection) {
+                SendSharedFrame(handle, frame);
+            }
+        }
+    }
+    
+    void SendViaRelay(const std::string& relayPeerId, const std::string& targetPeerId,
+                      const Message& message) {
+        const auto& localPeer = peerManager_.GetLocalPeer();
+        
+        // Signed for this one relay, so the target can tell it really is from us
+        std::string relayId;
+        {
+            std::lock_guard<std::mutex> lock(socketsMutex_);
+            auto handle = ResolveHandle(relayPeerId);
+            if (!handle) {
+                return;
+            }
+            if (connections_[*handle].peer) {
+                relayId = peerManager_.GetPeerId(connections_[*handle].peer);
+            }
+        }
+        std::vector<uint8_t> signature;
+        if (crypto_ && !relayId.empty() && relayId.size() <= kMaxPeerIdSize) {
+            signature = crypto_->Sign(RelayTranscript(localPeer.id, relayId, targetPeerId, message.Serialize()),
+                                      privateKey_);
+        }
+        auto frame = SerializeFrame(Message::CreateRelayMessage(localPeer.id, targetPeerId, message, signature));
+        
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        if (auto handle = ResolveHandle(relayPeerId)) {
+            SendFrame(*handle, frame);
+        }
+    }
+    
+    std::vector<PeerHandle> GetConnectedPeers() const {
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        std::vector<PeerHandle> peers;
+        
+        for (ConnectionHandle h = 0; h < connections_.size(); ++h) {
+            if (IsPrimary(h)) {
+                peers.push_back(connections_[h].peer);
+            }
+        }
+        
+        return peers;
+    }
+    
+    void Subscribe(MessageType type, MessageHandler handler) {
+        std::unique_lock<std::shared_mutex> lock(handlersMutex_);
+        typedHandlers_[static_cast<uint8_t>(type)].push_back(std::move(handler));
+    }
+    
+    void SetMessageHandler(MessageHandler handler) {
+        std::unique_lock<std::shared_mutex> lock(handlersMutex_);
+        userMessageHandler_ = std::move(handler);
+    }
+    
+    void SetIdentity(CryptoManager& crypto, std::vector<uint8_t> privateKey) {
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        crypto_ = &crypto;
+        privateKey_ = std::move(privateKey);
+    }
+    
+    void SetCurveEnabled(bool enabled) {
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        curveEnabled_ = false;
+        curvePublicKey_.clear();
+        curveSecretKey_.clear();
+        if (!enabled) {
+            return;
+        }
+        
+        if (!crypto_) {
+            throw std::logic_error("CURVE keys come from the node key; call SetIdentity() first");
+        }
+        if (transport_) {
+            throw std::logic_error("CURVE needs the built-in ZMQ transport");
+        }
+        if (!zmq_has("curve")) {
+            throw std::runtime_error("libzmq was built without CURVE support");
+        }
+        
+        // Any 32 bytes make a Curve25519 secret key
+        auto secret = crypto_->DeriveKey(privateKey_, kCurveKeyContext, kCurveKeySize);
+        char secretZ85[kCurveZ85Length + 1];
+        char publicZ85[kCurveZ85Length + 1];
+        if (secret.size() != kCurveKeySize || !zmq_z85_encode(secretZ85, secret.data(), secret.size()) ||
+            zmq_curve_public(publicZ85, secretZ85) != 0) {
+            throw std::runtime_error("Failed to derive the CURVE key pair");
+        }
+        curveSecretKey_ = secretZ85;
+        curvePublicKey_ = publicZ85;
+        curveEnabled_ = true;
+        
+        // Encryption runs on libzmq's I/O threads, so give them one per shard.
+        // Only applies if no node in the process has made a socket yet.
+        context_->set(zmq::ctxopt::io_threads, static_cast<int>(shardCount_));
+    }
+    
+    std::string GetCurvePublicKey() const {
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        return curvePublicKey_;
+    }
+    
+    void SetHandshakeVerifier(HandshakeVerifier verifier) {
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        handshakeVerifier_ = std::move(verifier);
+    }
+    
+    void SetTransport(std::unique_ptr<Transport> transport) {
+        if (running_) {
+            throw std::logic_error("Set the transport before Start()");
+        }
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        if (curveEnabled_ && transport) {
+            throw std::logic_error("CURVE needs the built-in ZMQ transport");
+        }
+        transport_ = std::move(transport);
+        if (transport_) {
+            transport_->SetFrameHandler([this](Transport::ConnectionId id, std::span<const uint8_t> frame) {
+                OnTransportFrame(id, frame);
+            });
+            transport_->SetConnectionHandler([this](Transport::ConnectionId id, bool connected) {
+                OnTransportConnection(id, connected);
+            });
+        }
+    }
+    
+private:
+    // socketsMutex_ for code that may release connections. Transport
+    // connections released under it are closed once it's let go, since a
+    // transport may call straight back into us from Close().
+    class ConnectionsLock {
+    public:
+        explicit ConnectionsLock(Impl& impl) : impl_(impl), lock_(impl.socketsMutex_) {}
+        ~ConnectionsLock() {
+            auto closing = std::move(impl_.transportClosing_);
+            impl_.transportClosing_.clear();
+            lock_.unlock();
+            for (auto id : closing) {
+                impl_.transport_->Close(id);
+            }
+        }
+        
+    private:
+        Impl& impl_;
+        std::unique_lock<std::mutex> lock_;
+    };
+    
+    // Caller must hold socketsMutex_ for all connection table helpers
+    ConnectionHandle AllocateConnection(Connection::Kind kind) {
+        ConnectionHandle handle;
+        if (!freeHandles_.empty()) {
+            handle = freeHandles_.back();
+            freeHandles_.pop_back();
+        } else {
+            handle = static_cast<ConnectionHandle>(connections_.size());
+            connections_.emplace_back();
+        }
+        auto& conn = connections_[handle];
+        conn.kind = kind;
+        if (kind == Connection::Kind::Outgoing) {
+            conn.admitted = true; // We asked for it
+            ++admittedConnections_;
+        } else {
+            conn.opened = std::chrono::steady_clock::now();
+        }
+        return handle;
+    }
+    
+    void ReleaseConnection(ConnectionHandle handle) {
+        auto& conn = connections_[handle];
+        
+        if (conn.admitted) {
+            --admittedConnections_;
+        }
+        if (IsPrimary(handle)) {
+            peerConnections_[conn.peer.GetIndex()] = kNoConnection;
+        }
+        if (conn.kind == Connection::Kind::Outgoing) {
+            endpointIndex_.erase(conn.endpoint);
+            ++socketsVersion_;
+        } else if (conn.kind == Connection::Kind::Incoming) {
+            routingIndex_.erase(conn.routingId);
+        }
+        if (conn.transportId != Transport::kNoConnection) {
+            transportIndex_.erase(conn.transportId);
+            transportClosing_.push_back(conn.transportId); // Caller holds a ConnectionsLock
+        }
+        
+        // The owning reactor may be polling the socket; let it close it
+        if (conn.socket && !shards_.empty()) {
+            ShardCommand close;
+            close.socket = std::move(conn.socket);
+            shards_[conn.shard % shards_.size()]->Post(std::move(close));
+        }
+        
+        uint32_t generation = conn.generation + 1;
+        conn = Connection{};
+        conn.generation = generation;
+        freeHandles_.push_back(handle);
+    }
+    
+    ConnectionHandle PrimaryConnection(PeerHandle peer) const {
+        if (peer.GetIndex() < peerConnections_.size()) {
+            return peerConnections_[peer.GetIndex()];
+        }
+        return kNoConnection;
+    }
+    
+    bool IsPrimary(ConnectionHandle handle) const {
+        const auto& conn = connections_[handle];
+        return conn.kind != Connection::Kind::Free && conn.peer && PrimaryConnection(conn.peer) == handle;
+    }
+    
+    // Whether the handle still names the connection it did at `generation`
+    bool IsCurrent(ConnectionHandle handle, uint32_t generation) const {
+        return handle < connections_.size() && connections_[handle].kind != Connection::Kind::Free &&
+               connections_[handle].generation == generation;
+    }
+    
+    // Peer IDs take precedence; "address:port" still names outgoing connections
+    std::optional<ConnectionHandle> ResolveHandle(const std::string& peerId) const {
+        auto handle = PrimaryConnection(peerManager_.FindPeerHandle(peerId));
+        if (handle != kNoConnection) {
+            return handle;
+        }
+        auto endpointIt = endpointIndex_.find(peerId);
+        if (endpointIt != endpointIndex_.end()) {
+            return endpointIt->second;
+        }
+        return std::nullopt;
+    }
+    
+    // Caller holds socketsMutex_. Connections yet to begin a handshake are
+    // bounded apart from the rest, so a crowd of them can't hold out peers.
+    bool AtConnectionLimit() {
+        auto waiting = [this]() { return connections_.size() - freeHandles_.size() - admittedConnections_; };
+        if (admittedConnections_ < rateLimits_.maxConnections && waiting() < rateLimits_.maxConnections) {
+            return false;
+        }
+        ExpireHandshakes(std::chrono::steady_clock::now());
+        return admittedConnections_ >= rateLimits_.maxConnections || waiting() >= rateLimits_.maxConnections;
+    }
+    
+    // Caller holds a ConnectionsLock. Releases incoming connections that
+    // haven't identified themselves within the handshake timeout; a handshake
+    // still on the pool finds its connection gone and drops out.
+    void ExpireHandshakes(std::chrono::steady_clock::time_point now) {
+        auto timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(rateLimits_.handshakeTimeout));
+        nextHandshakeSweep_ = now + std::chrono::seconds(1);
+        for (ConnectionHandle h = 0; h < connections_.size(); ++h) {
+            if (IsUnidentified(connections_[h]) && now - connections_[h].opened >= timeout) {
+                ReleaseConnection(h);
+            }
+        }
+    }
+    
+    // Caller holds a ConnectionsLock; sweeps about once a second
+    void MaybeExpireHandshakes() {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextHandshakeSweep_) {
+            ExpireHandshakes(now);
+        }
+    }
+    
+    static bool IsUnidentified(const Connection& conn) {
+        return conn.kind == Connection::Kind::Incoming && !conn.peer;
+    }
+    
+    // Anything but a well-formed handshake, in time, costs a connection that
+    // hasn't identified itself its table entry; one with a peer keeps it
+    void DropIfUnidentified(ConnectionHandle handle, uint32_t generation) {
+        ConnectionsLock lock(*this);
+        if (IsCurrent(handle, generation) && IsUnidentified(connections_[handle])) {
+            ReleaseConnection(handle);
+        }
+    }
+    
+    // kNoConnection for a new peer once the table is at its admission limit
+    ConnectionHandle IncomingConnection(std::string_view routingId) {
+        auto it = routingIndex_.find(routingId);
+        if (it != routingIndex_.end()) {
+            return it->second;
+        }
+        if (AtConnectionLimit()) {
+            return kNoConnection;
+        }
+        auto handle = AllocateConnection(Connection::Kind::Incoming);
+        connections_[handle].routingId = routingId;
+        routingIndex_.emplace(connections_[handle].routingId, handle);
+        return handle;
+    }
+    
+    static std::span<const uint8_t> AsBytes(const zmq::message_t& frame) {
+        return { static_cast<const uint8_t*>(frame.data()), frame.size() };
+    }
+    
+    // One allocation per send: the message is serialized straight into the zmq frame
+    static zmq::message_t SerializeFrame(const Message& message) {
+        zmq::message_t frame(message.GetSerializedSize());
+        message.SerializeTo(static_cast<uint8_t*>(frame.data()));
+        return frame;
+    }
+    
+    // For fan-out; zmq shares the frame's buffer between copies instead of duplicating it
+    bool SendSharedFrame(ConnectionHandle handle, zmq::message_t& frame) {
+        zmq::message_t copy;
+        copy.copy(frame);
+        return SendFrame(handle, copy);
+    }
+    
+    // Only a shard's own reactor sends on its sockets; from any other thread
+    // the frame is queued on the owner's inbox
+    bool SendFrame(ConnectionHandle handle, zmq::message_t& frame) {
+        auto& conn = connections_[handle];
+        if (conn.kind == Connection::Kind::Free) {
+            return false;
+        }
+        if (!shards_.empty()) {
+            auto& owner = *shards_[conn.shard % shards_.size()];
+            if (tCurrentShard != &owner) {
+                ShardCommand send;
+                send.handle = handle;
+                send.generation = conn.generation;
+                send.frame = std::move(frame);
+                owner.Post(std::move(send));
+                return true;
+            }
+        }
+        return SendOwned(conn, frame);
+    }
+    
+    // Caller owns the connection's socket: it's this shard's, or nothing is running
+    bool SendOwned(Connection& conn, zmq::message_t& frame) {
+        if (transport_) {
+            return conn.transportId != Transport::kNoConnection &&
+                   transport_->Send(conn.transportId, AsBytes(frame));
+        }
+        try {
+            if (conn.kind == Connection::Kind::Outgoing) {
+                return conn.socket->send(frame, zmq::send_flags::dontwait).has_value();
+            }
+            if (conn.kind == Connection::Kind::Incoming && routerSocket_) {
+                zmq::message_t idMsg(conn.routingId.data(), conn.routingId.size());
+                routerSocket_->send(idMsg, zmq::send_flags::sndmore);
+                return routerSocket_->send(frame, zmq::send_flags::dontwait).has_value();
+            }
+        } catch (const zmq::error_t& e) {
+            std::cerr << "Failed to send message: " << e.what() << std::endl;
+        }
+        return false;
+    }
+    
+    // Reactor loop for one shard: polls the sockets it owns (and the router, on
+    // shard 0), then applies the sends and closes queued on its inbox
+    void RunShard(Shard& shard) {
+        tCurrentShard = &shard;
+        MessageArena arena;
+        ShardLimiter limiter;
+        std::vector<zmq::pollitem_t> items;
+        std::vector<PolledSocket> polled; // Parallel to items
+        uint64_t version = 0;
+        bool stale = true;
+        
+        while (running_) {
+            // Rebuild the poll set only when outgoing sockets have come or gone
+            uint64_t current = socketsVersion_.load();
+            if (stale || current != version) {
+                version = current;
+                stale = false;
+                BuildPollSet(shard, items, polled);
+            }
+            
+            try {
+                zmq::poll(items.data(), items.size(), std::chrono::milliseconds(100));
+                limiter.now = TokenBucket::Clock::now();
+                
+                if (items[0].revents & ZMQ_POLLIN) {
+                    shard.ClearWake();
+                }
+                for (size_t i = 1; i < items.size(); ++i) {
+                    if (!(items[i].revents & ZMQ_POLLIN)) continue;
+                    if (polled[i].handle == kNoConnection) {
+                        ReceiveFromRouter(arena, limiter);
+                    } else {
+                        ReceiveFromDealer(polled[i], arena, limiter);
+                    }
+                }
+            } catch (const zmq::error_t& e) {
+                if (running_) {
+                    std::cerr << "Shard " << shard.index << " poll error: " << e.what() << std::endl;
+                }
+            }
+            
+            // The batch's handshakes are done with; drop their payloads at once
+            arena.Reset();
+            ApplyInbox(shard);
+            
+            // Shard 0 also sweeps out connections that never identified themselves
+            if (shard.index == 0) {
+                ConnectionsLock lock(*this);
+                MaybeExpireHandshakes();
+            }
+        }
+        
+        // Flush what the last handlers sent
+        ApplyInbox(shard);
+        tCurrentShard = nullptr;
+    }
+    
+    struct PolledSocket {
+        ConnectionHandle handle = kNoConnection; // kNoConnection for the wake pipe and router
+        uint32_t generation = 0;
+        zmq::socket_t* socket = nullptr;
+    };
     
-    ~Impl() {
-        Stop();
+    void BuildPollSet(Shard& shard, std::vector<zmq::pollitem_t>& items, std::vector<PolledSocket>& polled) {
+        items.clear();
+        polled.clear();
+        
+        items.push_back({ nullptr, shard.wakeFds[0], ZMQ_POLLIN, 0 });
+        polled.emplace_back();
+        if (shard.index == 0 && routerSocket_) {
+            items.push_back({ static_cast<void*>(*routerSocket_), 0, ZMQ_POLLIN, 0 });
+            polled.push_back({ kNoConnection, 0, routerSocket_.get() });
+        }
+        
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        for (ConnectionHandle h = 0; h < connections_.size(); ++h) {
+            auto& conn = connections_[h];
+            if (conn.kind == Connection::Kind::Outgoing && conn.socket &&
+                conn.shard % shards_.size() == shard.index) {
+                items.push_back({ static_cast<void*>(*conn.socket), 0, ZMQ_POLLIN, 0 });
+                polled.push_back({ h, conn.generation, conn.socket.get() });
+            }
+        }
     }
     
-    void Start(uint16_t port) {
-        if (running_) return;
-        
-        listenPort_ = port;
-        running_ = true;
+    void ReceiveFromRouter(MessageArena& arena, ShardLimiter& limiter) {
+        zmq::message_t identity;
+        zmq::message_t msgFrame;
         
-        try {
-            // Create router socket for incoming connections
-            routerSocket_ = std::make_unique<zmq::socket_t>(context_, zmq::socket_type::router);
-            routerSocket_->set(zmq::sockopt::router_mandatory, 1);
-            routerSocket_->set(zmq::sockopt::linger, 0);
+        for (int i = 0; i < kReceiveBatch; ++i) {
+            // Receive identity frame
+            auto result1 = routerSocket_->recv(identity, zmq::recv_flags::dontwait);
+            if (!result1) break;
             
-            std::string bindAddr = "tcp://*:" + std::to_string(port);
-            routerSocket_->bind(bindAddr);
+            // Receive message frame
+            auto result2 = routerSocket_->recv(msgFrame);
+            if (!result2) break;
             
-            // Start worker threads
-            routerThread_ = std::thread([this]() { RouteMessages(); });
-            pollerThread_ = std::thread([this]() { PollMessages(); });
-        } catch (const zmq::error_t& e) {
-            running_ = false;
-            routerSocket_.reset();
-            throw;
+            ConnectionHandle handle;
+            uint32_t generation;
+            {
+                ConnectionsLock lock(*this);
+                handle = IncomingConnection(
+                    std::string_view(static_cast<char*>(identity.data()), identity.size()));
+                if (handle == kNoConnection) {
+                    refusedConnections_.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                generation = connections_[handle].generation;
+            }
+            HandleFrame(handle, generation, AsBytes(msgFrame), &msgFrame, arena.GetResource(), limiter);
         }
     }
     
-    void Stop() {
-        if (!running_) return;
-        
-        running_ = false;
-        
-        // Close all sockets
+    // The socket stays open until this reactor applies its close, so it can be
+    // read without the lock even if the connection was released meanwhile
+    void ReceiveFromDealer(const PolledSocket& polled, MessageArena& arena, ShardLimiter& limiter) {
         {
             std::lock_guard<std::mutex> lock(socketsMutex_);
-            dealerSockets_.clear();
+            if (polled.handle >= connections_.size() ||
+                connections_[polled.handle].generation != polled.generation) {
+                return;
+            }
         }
         
-        if (routerSocket_) {
-            routerSocket_->close();
-            routerSocket_.reset();
+        for (int i = 0; i < kReceiveBatch; ++i) {
+            zmq::message_t msgFrame;
+            if (!polled.socket->recv(msgFrame, zmq::recv_flags::dontwait)) break;
+            HandleFrame(polled.handle, polled.generation, AsBytes(msgFrame), &msgFrame, arena.GetResource(), limiter);
         }
-        
-        // Wait for threads
-        if (routerThread_.joinable()) {
-            routerThread_.join();
+    }
+    
+    // On the transport's threads. Frames that arrive before Start() or after
+    // Stop() are dropped.
+    void OnTransportFrame(Transport::ConnectionId id, std::span<const uint8_t> frame) {
+        std::lock_guard<std::mutex> receive(transportReceiveMutex_);
+        if (!running_) {
+            return;
         }
-        if (pollerThread_.joinable()) {
-            pollerThread_.join();
+        
+        ConnectionHandle handle;
+        uint32_t generation;
+        {
+            std::lock_guard<std::mutex> lock(socketsMutex_);
+            auto it = transportIndex_.find(id);
+            if (it == transportIndex_.end()) {
+                return;
+            }
+            handle = it->second;
+            generation = connections_[handle].generation;
         }
+        transportLimiter_.now = TokenBucket::Clock::now();
+        HandleFrame(handle, generation, frame, nullptr, transportArena_.GetResource(), transportLimiter_);
+        transportArena_.Reset();
     }
     
-    void ConnectToPeer(const std::string& address, uint16_t port) {
-        std::lock_guard<std::mutex> lock(socketsMutex_);
-        
-        try {
-            // Create a dealer socket for this peer
-            auto dealer = std::make_unique<zmq::socket_t>(context_, zmq::socket_type::dealer);
-            
-            // Set identity to our peer ID
-            auto localPeer = peerManager_.GetLocalPeer();
-            std::string identity = localPeer.id;
-            dealer->set(zmq::sockopt::routing_id, identity);
-            dealer->set(zmq::sockopt::linger, 0);
-            
-            // Connect to peer
-            std::string connectAddr = "tcp://" + address + ":" + std::to_string(port);
-            dealer->connect(connectAddr);
+    void OnTransportConnection(Transport::ConnectionId id, bool connected) {
+        PeerHandle lost;
+        {
+            ConnectionsLock lock(*this);
+            MaybeExpireHandshakes();
+            if (connected) {
+                if (AtConnectionLimit()) {
+                    refusedConnections_.fetch_add(1, std::memory_order_relaxed);
+                    transportClosing_.push_back(id);
+                    return;
+                }
+                auto handle = AllocateConnection(Connection::Kind::Incoming);
+                connections_[handle].transportId = id;
+                transportIndex_[id] = handle;
+                return;
+            }
             
-            // Store the socket
-            std::string peerKey = address + ":" + std::to_string(port);
-            dealerSockets_[peerKey] = std::move(dealer);
+            auto it = transportIndex_.find(id);
+            if (it == transportIndex_.end()) {
+                return;
+            }
+            auto handle = it->second;
+            connections_[handle].transportId = Transport::kNoConnection; // Already closed
+            transportIndex_.erase(it);
             
-            // Send handshake
-            auto handshake = Message::CreateHandshakeMessage(localPeer.id, localPeer.publicKey);
-            SendToPeer(peerKey, handshake);
-        } catch (const zmq::error_t& e) {
-            std::cerr << "Failed to connect to peer " << address << ":" << port << ": " << e.what() << std::endl;
-            throw;
+            // Losing the connection we send on loses the peer, as DisconnectPeer would
+            if (!IsPrimary(handle)) {
+                ReleaseConnection(handle);
+                return;
+            }
+            lost = connections_[handle].peer;
+            for (ConnectionHandle h = 0; h < connections_.size(); ++h) {
+                if (connections_[h].kind != Connection::Kind::Free && connections_[h].peer == lost) {
+                    ReleaseConnection(h);
+                }
+            }
+        }
+        
+        if (connectionHandler_) {
+            connectionHandler_(lost, false);
         }
     }
     
-    void DisconnectPeer(const std::string& peerId) {
-        std::lock_guard<std::mutex> lock(socketsMutex_);
+    void ApplyInbox(Shard& shard) {
+        std::vector<ShardCommand> sends;
+        ShardCommand command;
         
-        // Find and remove socket for this peer
-        auto it = dealerSockets_.find(peerId);
-        if (it != dealerSockets_.end()) {
-            dealerSockets_.erase(it);
+        for (int batch = 0; batch < kInboxBatchesPerWakeup; ++batch) {
+            sends.clear();
+            while (sends.size() < kInboxBatch && shard.inbox.Pop(command)) {
+                if (command.socket) {
+                    command.socket.reset(); // A released connection's socket
+                } else {
+                    sends.push_back(std::move(command));
+                }
+            }
+            if (sends.empty()) {
+                return;
+            }
             
-            if (connectionHandler_) {
-                connectionHandler_(peerId, false);
+            std::lock_guard<std::mutex> lock(socketsMutex_);
+            for (auto& send : sends) {
+                if (IsCurrent(send.handle, send.generation)) {
+                    SendOwned(connections_[send.handle], send.frame);
+                }
             }
         }
+        
+        // Still busy: come straight back after checking the sockets
+        shard.Wake();
     }
     
-    void SendMessage(const std::string& peerId, const Message& message) {
-        SendToPeer(peerId, message);
-    }
-    
-    void BroadcastMessage(const Message& message) {
-        std::lock_guard<std::mutex> lock(socketsMutex_);
+    // Handshake frames are picked apart on the spot, so their payloads are
+    // decoded into the reactor's arena and die with the batch. Everything
+    // else is headed for the handler pool, so it's decoded onto the heap and
+    // moved there. `received` is the zmq frame the bytes came in, which
+    // relaying can forward without a copy; null when a transport only lends them.
+    void HandleFrame(ConnectionHandle handle, uint32_t generation, std::span<const uint8_t> frame,
+                     zmq::message_t* received, std::pmr::memory_resource* arena, ShardLimiter& limiter) {
+        auto data = frame.data();
         
-        // Send to all connected peers
-        for (const auto& [peerId, socket] : dealerSockets_) {
-            SendToPeer(peerId, message);
+        // Size and rate limits only need the header, so neither an oversized
+        // frame nor a flood costs any decoding. The transport has already
+        // refused frames past the overall limit without reading them in.
+        auto header = frameLimits_.Validate(data, frame.size());
+        if (!header) {
+            rejectedFrames_.fetch_add(1, std::memory_order_relaxed);
+            DropIfUnidentified(handle, generation);
+            return;
+        }
+        if (!Admit(limiter, handle, generation, header->type)) {
+            DropIfUnidentified(handle, generation);
+            return;
         }
         
-        // Also send to any peers connected to our router
-        auto connectedPeers = peerManager_.GetAllPeers();
-        for (const auto& peer : connectedPeers) {
-            if (peer.isConnected) {
-                SendViaRouter(peer.id, message);
+        // Relay frames are routed on their header alone, without deserializing
+        if (header->type == MessageType::RELAY) {
+            if (!HandleRelayFrame(handle, frame, received)) {
+                DropIfUnidentified(handle, generation);
             }
+            return;
+        }
+        
+        try {
+            auto* resource = IsHandshake(header->type) ? arena : std::pmr::get_default_resource();
+            HandleMessage(handle, Message::Deserialize(data, frame.size(), resource));
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to deserialize message: " << e.what() << std::endl;
+            DropIfUnidentified(handle, generation);
         }
     }
     
-    std::vector<std::string> GetConnectedPeers() const {
-        std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(socketsMutex_));
-        std::vector<std::string> peers;
-        
-        // Get peers from dealer sockets
-        for (const auto& [peerId, socket] : dealerSockets_) {
-            peers.push_back(peerId);
+    // Charges one token to the connection's bucket, then to the node-wide
+    // bucket for the frame's kind
+    bool Admit(ShardLimiter& limiter, ConnectionHandle handle, uint32_t generation, MessageType type) {
+        if (handle >= limiter.peers.size()) {
+            limiter.peers.resize(handle + 1);
         }
-        
-        // Also get peers connected to router
-        auto allPeers = peerManager_.GetAllPeers();
-        for (const auto& peer : allPeers) {
-            if (peer.isConnected) {
-                peers.push_back(peer.id);
-            }
+        auto& peer = limiter.peers[handle];
+        if (!peer.active || peer.generation != generation) {
+            peer.generation = generation;
+            peer.active = true;
+            peer.bucket = TokenBucket(rateLimits_.peerMessageRate, rateLimits_.peerMessageBurst);
         }
         
-        return peers;
+        bool handshake = IsHandshake(type);
+        if (!peer.bucket.TryTake(limiter.now) ||
+            !TakeShared(handshake ? globalHandshakes_ : globalMessages_,
+                        handshake ? limiter.handshakeTokens : limiter.messageTokens, limiter.now)) {
+            (handshake ? throttledHandshakes_ : throttledMessages_).fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
     }
     
-private:
-    void SendToPeer(const std::string& peerId, const Message& message) {
-        std::lock_guard<std::mutex> lock(socketsMutex_);
-        
-        auto it = dealerSockets_.find(peerId);
-        if (it != dealerSockets_.end()) {
-            try {
-                auto data = message.Serialize();
-                zmq::message_t msg(data.data(), data.size());
-                it->second->send(msg, zmq::send_flags::dontwait);
-            } catch (const zmq::error_t& e) {
-                std::cerr << "Failed to send message: " << e.what() << std::endl;
-            }
+    static bool IsHandshake(MessageType type) {
+        return type == MessageType::HANDSHAKE || type == MessageType::AUTH_CHALLENGE ||
+               type == MessageType::AUTH_RESPONSE;
+    }
+    
+    static bool TakeShared(SharedBucket& shared, double& leased, TokenBucket::Clock::time_point now) {
+        if (leased < 1.0) {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            leased += shared.bucket.TakeUpTo(now, kGlobalTokenLease);
         }
+        if (leased < 1.0) {
+            return false;
+        }
+        leased -= 1.0;
+        return true;
     }
     
-    void SendViaRouter(const std::string& peerId, const Message& message) {
-        if (!routerSocket_) return;
+    // False for a malformed frame, or one from a connection without a
+    // handshaken peer; frames dropped for other reasons count as handled
+    bool HandleRelayFrame(ConnectionHandle handle, std::span<const uint8_t> frame, zmq::message_t* received) {
+        auto route = Message::PeekRelayRoute(frame.data(), frame.size());
+        if (!route) {
+            std::cerr << "Dropping malformed relay frame" << std::endl;
+            return false;
+        }
         
-        try {
-            // Send peer ID frame
-            zmq::message_t idMsg(peerId.data(), peerId.size());
-            routerSocket_->send(idMsg, zmq::send_flags::sndmore);
+        const auto& localPeer = peerManager_.GetLocalPeer();
+        if (route->targetId == localPeer.id) {
+            // Only a peer that has finished its handshake may hand us relayed frames
+            PeerHandle relay;
+            {
+                std::lock_guard<std::mutex> lock(socketsMutex_);
+                if (handle >= connections_.size() || !connections_[handle].peer ||
+                    connections_[handle].handshakePending) {
+                    return false;
+                }
+                relay = connections_[handle].peer;
+            }
             
-            // Send message
-            auto data = message.Serialize();
-            zmq::message_t msg(data.data(), data.size());
-            routerSocket_->send(msg, zmq::send_flags::dontwait);
-        } catch (const zmq::error_t& e) {
-            // Peer might not be connected via router
+            // A source we've never met is dropped rather than interned, so
+            // relayed frames can't grow the peer ID table. Only peers we've
+            // added count, not the relayed-by names below.
+            auto source = peerManager_.FindPeerHandle(route->sourceId);
+            auto sourceInfo = source ? peerManager_.GetPeer(source) : std::nullopt;
+            if (!sourceInfo) {
+                return true;
+            }
+            
+            // We're the destination: unwrap and handle as if the source sent it directly
+            if (!frameLimits_.Validate(route->frame, route->frameSize)) {
+                rejectedFrames_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            Message inner;
+            try {
+                inner = Message::Deserialize(route->frame, route->frameSize);
+            } catch (const std::exception& e) {
+                std::cerr << "Failed to deserialize relayed message: " << e.what() << std::endl;
+                return true;
+            }
+            if (IsHandshake(inner.GetType()) || inner.GetType() == MessageType::RELAY) {
+                return true;
+            }
+            
+            // A peer relaying its own frame is already authenticated
+            if (relay == source) {
+                handlerPool_->Post(source, std::move(inner));
+                return true;
+            }
+            
+            // Anyone else's claim of the source needs the source's signature
+            // for this relay; without it the frame is only the relay's word
+            auto relayId = peerManager_.GetPeerId(relay);
+            if (!crypto_ || route->signature.empty() || sourceInfo->publicKey.empty() ||
+                relayId.size() > kMaxPeerIdSize || relayChecksInFlight_ >= kMaxHandshakesInFlight) {
+                handlerPool_->Post(RelayedBy(route->sourceId, relayId), std::move(inner));
+                return true;
+            }
+            auto transcript = RelayTranscript(route->sourceId, relayId, route->targetId,
+                                              {route->frame, route->frameSize});
+            std::vector<uint8_t> signature(route->signature.begin(), route->signature.end());
+            ++relayChecksInFlight_;
+            handshakeExecutor_->Submit([this, source, relayId = std::move(relayId),
+                                        publicKey = std::move(sourceInfo->publicKey),
+                                        transcript = std::move(transcript), signature = std::move(signature),
+                                        inner = std::move(inner)]() mutable {
+                auto sender = crypto_->Verify(transcript, signature, publicKey)
+                                  ? source
+                                  : RelayedBy(peerManager_.GetPeerId(source), relayId);
+                handlerPool_->Post(sender, std::move(inner));
+                --relayChecksInFlight_;
+            });
+            return true;
+        }
+        
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        if (handle >= connections_.size() || !connections_[handle].peer) {
+            return false;
+        }
+        
+        // Only forward frames whose claimed source is the peer that handed them to us
+        if (!relayEnabled_ || route->sourceId != peerManager_.GetPeerId(connections_[handle].peer)) {
+            return true;
+        }
+        
+        auto target = PrimaryConnection(peerManager_.FindPeerHandle(route->targetId));
+        if (target == kNoConnection) {
+            return true;
+        }
+        
+        // Forward the received frame itself; zmq hands the buffer over without
+        // copying. A transport's buffer is only lent for the call, so copy that.
+        zmq::message_t copy;
+        if (!received) {
+            copy = zmq::message_t(frame.data(), frame.size());
+            received = &copy;
+        }
+        if (SendFrame(target, *received)) {
+            ++relayedMessages_;
         }
+        return true;
     }
     
-    void RouteMessages() {
-        while (running_) {
-            try {
-                zmq::pollitem_t items[] = {
-                    { static_cast<void*>(*routerSocket_), 0, ZMQ_POLLIN, 0 }
-                };
-                
-                zmq::poll(items, 1, std::chrono::milliseconds(100));
-                
-                if (items[0].revents & ZMQ_POLLIN) {
-                    // Receive identity frame
-                    zmq::message_t identity;
-                    auto result1 = routerSocket_->recv(identity);
-                    if (!result1) continue;
-                    
-                    // Receive message frame
-                    zmq::message_t msgFrame;
-                    auto result2 = routerSocket_->recv(msgFrame);
-                    if (!result2) continue;
-                    
-                    // Process message
-                    std::string senderId(static_cast<char*>(identity.data()), identity.size());
-                    std::vector<uint8_t> data(static_cast<uint8_t*>(msgFrame.data()), 
-                                             static_cast<uint8_t*>(msgFrame.data()) + msgFrame.size());
-                    
-                    try {
-                        Message msg = Message::Deserialize(data);
-                        HandleMessage(senderId, msg);
-                    } catch (const std::exception& e) {
-                        std::cerr << "Failed to deserialize message: " << e.what() << std::endl;
+    // Who a relayed frame is from when we can't confirm its claimed source:
+    // "<source>@<relay>", so handlers never mistake it for the source itself.
+    // Both are peers we've added, which keeps these names bounded.
+    PeerHandle RelayedBy(std::string_view sourceId, std::string_view relayId) {
+        std::string name;
+        name.reserve(sourceId.size() + 1 + relayId.size());
+        name.append(sourceId).append(1, '@').append(relayId);
+        return peerManager_.InternPeerId(name);
+    }
+    
+    // Only handshake frames may be arena-backed; the rest are moved on
+    void HandleMessage(ConnectionHandle handle, Message&& msg) {
+        PeerHandle sender;
+        {
+            ConnectionsLock lock(*this);
+            if (handle >= connections_.size() || connections_[handle].kind == Connection::Kind::Free) {
+                return;
+            }
+            auto& conn = connections_[handle];
+            auto type = msg.GetType();
+            
+            // Keep what the peer pipelined behind its handshake, in order. The
+            // response to our challenge is the one frame a parked connection waits for.
+            if (conn.handshakePending &&
+                !(type == MessageType::AUTH_RESPONSE && conn.auth.awaitingResponse)) {
+                if (conn.parked.size() < kMaxParkedMessages) {
+                    conn.parked.push_back(IsHandshake(type) ? Message(msg) : std::move(msg));
+                }
+                return;
+            }
+            
+            // Handshake frames go to the handshake pool, never straight to handlers
+            if (type == MessageType::HANDSHAKE || type == MessageType::AUTH_CHALLENGE ||
+                type == MessageType::AUTH_RESPONSE) {
+                if (!acceptingHandshakes_) {
+                    return;
+                }
+                // A connection counts against the limit from its first handshake frame
+                if (!conn.admitted) {
+                    if (admittedConnections_ >= rateLimits_.maxConnections) {
+                        refusedConnections_.fetch_add(1, std::memory_order_relaxed);
+                        ReleaseConnection(handle);
+                        return;
                     }
+                    conn.admitted = true;
+                    ++admittedConnections_;
                 }
-            } catch (const zmq::error_t& e) {
-                if (running_) {
-                    std::cerr << "Router error: " << e.what() << std::endl;
+                if (!BeginHandshake(handle, msg)) {
+                    ++rejectedHandshakes_;
+                    if (!conn.peer) {
+                        ReleaseConnection(handle);
+                    }
                 }
+                return;
             }
+            
+            // Nothing but a handshake is accepted before the peer has identified itself
+            if (IsUnidentified(conn)) {
+                ReleaseConnection(handle);
+                return;
+            }
+            sender = conn.peer;
+        }
+        
+        if (sender) {
+            peerManager_.TouchPeer(sender);
+            handlerPool_->Post(sender, std::move(msg));
         }
     }
     
-    void PollMessages() {
-        while (running_) {
-            std::vector<zmq::pollitem_t> items;
-            std::vector<std::string> peerIds;
-            
-            {
-                std::lock_guard<std::mutex> lock(socketsMutex_);
-                for (const auto& [peerId, socket] : dealerSockets_) {
-                    items.push_back({ static_cast<void*>(*socket), 0, ZMQ_POLLIN, 0 });
-                    peerIds.push_back(peerId);
-                }
+    // Caller holds socketsMutex_. Applies the cheap checks here on the reactor,
+    // then parks the connection and hands the crypto to the handshake pool.
+    // Returns false if the frame was rejected outright.
+    bool BeginHandshake(ConnectionHandle handle, const Message& msg) {
+        if (handshakesInFlight_ >= kMaxHandshakesInFlight) {
+            return false;
+        }
+        
+        auto& conn = connections_[handle];
+        PendingHandshake pending;
+        pending.handle = handle;
+        pending.generation = conn.generation;
+        pending.incoming = conn.kind == Connection::Kind::Incoming;
+        pending.remote = conn.remote;
+        pending.host = conn.host;
+        
+        switch (msg.GetType()) {
+        case MessageType::HANDSHAKE: {
+            // With an identity of our own, peers have to prove theirs too
+            auto handshake = schema::Handshake::Parse(msg);
+            if (crypto_ || !handshake) {
+                return false;
             }
-            
-            if (items.empty()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                continue;
+            pending.peerId = handshake->Get<schema::Handshake::kPeerId>();
+            auto publicKey = handshake->Get<schema::Handshake::kPublicKey>();
+            pending.publicKey.assign(publicKey.begin(), publicKey.end());
+            pending.message = msg;
+            break;
+        }
+        case MessageType::AUTH_CHALLENGE: {
+            auto challenge = schema::AuthChallenge::Parse(msg);
+            if (!crypto_ || !challenge) {
+                return false;
+            }
+            auto peerId = challenge->Get<schema::AuthChallenge::kPeerId>();
+            auto publicKey = challenge->Get<schema::AuthChallenge::kPublicKey>();
+            auto nonce = challenge->Get<schema::AuthChallenge::kNonce>();
+            auto signature = challenge->Get<schema::AuthChallenge::kSignature>();
+            if (peerId.empty() || peerId.size() > kMaxPeerIdSize || publicKey.empty() ||
+                publicKey.size() > kMaxPublicKeySize || nonce.size() != kNonceSize) {
+                return false;
             }
             
-            try {
-                zmq::poll(items.data(), items.size(), std::chrono::milliseconds(100));
-                
-                for (size_t i = 0; i < items.size(); ++i) {
-                    if (items[i].revents & ZMQ_POLLIN) {
-                        zmq::message_t msgFrame;
-                        
-                        std::lock_guard<std::mutex> lock(socketsMutex_);
-                        auto it = dealerSockets_.find(peerIds[i]);
-                        if (it != dealerSockets_.end()) {
-                            auto result = it->second->recv(msgFrame);
-                            if (!result) continue;
-                            
-                            std::vector<uint8_t> data(static_cast<uint8_t*>(msgFrame.data()), 
-                                                     static_cast<uint8_t*>(msgFrame.data()) + msgFrame.size());
-                            
-                            try {
-                                Message msg = Message::Deserialize(data);
-                                HandleMessage(peerIds[i], msg);
-                            } catch (const std::exception& e) {
-                                std::cerr << "Failed to deserialize message: " << e.what() << std::endl;
-                            }
-                        }
-                    }
+            if (pending.incoming) {
+                // A fresh challenge; a replayed one isn't worth signing again
+                if (!signature.empty() || !replayCache_.Insert(nonce)) {
+                    return false;
                 }
-            } catch (const zmq::error_t& e) {
-                if (running_) {
-                    std::cerr << "Poll error: " << e.what() << std::endl;
+                pending.step = PendingHandshake::Step::Challenge;
+            } else {
+                // The answer to the challenge we sent, which is only good once
+                if (signature.empty() || conn.auth.challenge.empty()) {
+                    return false;
                 }
+                pending.step = PendingHandshake::Step::Answer;
+                pending.challenge = std::move(conn.auth.challenge);
+                conn.auth.challenge.clear();
+                pending.signature.assign(signature.begin(), signature.end());
+            }
+            pending.peerId = peerId;
+            pending.publicKey.assign(publicKey.begin(), publicKey.end());
+            pending.nonce.assign(nonce.begin(), nonce.end());
+            break;
+        }
+        case MessageType::AUTH_RESPONSE: {
+            auto response = schema::AuthResponse::Parse(msg);
+            if (!response || !conn.auth.awaitingResponse ||
+                response->Get<schema::AuthResponse::kSignature>().empty()) {
+                return false;
             }
+            auto signature = response->Get<schema::AuthResponse::kSignature>();
+            pending.step = PendingHandshake::Step::Response;
+            pending.signature.assign(signature.begin(), signature.end());
+            pending.challenge = std::move(conn.auth.challenge);
+            pending.nonce = std::move(conn.auth.peerNonce);
+            pending.peerId = std::move(conn.auth.peerId);
+            pending.publicKey = std::move(conn.auth.publicKey);
+            conn.auth = Connection::Auth{};
+            break;
+        }
+        default:
+            return false;
         }
+        
+        conn.handshakePending = true;
+        ++handshakesInFlight_;
+        handshakeExecutor_->Submit([this, pending = std::move(pending)]() mutable {
+            CompleteHandshake(pending);
+            --handshakesInFlight_;
+        });
+        return true;
     }
     
-    void HandleMessage(const std::string& senderId, const Message& msg) {
-        if (msg.GetType() == MessageType::HANDSHAKE) {
-            auto payload = msg.GetPayload();
-            if (payload.size() >= 2) {
-                uint16_t idLen = (static_cast<uint16_t>(payload[0]) << 8) | payload[1];
-                if (payload.size() >= static_cast<size_t>(2 + idLen)) {
-                    std::string peerId(payload.begin() + 2, payload.begin() + 2 + idLen);
-                    std::vector<uint8_t> publicKey(payload.begin() + 2 + idLen, payload.end());
-                    
-                    // Update peer info
-                    PeerInfo peer;
-                    peer.id = peerId;
-                    peer.publicKey = publicKey;
-                    peer.isConnected = true;
-                    peer.lastSeen = std::chrono::system_clock::now();
-                    
-                    // For incoming connections via router, we don't have address/port
-                    // For outgoing, parse from senderId if it's in address:port format
-                    auto colonPos = senderId.find(':');
-                    if (colonPos != std::string::npos) {
-                        peer.address = senderId.substr(0, colonPos);
-                        peer.port = std::stoi(senderId.substr(colonPos + 1));
-                    }
-                    
-                    peerManager_.AddPeer(peer);
-                    
-                    if (connectionHandler_) {
-                        connectionHandler_(peerId, true);
-                    }
-                    
-                    // Send handshake response if this is incoming
-                    if (senderId == peerId) {
-                        auto localPeer = peerManager_.GetLocalPeer();
-                        auto response = Message::CreateHandshakeMessage(localPeer.id, localPeer.publicKey);
-                        SendViaRouter(peerId, response);
-                    }
+    // Runs on the handshake pool
+    void CompleteHandshake(PendingHandshake& pending) {
+        if (pending.step == PendingHandshake::Step::Challenge) {
+            AnswerChallenge(pending);
+            return;
+        }
+        
+        HandshakeVerifier verifier;
+        {
+            std::lock_guard<std::mutex> lock(socketsMutex_);
+            verifier = handshakeVerifier_;
+        }
+        
+        const auto& localPeer = peerManager_.GetLocalPeer();
+        bool accepted = true;
+        std::optional<Message> reply;
+        if (pending.step == PendingHandshake::Step::Plain) {
+            if (pending.incoming) {
+                reply = Message::CreateHandshakeMessage(localPeer.id, localPeer.publicKey);
+            }
+        } else {
+            // The peer must have signed our challenge with the key it claims
+            bool answer = pending.step == PendingHandshake::Step::Answer;
+            accepted = crypto_->Verify(AuthTranscript(answer, pending.challenge, pending.nonce, pending.peerId),
+                                       pending.signature, pending.publicKey);
+            
+            // Then it's our turn to sign the challenge it sent us
+            if (accepted && answer) {
+                auto signature = crypto_->Sign(
+                    AuthTranscript(false, pending.nonce, pending.challenge, localPeer.id), privateKey_);
+                accepted = !signature.empty();
+                reply = Message::CreateAuthResponseMessage(signature);
+            }
+            
+            // Handlers see an authenticated peer arrive as a HANDSHAKE, like any other
+            pending.message = Message::CreateHandshakeMessage(pending.peerId, pending.publicKey);
+        }
+        accepted = accepted && (!verifier || verifier(pending.peerId, pending.publicKey));
+        
+        PeerInfo peer;
+        if (accepted) {
+            peer.id = pending.peerId;
+            peer.publicKey = std::move(pending.publicKey);
+            peer.isConnected = true;
+            peer.lastSeen = std::chrono::system_clock::now();
+            
+            // Unspecified for incoming connections, and for ipc and inproc ones
+            peer.endpoint = pending.remote;
+            peer.host = std::move(pending.host);
+        }
+        
+        PeerHandle sender;
+        bool newPeer = false;
+        {
+            ConnectionsLock lock(*this);
+            if (!IsCurrent(pending.handle, pending.generation)) {
+                return; // Dropped while we were verifying
+            }
+            auto& conn = connections_[pending.handle];
+            if (!accepted) {
+                std::cerr << "Rejected handshake from " << pending.peerId << std::endl;
+                ++rejectedHandshakes_;
+                ReleaseConnection(pending.handle);
+                return;
+            }
+            
+            // Only now that the connection is known to be live is the peer
+            // recorded as connected; a dropped one would leave it stranded
+            sender = peerManager_.AddPeer(peer);
+            
+            // Bind the peer to this connection. If the peer is already reachable
+            // over another connection (both sides connected), keep sending on that one.
+            conn.handshakePending = false;
+            conn.peer = sender;
+            if (sender.GetIndex() >= peerConnections_.size()) {
+                peerConnections_.resize(sender.GetIndex() + 1, kNoConnection);
+            }
+            auto& primary = peerConnections_[sender.GetIndex()];
+            if (primary == kNoConnection) {
+                primary = pending.handle;
+                newPeer = true;
+            } else if (primary != pending.handle && connections_[primary].kind == conn.kind) {
+                // The same way round as before, so the newer connection takes over;
+                // the peer sends on its newest too. A peer that dials our router
+                // again does so under a new routing ID, and nothing tells us the
+                // old one is gone, so that one is let go.
+                auto old = primary;
+                primary = pending.handle;
+                if (conn.kind == Connection::Kind::Incoming && !transport_) {
+                    ReleaseConnection(old);
                 }
             }
+            
+            // Our handshake for an incoming peer, or our response to its challenge
+            if (reply) {
+                auto frame = SerializeFrame(*reply);
+                SendFrame(pending.handle, frame);
+            }
+            
+            // Posted under the lock, so a frame the reactor receives next can't overtake these
+            peerManager_.TouchPeer(sender);
+            handlerPool_->Post(sender, std::move(pending.message));
+            for (auto& parked : conn.parked) {
+                handlerPool_->Post(sender, std::move(parked));
+            }
+            conn.parked.clear();
+        }
+        
+        if (newPeer && connectionHandler_) {
+            connectionHandler_(sender, true);
+        }
+    }
+    
+    // Runs on the handshake pool. Proves our key by signing the peer's
+    // challenge and challenges it back; the connection stays parked until the
+    // peer's response arrives.
+    void AnswerChallenge(PendingHandshake& pending) {
+        const auto& localPeer = peerManager_.GetLocalPeer();
+        auto challenge = crypto_->RandomBytes(kNonceSize);
+        auto signature = crypto_->Sign(AuthTranscript(true, pending.nonce, challenge, localPeer.id), privateKey_);
+        
+        ConnectionsLock lock(*this);
+        if (!IsCurrent(pending.handle, pending.generation)) {
+            return;
+        }
+        if (challenge.empty() || signature.empty()) {
+            ReleaseConnection(pending.handle);
+            return;
+        }
+        
+        auto answer = SerializeFrame(Message::CreateAuthChallengeMessage(
+            localPeer.id, localPeer.publicKey, challenge, signature));
+        auto& auth = connections_[pending.handle].auth;
+        auth.challenge = std::move(challenge);
+        auth.peerNonce = std::move(pending.nonce);
+        auth.peerId = std::move(pending.peerId);
+        auth.publicKey = std::move(pending.publicKey);
+        auth.awaitingResponse = true;
+        SendFrame(pending.handle, answer);
+    }
+    
+    void DispatchMessage(PeerHandle sender, const Message& msg) {
+        std::shared_lock<std::shared_mutex> lock(handlersMutex_);
+        for (const auto& handler : typedHandlers_[static_cast<uint8_t>(msg.GetType())]) {
+            handler(sender, msg);
         }
         
         // Forward to user handler
         if (userMessageHandler_) {
-            // Extract actual peer ID from handshake or use senderId
-            std::string actualPeerId = senderId;
-            if (msg.GetType() == MessageType::HANDSHAKE) {
-                auto payload = msg.GetPayload();
-                if (payload.size() >= 2) {
-                    uint16_t idLen = (static_cast<uint16_t>(payload[0]) << 8) | payload[1];
-                    if (payload.size() >= static_cast<size_t>(2 + idLen)) {
-                        actualPeerId = std::string(payload.begin() + 2, payload.begin() + 2 + idLen);
-                    }
-                }
-            }
-            userMessageHandler_(actualPeerId, msg);
+            userMessageHandler_(sender, msg);
         }
     }
 };
@@ -373,31 +1953,160 @@ void NetworkManager::Stop() {
     pImpl_->Stop();
 }
 
-void NetworkManager::ConnectToPeer(const std::string& address, uint16_t port) {
-    pImpl_->ConnectToPeer(address, port);
+void NetworkManager::ConnectToPeer(const std::string& address, uint16_t port,
+                                   const std::string& curveServerKey) {
+    pImpl_->ConnectToPeer(address, port, curveServerKey);
+}
+
+void NetworkManager::ConnectToPeer(const Endpoint& endpoint, const std::string& curveServerKey) {
+    pImpl_->ConnectToPeer(endpoint, curveServerKey);
+}
+
+void NetworkManager::ConnectToPeerAsync(const std::string& address, uint16_t port,
+                                        const std::string& curveServerKey, ConnectCallback callback) {
+    pImpl_->ConnectToPeerAsync(address, port, curveServerKey, std::move(callback));
+}
+
+std::future<void> NetworkManager::ConnectToPeerAsync(const std::string& address, uint16_t port,
+                                                     const std::string& curveServerKey) {
+    auto done = std::make_shared<std::promise<void>>();
+    auto future = done->get_future();
+    pImpl_->ConnectToPeerAsync(address, port, curveServerKey, [done](std::exception_ptr error) {
+        if (error) {
+            done->set_exception(error);
+        } else {
+            done->set_value();
+        }
+    });
+    return future;
 }
 
 void NetworkManager::DisconnectPeer(const std::string& peerId) {
     pImpl_->DisconnectPeer(peerId);
 }
 
+void NetworkManager::DisconnectPeer(PeerHandle peer) {
+    pImpl_->DisconnectPeer(peer);
+}
+
 void NetworkManager::SendMessage(const std::string& peerId, const Message& message) {
     pImpl_->SendMessage(peerId, message);
 }
 
+void NetworkManager::SendMessage(PeerHandle peer, const Message& message) {
+    pImpl_->SendMessage(peer, message);
+}
+
 void NetworkManager::BroadcastMessage(const Message& message) {
     pImpl_->BroadcastMessage(message);
 }
 
+void NetworkManager::MulticastMessage(const std::vector<PeerHandle>& peers, const Message& message) {
+    pImpl_->MulticastMessage(peers, message);
+}
+
+void NetworkManager::SetRelayEnabled(bool enabled) {
+    pImpl_->relayEnabled_ = enabled;
+}
+
+void NetworkManager::SendViaRelay(const std::string& relayPeerId, const std::string& targetPeerId,
+                                  const Message& message) {
+    pImpl_->SendViaRelay(relayPeerId, targetPeerId, message);
+}
+
+uint64_t NetworkManager::GetRelayedMessageCount() const {
+    return pImpl_->relayedMessages_;
+}
+
+void NetworkManager::Subscribe(MessageType type, MessageHandler handler) {
+    pImpl_->Subscribe(type, std::move(handler));
+}
+
 void NetworkManager::SetMessageHandler(MessageHandler handler) {
-    pImpl_->userMessageHandler_ = handler;
+    pImpl_->SetMessageHandler(std::move(handler));
+}
+
+void NetworkManager::SetShardCount(size_t count) {
+    pImpl_->shardCount_ = std::clamp<size_t>(count, 1, 0xFFFF);
+}
+
+void NetworkManager::SetTransport(std::unique_ptr<Transport> transport) {
+    pImpl_->SetTransport(std::move(transport));
+}
+
+void NetworkManager::SetHandlerThreadCount(size_t count) {
+    pImpl_->handlerThreads_ = count;
+}
+
+void NetworkManager::SetExecutor(Executor& executor) {
+    pImpl_->executor_ = &executor;
+}
+
+void NetworkManager::SetIdentity(CryptoManager& crypto, std::vector<uint8_t> privateKey) {
+    pImpl_->SetIdentity(crypto, std::move(privateKey));
+}
+
+void NetworkManager::ConnectToPeer(const std::string& endpoint, const std::string& curveServerKey) {
+    pImpl_->ConnectToEndpoint(endpoint, curveServerKey);
+}
+
+void NetworkManager::AddListenEndpoint(const std::string& endpoint) {
+    pImpl_->listenEndpoints_.push_back(endpoint);
+}
+
+void NetworkManager::SetLocalTransportsEnabled(bool enabled) {
+    pImpl_->localTransports_ = enabled;
+}
+
+void NetworkManager::SetCurveEnabled(bool enabled) {
+    pImpl_->SetCurveEnabled(enabled);
+}
+
+std::string NetworkManager::GetCurvePublicKey() const {
+    return pImpl_->GetCurvePublicKey();
+}
+
+uint64_t NetworkManager::GetRejectedHandshakeCount() const {
+    return pImpl_->rejectedHandshakes_;
+}
+
+void NetworkManager::SetRateLimits(const RateLimits& limits) {
+    pImpl_->rateLimits_ = limits;
+}
+
+NetworkManager::ThrottleStats NetworkManager::GetThrottleStats() const {
+    ThrottleStats stats;
+    stats.throttledMessages = pImpl_->throttledMessages_.load(std::memory_order_relaxed);
+    stats.throttledHandshakes = pImpl_->throttledHandshakes_.load(std::memory_order_relaxed);
+    stats.refusedConnections = pImpl_->refusedConnections_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void NetworkManager::SetMaxFrameSize(size_t bytes) {
+    pImpl_->frameLimits_.SetMaxFrameSize(bytes);
+}
+
+void NetworkManager::SetMaxPayloadSize(MessageType type, size_t bytes) {
+    pImpl_->frameLimits_.SetMaxPayloadSize(type, bytes);
+}
+
+uint64_t NetworkManager::GetRejectedFrameCount() const {
+    return pImpl_->rejectedFrames_.load(std::memory_order_relaxed);
+}
+
+void NetworkManager::SetHandshakeVerifier(HandshakeVerifier verifier) {
+    pImpl_->SetHandshakeVerifier(std::move(verifier));
+}
+
+void NetworkManager::SetHandshakeThreadCount(size_t count) {
+    pImpl_->handshakeThreads_ = std::max<size_t>(count, 1);
 }
 
 void NetworkManager::SetConnectionHandler(ConnectionHandler handler) {
     pImpl_->connectionHandler_ = handler;
 }
 
-std::vector<std::string> NetworkManager::GetConnectedPeers() const {
+std::vector<PeerHandle> NetworkManager::GetConnectedPeers() const {
     return pImpl_->GetConnectedPeers();
 }
 
@@ -1,6 +1,7 @@
 #include "Network.hpp"
 #include "Message.hpp"
 #include "PeerManager.hpp"
+#include "AcceptorPool.hpp"
 #include <boost/asio.hpp>
 #include <boost/asio/co_spawn.hpp>
 #include <boost/asio/detached.hpp>
@@ -50,6 +51,8 @@ public:
 
     const std::string& GetPeerId() const { return peerId_; }
     void SetPeerId(const std::string& id) { peerId_ = id; }
+    PeerHandle GetPeer() const { return peer_; }
+    void SetPeer(PeerHandle peer) { peer_ = peer; }
     bool HasPeerId() const { return !peerId_.empty(); }
     bool IsOutgoing() const { return isOutgoing_; }
     
@@ -94,7 +97,7 @@ private:
 
     void handleError() {
         if (connectionHandler_ && HasPeerId()) {
-            connectionHandler_(peerId_, false);
+            connectionHandler_(peer_, false);
         }
         socket_.close();
     }
@@ -103,13 +106,14 @@ private:
     InternalMessageHandler messageHandler_;
     NetworkManager::ConnectionHandler& connectionHandler_;
     std::string peerId_;
+    PeerHandle peer_;
     bool isOutgoing_;
 };
 
 struct NetworkManager::Impl {
     boost::asio::io_context& ioContext_;
     PeerManager& peerManager_;
-    std::unique_ptr<tcp::acceptor> acceptor_;
+    std::unique_ptr<AcceptorPool> acceptorPool_;
     MessageHandler userMessageHandler_;
     ConnectionHandler connectionHandler_;
     std::unordered_map<std::string, std::shared_ptr<Session>> sessions_;
@@ -143,23 +147,23 @@ struct NetworkManager::Impl {
                         PeerInfo peer;
                         peer.id = peerId;
                         peer.publicKey = publicKey;
-                        peer.address = endpoint.address().to_string();
-                        peer.port = endpoint.port();
+                        peer.endpoint = Endpoint::FromAddress(endpoint.address().to_string(), endpoint.port())
+                            .value_or(Endpoint(endpoint.port()));
                         peer.isConnected = true;
                         peer.lastSeen = std::chrono::system_clock::now();
-                        peerManager_.AddPeer(peer);
+                        session->SetPeer(peerManager_.AddPeer(peer));
                     } catch (...) {}
                     
                     // Notify connection
                     if (connectionHandler_) {
-                        connectionHandler_(peerId, true);
+                        connectionHandler_(session->GetPeer(), true);
                     }
                     
                     // Send handshake response only for incoming connections
                     if (!session->IsOutgoing()) {
                         auto localPeer = peerManager_.GetLocalPeer();
                         auto response = Message::CreateHandshakeMessage(localPeer.id, localPeer.publicKey);
-                        co_spawn(ioContext_,
+                        co_spawn(session->GetSocket().get_executor(),
                             session->SendMessage(response), detached);
                     }
                 }
@@ -168,28 +172,22 @@ struct NetworkManager::Impl {
         
         // Forward to user handler if session has peer ID
         if (session->HasPeerId() && userMessageHandler_) {
-            userMessageHandler_(session->GetPeerId(), msg);
+            userMessageHandler_(session->GetPeer(), msg);
         }
     }
 
-    awaitable<void> AcceptLoop() {
-        while (running_ && acceptor_ && acceptor_->is_open()) {
-            try {
-                tcp::socket socket = co_await acceptor_->async_accept(use_awaitable);
-                
-                auto session = std::make_shared<Session>(
-                    std::move(socket), 
-                    [this](std::shared_ptr<Session> s, const Message& m) {
-                        HandleSessionMessage(s, m);
-                    }, 
-                    connectionHandler_);
-                    
-                co_spawn(acceptor_->get_executor(),
-                    session->Start(), detached);
-            } catch (const std::exception& e) {
-                // Accept error, continue if still running
-            }
-        }
+    // Runs on whichever acceptor thread took the connection; the session and
+    // its handshake stay on that thread's io_context
+    void OnAccept(tcp::socket socket) {
+        auto executor = socket.get_executor();
+        auto session = std::make_shared<Session>(
+            std::move(socket),
+            [this](std::shared_ptr<Session> s, const Message& m) {
+                HandleSessionMessage(s, m);
+            },
+            connectionHandler_);
+
+        co_spawn(executor, session->Start(), detached);
     }
 };
 
@@ -201,16 +199,18 @@ NetworkManager::~NetworkManager() {
 }
 
 void NetworkManager::Start(uint16_t port) {
-    pImpl_->acceptor_ = std::make_unique<tcp::acceptor>(pImpl_->ioContext_, tcp::endpoint(tcp::v4(), port));
+    pImpl_->acceptorPool_ = std::make_unique<AcceptorPool>();
+    pImpl_->acceptorPool_->Start(port, [this](tcp::socket socket) {
+        pImpl_->OnAccept(std::move(socket));
+    });
     pImpl_->running_ = true;
-    co_spawn(pImpl_->ioContext_,
-        pImpl_->AcceptLoop(), detached);
 }
 
 void NetworkManager::Stop() {
     pImpl_->running_ = false;
-    if (pImpl_->acceptor_) {
-        pImpl_->acceptor_->close();
+    // Joins the acceptor threads, so accepted sessions are idle from here on
+    if (pImpl_->acceptorPool_) {
+        pImpl_->acceptorPool_->Stop();
     }
     
     // Close all sessions first
@@ -266,7 +266,7 @@ void NetworkManager::DisconnectPeer(const std::string& peerId) {
     if (it != pImpl_->sessions_.end()) {
         pImpl_->sessions_.erase(it);
         if (pImpl_->connectionHandler_) {
-            pImpl_->connectionHandler_(peerId, false);
+            pImpl_->connectionHandler_(pImpl_->peerManager_.FindPeerHandle(peerId), false);
         }
     }
 }
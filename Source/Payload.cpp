@@ -0,0 +1,172 @@
+#include "Payload.hpp"
+#include <cstring>
+#include <new>
+
+namespace p2p {
+
+Payload::Payload(std::pmr::memory_resource* resource) noexcept
+    : data_(inline_), resource_(resource) {}
+
+Payload::Payload(const uint8_t* data, size_t size, std::pmr::memory_resource* resource)
+    : Payload(resource) {
+    Allocate(size);
+    if (size > 0) {
+        std::memcpy(data_, data, size);
+    }
+}
+
+Payload::Payload(std::string&& text) : Payload() {
+    if (text.size() <= kInlineCapacity) {
+        std::memcpy(inline_, text.data(), text.size());
+        size_ = text.size();
+        return;
+    }
+
+    // Too big to inline: keep the string's own buffer instead of copying it
+    new (&string_) std::string(std::move(text));
+    storage_ = Storage::String;
+    data_ = reinterpret_cast<uint8_t*>(string_.data());
+    size_ = string_.size();
+}
+
+Payload::Payload(std::vector<uint8_t>&& bytes) : Payload() {
+    if (bytes.size() <= kInlineCapacity) {
+        std::memcpy(inline_, bytes.data(), bytes.size());
+        size_ = bytes.size();
+        return;
+    }
+
+    new (&vector_) std::vector<uint8_t>(std::move(bytes));
+    storage_ = Storage::Vector;
+    data_ = vector_.data();
+    size_ = vector_.size();
+}
+
+Payload::Payload(const Payload& other)
+    : Payload(other.data_, other.size_) {}
+
+Payload::Payload(Payload&& other) noexcept
+    : Payload(other.resource_) {
+    TakeFrom(other);
+}
+
+// Like the copy constructor this lands on the default resource, so a copy
+// assigned over an arena-backed payload doesn't die with the arena
+Payload& Payload::operator=(const Payload& other) {
+    if (this != &other) {
+        auto* resource = std::pmr::get_default_resource();
+        if (resource_ != resource) {
+            Release();
+            resource_ = resource;
+        }
+        assign(other.begin(), other.end());
+    }
+    return *this;
+}
+
+Payload& Payload::operator=(Payload&& other) noexcept {
+    if (this != &other) {
+        Release();
+        resource_ = other.resource_;
+        TakeFrom(other);
+    }
+    return *this;
+}
+
+Payload::~Payload() {
+    Release();
+}
+
+void Payload::assign(const uint8_t* first, const uint8_t* last) {
+    size_t size = static_cast<size_t>(last - first);
+    if (size > GetCapacity()) {
+        Release();
+        Allocate(size);
+    }
+    if (size > 0) {
+        std::memmove(data_, first, size);
+    }
+    size_ = size;
+}
+
+void Payload::resize(size_t size) {
+    if (size <= GetCapacity()) {
+        size_ = size;
+        return;
+    }
+
+    Payload grown(resource_);
+    grown.Allocate(size);
+    if (size_ > 0) {
+        std::memcpy(grown.data_, data_, size_);
+    }
+    *this = std::move(grown);
+}
+
+// Storage must be released (inline) on entry
+void Payload::Allocate(size_t size) {
+    size_ = size;
+    if (size <= kInlineCapacity) {
+        return;
+    }
+
+    heap_.bytes = static_cast<uint8_t*>(resource_->allocate(size, alignof(std::max_align_t)));
+    heap_.capacity = size;
+    storage_ = Storage::Heap;
+    data_ = heap_.bytes;
+}
+
+void Payload::Release() noexcept {
+    if (storage_ == Storage::Heap) {
+        resource_->deallocate(heap_.bytes, heap_.capacity, alignof(std::max_align_t));
+    } else if (storage_ == Storage::String) {
+        string_.~basic_string();
+    } else if (storage_ == Storage::Vector) {
+        vector_.~vector();
+    }
+    storage_ = Storage::Inline;
+    data_ = inline_;
+    size_ = 0;
+}
+
+// Leaves other empty and inline; *this must be released (inline) on entry
+void Payload::TakeFrom(Payload& other) noexcept {
+    switch (other.storage_) {
+    case Storage::Inline:
+        std::memcpy(inline_, other.inline_, other.size_);
+        break;
+    case Storage::Heap:
+        heap_ = other.heap_;
+        storage_ = Storage::Heap;
+        data_ = heap_.bytes;
+        other.storage_ = Storage::Inline;
+        break;
+    case Storage::String:
+        new (&string_) std::string(std::move(other.string_));
+        storage_ = Storage::String;
+        data_ = reinterpret_cast<uint8_t*>(string_.data());
+        break;
+    case Storage::Vector:
+        new (&vector_) std::vector<uint8_t>(std::move(other.vector_));
+        storage_ = Storage::Vector;
+        data_ = vector_.data();
+        break;
+    }
+    size_ = other.size_;
+    other.Release();
+}
+
+size_t Payload::GetCapacity() const {
+    switch (storage_) {
+    case Storage::Heap:
+        return heap_.capacity;
+    case Storage::String:
+        return string_.size();
+    case Storage::Vector:
+        return vector_.size();
+    default:
+        return kInlineCapacity;
+    }
+}
+
+} // namespace p2p
@@ -0,0 +1,89 @@
+#include "PeerHandle.hpp"
+#include <mutex>
+
+namespace p2p {
+
+PeerIdTable::PeerIdTable() = default;
+PeerIdTable::~PeerIdTable() = default;
+
+PeerHandle PeerIdTable::Intern(std::string_view peerId) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = index_.find(peerId);
+        if (it != index_.end()) {
+            return PeerHandle(it->second);
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = index_.find(peerId);
+    if (it != index_.end()) {
+        return PeerHandle(it->second);
+    }
+
+    auto index = static_cast<uint32_t>(entries_.size());
+    auto& entry = entries_.emplace_back();
+    entry.id = peerId;
+    ParseRawId(entry.id, entry.raw);
+    index_.emplace(entry.id, index);
+    return PeerHandle(index);
+}
+
+PeerHandle PeerIdTable::Find(std::string_view peerId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = index_.find(peerId);
+    if (it != index_.end()) {
+        return PeerHandle(it->second);
+    }
+    return PeerHandle();
+}
+
+const std::string& PeerIdTable::GetId(PeerHandle peer) const {
+    static const std::string empty;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (peer.GetIndex() >= entries_.size()) {
+        return empty;
+    }
+    return entries_[peer.GetIndex()].id;
+}
+
+const RawPeerId& PeerIdTable::GetRawId(PeerHandle peer) const {
+    static const RawPeerId empty{};
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (peer.GetIndex() >= entries_.size()) {
+        return empty;
+    }
+    return entries_[peer.GetIndex()].raw;
+}
+
+size_t PeerIdTable::Size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return entries_.size();
+}
+
+bool PeerIdTable::ParseRawId(std::string_view peerId, RawPeerId& raw) {
+    if (peerId.size() != raw.size() * 2) {
+        return false;
+    }
+
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    RawPeerId parsed{};
+    for (size_t i = 0; i < parsed.size(); ++i) {
+        int high = nibble(peerId[2 * i]);
+        int low = nibble(peerId[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        parsed[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+    raw = parsed;
+    return true;
+}
+
+} // namespace p2p
@@ -2,46 +2,68 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
-#include <optional>
+#include <iomanip>
+#include <cstdint>
 
 namespace p2p {
 
 PeerManager::PeerManager() = default;
 PeerManager::~PeerManager() = default;
 
-void PeerManager::AddPeer(const PeerInfo& peer) {
+PeerHandle PeerManager::AddPeer(const PeerInfo& peer) {
+    auto handle = peerIds_.Intern(peer.id);
     std::lock_guard<std::mutex> lock(mutex_);
-    peers_[peer.id] = peer;
+    StorePeer(handle, peer);
+    return handle;
 }
 
 void PeerManager::RemovePeer(const std::string& peerId) {
+    RemovePeer(peerIds_.Find(peerId));
+}
+
+void PeerManager::RemovePeer(PeerHandle peer) {
     std::lock_guard<std::mutex> lock(mutex_);
-    peers_.erase(peerId);
+    if (!IsPresent(peer)) return;
+    
+    auto& cold = cold_[peer.GetIndex()];
+    keyArenaGarbage_ += cold.keySize;
+    cold = ColdPeerInfo{};
+    flags_[peer.GetIndex()] = 0;
+    rttMicros_[peer.GetIndex()] = 0;
 }
 
 void PeerManager::UpdatePeerStatus(const std::string& peerId, bool connected) {
+    UpdatePeerStatus(peerIds_.Find(peerId), connected);
+}
+
+void PeerManager::UpdatePeerStatus(PeerHandle peer, bool connected) {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto it = peers_.find(peerId);
-    if (it != peers_.end()) {
-        it->second.isConnected = connected;
-        it->second.lastSeen = std::chrono::system_clock::now();
-    }
+    if (!IsPresent(peer)) return;
+    
+    auto& flags = flags_[peer.GetIndex()];
+    flags = connected ? (flags | kConnected) : (flags & ~kConnected);
+    lastSeen_[peer.GetIndex()] = std::chrono::system_clock::now();
 }
 
 std::optional<PeerInfo> PeerManager::GetPeer(const std::string& peerId) const {
+    return GetPeer(peerIds_.Find(peerId));
+}
+
+std::optional<PeerInfo> PeerManager::GetPeer(PeerHandle peer) const {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto it = peers_.find(peerId);
-    if (it != peers_.end()) {
-        return it->second;
+    if (!IsPresent(peer)) {
+        return std::nullopt;
     }
-    return std::nullopt;
+    return LoadPeer(peer.GetIndex());
 }
 
 std::vector<PeerInfo> PeerManager::GetAllPeers() const {
     std::lock_guard<std::mutex> lock(mutex_);
     std::vector<PeerInfo> result;
-    for (const auto& [id, peer] : peers_) {
-        result.push_back(peer);
+    for (uint32_t i = 0; i < flags_.size(); ++i) {
+        if (flags_[i] & kPresent) {
+            result.push_back(LoadPeer(i));
+        }
     }
     return result;
 }
@@ -49,14 +71,75 @@ std::vector<PeerInfo> PeerManager::GetAllPeers() const {
 std::vector<PeerInfo> PeerManager::GetConnectedPeers() const {
     std::lock_guard<std::mutex> lock(mutex_);
     std::vector<PeerInfo> result;
-    for (const auto& [id, peer] : peers_) {
-        if (peer.isConnected) {
-            result.push_back(peer);
+    for (uint32_t i = 0; i < flags_.size(); ++i) {
+        if (flags_[i] & kConnected) {
+            result.push_back(LoadPeer(i));
         }
     }
     return result;
 }
 
+void PeerManager::TouchPeer(PeerHandle peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (IsPresent(peer)) {
+        lastSeen_[peer.GetIndex()] = std::chrono::system_clock::now();
+    }
+}
+
+void PeerManager::UpdatePeerRtt(PeerHandle peer, std::chrono::microseconds rtt) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (IsPresent(peer)) {
+        auto micros = std::clamp<int64_t>(rtt.count(), 0, UINT32_MAX);
+        rttMicros_[peer.GetIndex()] = static_cast<uint32_t>(micros);
+    }
+}
+
+std::chrono::microseconds PeerManager::GetPeerRtt(PeerHandle peer) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!IsPresent(peer)) {
+        return std::chrono::microseconds(0);
+    }
+    return std::chrono::microseconds(rttMicros_[peer.GetIndex()]);
+}
+
+std::vector<PeerHandle> PeerManager::GetConnectedPeerHandles() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<PeerHandle> result;
+    for (uint32_t i = 0; i < flags_.size(); ++i) {
+        if (flags_[i] & kConnected) {
+            result.emplace_back(i);
+        }
+    }
+    return result;
+}
+
+std::vector<PeerHandle> PeerManager::GetStalePeers(std::chrono::system_clock::time_point cutoff) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<PeerHandle> result;
+    for (uint32_t i = 0; i < flags_.size(); ++i) {
+        if ((flags_[i] & kConnected) && lastSeen_[i] < cutoff) {
+            result.emplace_back(i);
+        }
+    }
+    return result;
+}
+
+PeerHandle PeerManager::InternPeerId(std::string_view peerId) {
+    return peerIds_.Intern(peerId);
+}
+
+PeerHandle PeerManager::FindPeerHandle(std::string_view peerId) const {
+    return peerIds_.Find(peerId);
+}
+
+const std::string& PeerManager::GetPeerId(PeerHandle peer) const {
+    return peerIds_.GetId(peer);
+}
+
+const RawPeerId& PeerManager::GetRawPeerId(PeerHandle peer) const {
+    return peerIds_.GetRawId(peer);
+}
+
 void PeerManager::SetLocalPeer(const PeerInfo& localPeer) {
     std::lock_guard<std::mutex> lock(mutex_);
     localPeer_ = localPeer;
@@ -71,15 +154,19 @@ void PeerManager::SavePeersToFile(const std::string& filename) {
     std::ofstream file(filename);
     if (!file.is_open()) return;
     
-    for (const auto& [id, peer] : peers_) {
-        file << peer.id << "|" 
-             << peer.address << "|" 
-             << std::dec << peer.port << "|";
+    for (uint32_t i = 0; i < flags_.size(); ++i) {
+        if (!(flags_[i] & kPresent)) continue;
+        const auto& cold = cold_[i];
+        // Same columns as when addresses were strings: a host name goes where
+        // the address would, and unknown ones stay empty
+        file << peerIds_.GetId(PeerHandle(i)) << "|" 
+             << (cold.endpoint.IsUnspecified() ? cold.host : cold.endpoint.AddressString()) << "|" 
+             << std::dec << cold.endpoint.GetPort() << "|";
         
         // Save public key as hex
-        for (uint8_t byte : peer.publicKey) {
+        for (uint32_t k = 0; k < cold.keySize; ++k) {
             file << std::hex << std::setw(2) << std::setfill('0') 
-                 << static_cast<int>(byte);
+                 << static_cast<int>(keyArena_[cold.keyOffset + k]);
         }
         file << "\n";
     }
@@ -104,8 +191,13 @@ void PeerManager::LoadPeersFromFile(const std::string& filename) {
         
         PeerInfo peer;
         peer.id = id;
-        peer.address = address;
-        peer.port = static_cast<uint16_t>(std::stoul(portStr));
+        auto port = static_cast<uint16_t>(std::stoul(portStr));
+        if (auto endpoint = Endpoint::FromAddress(address, port)) {
+            peer.endpoint = *endpoint;
+        } else {
+            peer.endpoint = Endpoint(port);
+            peer.host = address;
+        }
         peer.isConnected = false;
         peer.lastSeen = std::chrono::system_clock::now();
         
@@ -115,8 +207,77 @@ void PeerManager::LoadPeersFromFile(const std::string& filename) {
             peer.publicKey.push_back(static_cast<uint8_t>(std::stoul(byteStr, nullptr, 16)));
         }
         
-        peers_[peer.id] = peer;
+        StorePeer(peerIds_.Intern(peer.id), peer);
+    }
+}
+
+// Caller must hold mutex_ for the storage helpers below
+void PeerManager::StorePeer(PeerHandle handle, const PeerInfo& peer) {
+    auto index = handle.GetIndex();
+    if (index >= flags_.size()) {
+        flags_.resize(index + 1, 0);
+        lastSeen_.resize(index + 1);
+        rttMicros_.resize(index + 1, 0);
+        cold_.resize(index + 1);
     }
+    
+    flags_[index] = kPresent | (peer.isConnected ? kConnected : 0);
+    lastSeen_[index] = peer.lastSeen;
+    
+    auto& cold = cold_[index];
+    cold.endpoint = peer.endpoint;
+    cold.host = peer.host;
+    StoreKey(cold, peer.publicKey);
+}
+
+void PeerManager::StoreKey(ColdPeerInfo& cold, const std::vector<uint8_t>& key) {
+    // Re-adding a peer usually carries the same key, which is rewritten in place
+    if (key.size() <= cold.keySize) {
+        std::copy(key.begin(), key.end(), keyArena_.begin() + cold.keyOffset);
+        keyArenaGarbage_ += cold.keySize - key.size();
+        cold.keySize = static_cast<uint32_t>(key.size());
+        return;
+    }
+    
+    keyArenaGarbage_ += cold.keySize;
+    cold.keyOffset = static_cast<uint32_t>(keyArena_.size());
+    cold.keySize = static_cast<uint32_t>(key.size());
+    keyArena_.insert(keyArena_.end(), key.begin(), key.end());
+    
+    if (keyArenaGarbage_ > keyArena_.size() / 2) {
+        CompactKeyArena();
+    }
+}
+
+void PeerManager::CompactKeyArena() {
+    std::vector<uint8_t> arena;
+    arena.reserve(keyArena_.size() - keyArenaGarbage_);
+    for (auto& cold : cold_) {
+        auto offset = static_cast<uint32_t>(arena.size());
+        arena.insert(arena.end(), keyArena_.begin() + cold.keyOffset,
+                     keyArena_.begin() + cold.keyOffset + cold.keySize);
+        cold.keyOffset = offset;
+    }
+    keyArena_ = std::move(arena);
+    keyArenaGarbage_ = 0;
+}
+
+PeerInfo PeerManager::LoadPeer(uint32_t index) const {
+    const auto& cold = cold_[index];
+    PeerInfo peer;
+    peer.id = peerIds_.GetId(PeerHandle(index));
+    peer.endpoint = cold.endpoint;
+    peer.host = cold.host;
+    peer.publicKey.assign(keyArena_.begin() + cold.keyOffset,
+                          keyArena_.begin() + cold.keyOffset + cold.keySize);
+    peer.isConnected = (flags_[index] & kConnected) != 0;
+    peer.lastSeen = lastSeen_[index];
+    peer.handle = PeerHandle(index);
+    return peer;
+}
+
+bool PeerManager::IsPresent(PeerHandle peer) const {
+    return peer.GetIndex() < flags_.size() && (flags_[peer.GetIndex()] & kPresent);
 }
 
-} // namespace p2p
\ No newline at end of file
+} // namespace p2p
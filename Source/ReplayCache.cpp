@@ -0,0 +1,59 @@
+#include "ReplayCache.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace p2p {
+
+size_t ReplayCache::NonceHash::operator()(const Nonce& nonce) const noexcept {
+    uint64_t head;
+    std::memcpy(&head, nonce.data(), sizeof(head));
+    uint64_t tail;
+    std::memcpy(&tail, nonce.data() + sizeof(head), sizeof(tail));
+    return static_cast<size_t>(head ^ (tail * 0x9E3779B97F4A7C15ull));
+}
+
+ReplayCache::ReplayCache(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)) {
+    seen_.reserve(capacity_);
+    order_.reserve(capacity_);
+}
+
+bool ReplayCache::Insert(std::span<const uint8_t> nonce) {
+    if (nonce.size() != kNonceSize) {
+        return false;
+    }
+    Nonce key;
+    std::copy(nonce.begin(), nonce.end(), key.begin());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!seen_.insert(key).second) {
+        return false;
+    }
+
+    if (order_.size() < capacity_) {
+        order_.push_back(key);
+    } else {
+        seen_.erase(order_[next_]);
+        order_[next_] = key;
+        next_ = (next_ + 1) % capacity_;
+    }
+    return true;
+}
+
+bool ReplayCache::Contains(std::span<const uint8_t> nonce) const {
+    if (nonce.size() != kNonceSize) {
+        return false;
+    }
+    Nonce key;
+    std::copy(nonce.begin(), nonce.end(), key.begin());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return seen_.count(key) > 0;
+}
+
+size_t ReplayCache::GetSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return seen_.size();
+}
+
+} // namespace p2p
@@ -0,0 +1,153 @@
+#include "ResolverCache.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+namespace p2p {
+
+// Past this many names, expired ones are swept out as new ones arrive
+static constexpr size_t kPruneThreshold = 4096;
+
+// An IPv4 or IPv6 literal, as given; "[::1]" is taken as "::1"
+static bool ParseLiteral(const std::string& host, std::string& literal) {
+    std::string bare = host.size() > 2 && host.front() == '[' && host.back() == ']'
+        ? host.substr(1, host.size() - 2) : host;
+    unsigned char buffer[sizeof(in6_addr)];
+    if (inet_pton(AF_INET, bare.c_str(), buffer) == 1 || inet_pton(AF_INET6, bare.c_str(), buffer) == 1) {
+        literal = std::move(bare);
+        return true;
+    }
+    return false;
+}
+
+ResolverCache::ResolverCache(size_t threads, Lookup lookup)
+    : lookup_(std::move(lookup)), pool_(threads) {
+    pool_.Start();
+}
+
+ResolverCache::~ResolverCache() {
+    // Lookups still queued fail fast instead of holding up the join
+    stopping_ = true;
+    pool_.Stop();
+}
+
+void ResolverCache::Resolve(const std::string& host, Callback callback, Clock::time_point now) {
+    std::string literal;
+    if (ParseLiteral(host, literal)) {
+        callback({ literal }, nullptr);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (auto it = entries_.find(host); it != entries_.end()) {
+        auto& entry = it->second;
+        if (entry.pending) {
+            entry.waiting.push_back(std::move(callback));
+            return;
+        }
+        if (now < entry.expires) {
+            auto addresses = entry.addresses;
+            auto error = entry.error;
+            lock.unlock();
+            callback(addresses, error);
+            return;
+        }
+    }
+
+    if (entries_.size() >= kPruneThreshold) {
+        Prune(now);
+    }
+    auto& entry = entries_[host];
+    entry = Entry{};
+    entry.waiting.push_back(std::move(callback));
+    lock.unlock();
+
+    lookups_.fetch_add(1, std::memory_order_relaxed);
+    pool_.Submit([this, host]() {
+        Addresses addresses;
+        std::exception_ptr error;
+        try {
+            if (stopping_) {
+                throw std::runtime_error("Resolver stopped before looking up " + host);
+            }
+            addresses = lookup_(host);
+            if (addresses.empty()) {
+                throw std::runtime_error("No addresses for " + host);
+            }
+        } catch (...) {
+            addresses.clear();
+            error = std::current_exception();
+        }
+        Finish(host, std::move(addresses), error);
+    });
+}
+
+void ResolverCache::Finish(const std::string& host, Addresses addresses, std::exception_ptr error) {
+    std::vector<Callback> waiting;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& entry = entries_[host];
+        entry.pending = false;
+        entry.expires = Clock::now() + (error ? failureTtl_ : ttl_);
+        entry.addresses = addresses;
+        entry.error = error;
+        waiting.swap(entry.waiting);
+    }
+    for (auto& callback : waiting) {
+        callback(addresses, error);
+    }
+}
+
+void ResolverCache::Prune(Clock::time_point now) {
+    std::erase_if(entries_, [now](const auto& item) {
+        return !item.second.pending && item.second.expires <= now;
+    });
+}
+
+void ResolverCache::SetTtl(Clock::duration ttl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ttl_ = ttl;
+}
+
+void ResolverCache::SetFailureTtl(Clock::duration ttl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    failureTtl_ = ttl;
+}
+
+void ResolverCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::erase_if(entries_, [](const auto& item) { return !item.second.pending; });
+}
+
+ResolverCache::Addresses ResolverCache::SystemLookup(const std::string& host) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+
+    addrinfo* results = nullptr;
+    int status = getaddrinfo(host.c_str(), nullptr, &hints, &results);
+    if (status != 0) {
+        throw std::runtime_error("Can't resolve " + host + ": " + gai_strerror(status));
+    }
+
+    Addresses addresses;
+    for (auto* info = results; info; info = info->ai_next) {
+        char text[INET6_ADDRSTRLEN] = {};
+        const void* raw = info->ai_family == AF_INET6
+            ? static_cast<const void*>(&reinterpret_cast<const sockaddr_in6*>(info->ai_addr)->sin6_addr)
+            : static_cast<const void*>(&reinterpret_cast<const sockaddr_in*>(info->ai_addr)->sin_addr);
+        if ((info->ai_family == AF_INET || info->ai_family == AF_INET6) &&
+            inet_ntop(info->ai_family, raw, text, sizeof(text))) {
+            if (std::find(addresses.begin(), addresses.end(), text) == addresses.end()) {
+                addresses.emplace_back(text);
+            }
+        }
+    }
+    freeaddrinfo(results);
+    return addresses;
+}
+
+} // namespace p2p
@@ -0,0 +1,272 @@
+#include "SimulatedNetwork.hpp"
+#include <algorithm>
+
+namespace p2p {
+
+SimulatedNetwork::SimulatedNetwork(uint64_t seed) : random_(seed) {}
+
+SimulatedNetwork::~SimulatedNetwork() = default;
+
+std::unique_ptr<SimulatedTransport> SimulatedNetwork::CreateTransport() {
+    std::unique_ptr<SimulatedTransport> transport(new SimulatedTransport(*this));
+    transport->node_ = AddNode(transport.get());
+    return transport;
+}
+
+void SimulatedNetwork::SetDefaultLink(const Link& link) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    defaultLink_ = link;
+}
+
+void SimulatedNetwork::SetLink(const SimulatedTransport& from, const SimulatedTransport& to, const Link& link) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    links_[static_cast<uint64_t>(from.node_) << 32 | to.node_] = link;
+}
+
+void SimulatedNetwork::SetIsolated(const SimulatedTransport& node, bool isolated) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nodes_[node.node_].isolated = isolated;
+}
+
+void SimulatedNetwork::Schedule(Duration delay, std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Push(now_ + delay, EventKind::Task, 0, Transport::kNoConnection, {}, std::move(task));
+}
+
+SimulatedNetwork::Duration SimulatedNetwork::Now() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return now_;
+}
+
+SimulatedNetwork::Stats SimulatedNetwork::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+size_t SimulatedNetwork::RunFor(Duration duration) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Duration limit = now_ + duration;
+    size_t count = 0;
+    while (!events_.empty() && events_.front().time <= limit) {
+        std::pop_heap(events_.begin(), events_.end(), Later{});
+        Event event = std::move(events_.back());
+        events_.pop_back();
+        now_ = event.time;
+        auto* transport = Apply(event);
+        lock.unlock();
+        Deliver(transport, event);
+        lock.lock();
+        ++count;
+    }
+    now_ = limit;
+    return count;
+}
+
+size_t SimulatedNetwork::RunUntilIdle() {
+    size_t count = 0;
+    for (;;) {
+        Duration next;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (events_.empty()) {
+                return count;
+            }
+            next = events_.front().time - now_;
+        }
+        count += RunFor(next);
+    }
+}
+
+uint32_t SimulatedNetwork::AddNode(SimulatedTransport* transport) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nodes_.emplace_back();
+    nodes_.back().transport = transport;
+    return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+void SimulatedNetwork::RemoveNode(uint32_t node) {
+    Stop(node);
+    std::lock_guard<std::mutex> lock(mutex_);
+    nodes_[node].transport = nullptr;
+}
+
+void SimulatedNetwork::Listen(uint32_t node, const std::string& endpoint) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nodes_[node].endpoints.push_back(endpoint);
+    listeners_[endpoint] = node;
+}
+
+Transport::ConnectionId SimulatedNetwork::Connect(uint32_t node, const std::string& endpoint) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = listeners_.find(endpoint);
+    if (it == listeners_.end()) {
+        return Transport::kNoConnection;
+    }
+
+    // Both ends exist from here on; the far one opens when the connect arrives
+    uint32_t target = it->second;
+    auto local = static_cast<ConnectionId>(nodes_[node].connections.size());
+    nodes_[node].connections.push_back({ target, Transport::kNoConnection, true, now_ });
+    auto remote = static_cast<ConnectionId>(nodes_[target].connections.size());
+    nodes_[target].connections.push_back({ node, local, false, now_ });
+    nodes_[node].connections[local].peerConnection = remote;
+
+    Transmit(node, local, EventKind::Open, {});
+    return local;
+}
+
+bool SimulatedNetwork::Send(uint32_t node, ConnectionId connection, std::span<const uint8_t> frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (connection >= nodes_[node].connections.size() || !nodes_[node].connections[connection].open) {
+        return false;
+    }
+    ++stats_.framesSent;
+    stats_.bytesSent += frame.size();
+    Transmit(node, connection, EventKind::Frame, std::vector<uint8_t>(frame.begin(), frame.end()));
+    return true;
+}
+
+void SimulatedNetwork::Close(uint32_t node, ConnectionId connection) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (connection >= nodes_[node].connections.size() || !nodes_[node].connections[connection].open) {
+        return;
+    }
+    nodes_[node].connections[connection].open = false;
+    Transmit(node, connection, EventKind::Close, {});
+}
+
+void SimulatedNetwork::Stop(uint32_t node) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& self = nodes_[node];
+    for (ConnectionId c = 0; c < self.connections.size(); ++c) {
+        if (self.connections[c].open) {
+            self.connections[c].open = false;
+            Transmit(node, c, EventKind::Close, {});
+        }
+    }
+    for (const auto& endpoint : self.endpoints) {
+        auto it = listeners_.find(endpoint);
+        if (it != listeners_.end() && it->second == node) {
+            listeners_.erase(it);
+        }
+    }
+    self.endpoints.clear();
+}
+
+const SimulatedNetwork::Link& SimulatedNetwork::GetLink(uint32_t from, uint32_t to) const {
+    auto it = links_.find(static_cast<uint64_t>(from) << 32 | to);
+    return it != links_.end() ? it->second : defaultLink_;
+}
+
+void SimulatedNetwork::Transmit(uint32_t from, ConnectionId connection, EventKind kind,
+                                std::vector<uint8_t> frame) {
+    auto& conn = nodes_[from].connections[connection];
+    const auto& link = GetLink(from, conn.peerNode);
+
+    // Frames leave one after another at the link's bandwidth, then take its latency
+    Duration start = std::max(now_, conn.busyUntil);
+    Duration sending{0};
+    if (link.bandwidth > 0.0) {
+        sending = Duration(static_cast<int64_t>(frame.size() * 1e6 / link.bandwidth));
+    }
+    conn.busyUntil = start + sending;
+    Push(conn.busyUntil + link.latency, kind, conn.peerNode, conn.peerConnection, std::move(frame));
+}
+
+void SimulatedNetwork::Push(Duration time, EventKind kind, uint32_t node, ConnectionId connection,
+                            std::vector<uint8_t> frame, std::function<void()> task) {
+    events_.push_back({ time, sequence_++, kind, node, connection, std::move(frame), std::move(task) });
+    std::push_heap(events_.begin(), events_.end(), Later{});
+}
+
+SimulatedTransport* SimulatedNetwork::Apply(Event& event) {
+    if (event.kind == EventKind::Task) {
+        return nullptr;
+    }
+
+    // Handlers may add nodes and connections, so look everything up afresh
+    auto* transport = nodes_[event.node].transport;
+    auto& conn = nodes_[event.node].connections[event.connection];
+    switch (event.kind) {
+    case EventKind::Open:
+        if (transport) {
+            conn.open = true;
+            return transport;
+        }
+        break;
+    case EventKind::Frame: {
+        uint32_t from = conn.peerNode;
+        if (!transport || !conn.open || nodes_[event.node].isolated || nodes_[from].isolated ||
+            event.frame.size() > transport->GetMaxFrameSize() || Lost(GetLink(from, event.node).lossRate)) {
+            ++stats_.framesLost;
+            break;
+        }
+        ++stats_.framesDelivered;
+        return transport;
+    }
+    case EventKind::Close:
+        if (transport && conn.open) {
+            conn.open = false;
+            return transport;
+        }
+        break;
+    case EventKind::Task:
+        break;
+    }
+    return nullptr;
+}
+
+void SimulatedNetwork::Deliver(SimulatedTransport* transport, Event& event) {
+    if (event.kind == EventKind::Task) {
+        event.task();
+        return;
+    }
+    if (!transport) {
+        return;
+    }
+    if (event.kind == EventKind::Frame) {
+        if (transport->frameHandler_) {
+            transport->frameHandler_(event.connection, event.frame);
+        }
+    } else if (transport->connectionHandler_) {
+        transport->connectionHandler_(event.connection, event.kind == EventKind::Open);
+    }
+}
+
+// Compares raw generator output rather than using a std distribution, whose
+// algorithm differs between standard libraries, so runs match everywhere
+bool SimulatedNetwork::Lost(double lossRate) {
+    if (lossRate <= 0.0) {
+        return false;
+    }
+    if (lossRate >= 1.0) {
+        return true;
+    }
+    return random_() < static_cast<uint64_t>(lossRate * 18446744073709551616.0);
+}
+
+SimulatedTransport::~SimulatedTransport() {
+    network_.RemoveNode(node_);
+}
+
+void SimulatedTransport::Listen(const std::string& endpoint) {
+    network_.Listen(node_, endpoint);
+}
+
+Transport::ConnectionId SimulatedTransport::Connect(const std::string& endpoint) {
+    return network_.Connect(node_, endpoint);
+}
+
+bool SimulatedTransport::Send(ConnectionId connection, std::span<const uint8_t> frame) {
+    return network_.Send(node_, connection, frame);
+}
+
+void SimulatedTransport::Close(ConnectionId connection) {
+    network_.Close(node_, connection);
+}
+
+void SimulatedTransport::Stop() {
+    network_.Stop(node_);
+}
+
+} // namespace p2p
@@ -0,0 +1,42 @@
+#include "TokenBucket.hpp"
+#include <algorithm>
+
+namespace p2p {
+
+TokenBucket::TokenBucket(double ratePerSecond, double burst)
+    : rate_(std::max(ratePerSecond, 0.0)),
+      burst_(std::max(burst, 1.0)) {}
+
+bool TokenBucket::TryTake(Clock::time_point now, double tokens) {
+    if (IsUnlimited()) {
+        return true;
+    }
+
+    Refill(now);
+    if (tokens_ < tokens) {
+        return false;
+    }
+    tokens_ -= tokens;
+    return true;
+}
+
+double TokenBucket::TakeUpTo(Clock::time_point now, double tokens) {
+    if (IsUnlimited()) {
+        return tokens;
+    }
+
+    Refill(now);
+    double taken = std::min(tokens, tokens_);
+    tokens_ -= taken;
+    return taken;
+}
+
+void TokenBucket::Refill(Clock::time_point now) {
+    if (now > last_) {
+        double elapsed = std::chrono::duration<double>(now - last_).count();
+        tokens_ = std::min(burst_, tokens_ + elapsed * rate_);
+        last_ = now;
+    }
+}
+
+} // namespace p2p
@@ -0,0 +1,57 @@
+#pragma once
+
+// Counts global heap allocations so message paths can be held to a fixed
+// number. Replaces the global allocation functions, so include it from
+// exactly one translation unit per test executable.
+
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// std::pmr::new_delete_resource goes through the aligned overloads, so
+// those are counted too
+static std::atomic<size_t> g_allocations{0};
+
+inline size_t GetAllocationCount() {
+    return g_allocations.load();
+}
+
+static void* CountedAlloc(size_t size, size_t alignment) {
+    ++g_allocations;
+    size = (size + alignment - 1) / alignment * alignment;
+    if (void* p = std::aligned_alloc(alignment, size ? size : alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// Out of line so the compiler doesn't pair an inlined free with a new expression
+[[gnu::noinline]] static void CountedFree(void* p) noexcept {
+    std::free(p);
+}
+
+void* operator new(size_t size) {
+    return CountedAlloc(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return CountedAlloc(size, std::max(static_cast<size_t>(alignment), alignof(std::max_align_t)));
+}
+
+void operator delete(void* p) noexcept {
+    CountedFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    CountedFree(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    CountedFree(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    CountedFree(p);
+}
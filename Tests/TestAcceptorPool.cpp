@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include "AcceptorPool.hpp"
+#include <boost/asio/connect.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace p2p;
+using boost::asio::ip::tcp;
+
+namespace {
+
+// Blocking connect from a client thread's own io_context
+bool ConnectOnce(boost::asio::io_context& context, uint16_t port) {
+    tcp::socket socket(context);
+    boost::system::error_code ec;
+    socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), port), ec);
+    return !ec;
+}
+
+} // namespace
+
+TEST(AcceptorPoolTest, AcceptsOnSharedPort) {
+    AcceptorPool pool(2);
+    std::atomic<int> accepted{0};
+    pool.Start(0, [&](tcp::socket socket) {
+        // Echo one byte so the client knows it was served
+        uint8_t byte = 0;
+        boost::asio::read(socket, boost::asio::buffer(&byte, 1));
+        ++accepted;
+        boost::asio::write(socket, boost::asio::buffer(&byte, 1));
+    });
+    ASSERT_NE(pool.GetPort(), 0);
+
+    boost::asio::io_context client;
+    tcp::socket socket(client);
+    socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), pool.GetPort()));
+    uint8_t sent = 42;
+    uint8_t received = 0;
+    boost::asio::write(socket, boost::asio::buffer(&sent, 1));
+    boost::asio::read(socket, boost::asio::buffer(&received, 1));
+    EXPECT_EQ(received, 42);
+    EXPECT_EQ(accepted, 1);
+
+    pool.Stop();
+}
+
+TEST(AcceptorPoolTest, AcceptsIpv4AndIpv6) {
+    boost::asio::io_context client;
+    {
+        tcp::socket probe(client);
+        boost::system::error_code ec;
+        probe.open(tcp::v6(), ec);
+        if (ec) {
+            GTEST_SKIP() << "No IPv6 on this host";
+        }
+    }
+
+    AcceptorPool pool(2);
+    std::atomic<int> accepted{0};
+    pool.Start(0, [&](tcp::socket) { ++accepted; });
+
+    for (auto address : { boost::asio::ip::address(boost::asio::ip::address_v4::loopback()),
+                          boost::asio::ip::address(boost::asio::ip::address_v6::loopback()) }) {
+        tcp::socket socket(client);
+        boost::system::error_code ec;
+        socket.connect(tcp::endpoint(address, pool.GetPort()), ec);
+        EXPECT_FALSE(ec) << address.to_string() << ": " << ec.message();
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (accepted < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(accepted, 2);
+    pool.Stop();
+}
+
+TEST(AcceptorPoolTest, PortInUse) {
+    AcceptorPool first(1);
+    first.Start(0, [](tcp::socket) {});
+
+    // A listener without SO_REUSEPORT holds the port exclusively
+    AcceptorPool second(2);
+    EXPECT_THROW(second.Start(first.GetPort(), [](tcp::socket) {}), boost::system::system_error);
+}
+
+TEST(AcceptorPoolTest, BacksOffWhenOutOfDescriptors) {
+    AcceptorPool pool(1);
+    std::atomic<int> accepted{0};
+    pool.Start(0, [&](tcp::socket) { ++accepted; });
+    boost::asio::io_context client; // Its own descriptors come first
+    tcp::socket socket(client);
+
+    // Use up every descriptor but one, under a lowered limit, and spend that
+    // one on a client so the pool has nothing to accept into
+    rlimit original{};
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &original), 0);
+    rlimit lowered = original;
+    lowered.rlim_cur = std::min<rlim_t>(original.rlim_cur, 1024);
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &lowered), 0);
+    std::vector<int> filler;
+    for (int fd; (fd = dup(STDERR_FILENO)) >= 0;) {
+        filler.push_back(fd);
+    }
+    ASSERT_FALSE(filler.empty());
+    close(filler.back());
+    filler.pop_back();
+
+    boost::system::error_code ec;
+    socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), pool.GetPort()), ec);
+    EXPECT_FALSE(ec) << ec.message();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    auto errors = pool.GetAcceptErrorCount();
+
+    for (int fd : filler) {
+        close(fd);
+    }
+    setrlimit(RLIMIT_NOFILE, &original);
+
+    // A few retries, not a spin
+    EXPECT_GT(errors, 0u);
+    EXPECT_LT(errors, 20u);
+
+    // And the queued connection gets in once descriptors are back
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (accepted < 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(accepted, 1);
+    pool.Stop();
+}
+
+TEST(AcceptorPoolTest, ConnectionStormThroughput) {
+    constexpr int kClients = 8;
+    constexpr int kConnectionsPerClient = 500;
+    constexpr int kTotal = kClients * kConnectionsPerClient;
+
+    AcceptorPool pool(4);
+    std::atomic<int> accepted{0};
+    pool.Start(0, [&](tcp::socket) { ++accepted; });
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    std::atomic<int> connected{0};
+    for (int c = 0; c < kClients; ++c) {
+        clients.emplace_back([&]() {
+            boost::asio::io_context context;
+            for (int i = 0; i < kConnectionsPerClient; ++i) {
+                connected += ConnectOnce(context, pool.GetPort());
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (accepted < connected && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t busyAcceptors = 0;
+    std::printf("Connection storm: %.0f connections/s over %zu acceptors (",
+                accepted / elapsed, pool.GetAcceptorCount());
+    for (size_t i = 0; i < pool.GetAcceptorCount(); ++i) {
+        std::printf("%s%llu", i ? " " : "", static_cast<unsigned long long>(pool.GetAcceptedCount(i)));
+        busyAcceptors += pool.GetAcceptedCount(i) > 0;
+    }
+    std::printf(")\n");
+
+    EXPECT_EQ(connected, kTotal);
+    EXPECT_EQ(accepted, kTotal);
+    if (AcceptorPool::IsReusePortSupported()) {
+        EXPECT_GT(busyAcceptors, 1);
+    }
+    pool.Stop();
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include "ChannelManager.hpp"
+#include <thread>
+
+using namespace p2p;
+
+class ChannelManagerTest : public ::testing::Test {
+protected:
+    ChannelManager channels;
+};
+
+TEST_F(ChannelManagerTest, ChannelIdIsStable) {
+    EXPECT_EQ(ChannelManager::GetChannelId("#ops"), ChannelManager::GetChannelId("#ops"));
+    EXPECT_NE(ChannelManager::GetChannelId("#ops"), ChannelManager::GetChannelId("#dev"));
+}
+
+TEST_F(ChannelManagerTest, ValidChannelNames) {
+    EXPECT_TRUE(ChannelManager::IsValidChannelName("#ops"));
+    EXPECT_FALSE(ChannelManager::IsValidChannelName("ops"));
+    EXPECT_FALSE(ChannelManager::IsValidChannelName("#"));
+    EXPECT_FALSE(ChannelManager::IsValidChannelName("#has space"));
+    EXPECT_FALSE(ChannelManager::IsValidChannelName("#" + std::string(64, 'x')));
+}
+
+TEST_F(ChannelManagerTest, JoinAndPart) {
+    EXPECT_TRUE(channels.Join("#ops"));
+    EXPECT_FALSE(channels.Join("#ops"));
+    EXPECT_TRUE(channels.IsJoined(ChannelManager::GetChannelId("#ops")));
+    
+    auto joined = channels.GetJoinedChannels();
+    ASSERT_EQ(joined.size(), 1);
+    EXPECT_EQ(joined[0], "#ops");
+    
+    EXPECT_TRUE(channels.Part("#ops"));
+    EXPECT_FALSE(channels.Part("#ops"));
+    EXPECT_FALSE(channels.IsJoined(ChannelManager::GetChannelId("#ops")));
+    EXPECT_TRUE(channels.GetJoinedChannels().empty());
+}
+
+TEST_F(ChannelManagerTest, MembersAreSortedAndUnique) {
+    channels.AddMember("#ops", PeerHandle(3));
+    channels.AddMember("#ops", PeerHandle(1));
+    channels.AddMember("#ops", PeerHandle(2));
+    channels.AddMember("#ops", PeerHandle(1));
+    
+    auto members = channels.GetMembers(ChannelManager::GetChannelId("#ops"));
+    EXPECT_EQ(members, (std::vector<PeerHandle>{PeerHandle(1), PeerHandle(2), PeerHandle(3)}));
+    
+    auto name = channels.GetChannelName(ChannelManager::GetChannelId("#ops"));
+    ASSERT_TRUE(name.has_value());
+    EXPECT_EQ(*name, "#ops");
+}
+
+TEST_F(ChannelManagerTest, FanOutOnlyToMembers) {
+    channels.Join("#ops");
+    channels.AddMember("#ops", PeerHandle(1));
+    channels.AddMember("#dev", PeerHandle(2));
+    
+    auto opsMembers = channels.GetMembers(ChannelManager::GetChannelId("#ops"));
+    EXPECT_EQ(opsMembers, (std::vector<PeerHandle>{PeerHandle(1)}));
+    EXPECT_TRUE(channels.GetMembers(ChannelManager::GetChannelId("#unknown")).empty());
+}
+
+TEST_F(ChannelManagerTest, RemoveMember) {
+    channels.AddMember("#ops", PeerHandle(1));
+    channels.AddMember("#ops", PeerHandle(2));
+    channels.RemoveMember("#ops", PeerHandle(1));
+    
+    auto members = channels.GetMembers(ChannelManager::GetChannelId("#ops"));
+    EXPECT_EQ(members, (std::vector<PeerHandle>{PeerHandle(2)}));
+    
+    // Channel with no local or remote members is dropped
+    channels.RemoveMember("#ops", PeerHandle(2));
+    EXPECT_FALSE(channels.GetChannelName(ChannelManager::GetChannelId("#ops")).has_value());
+}
+
+TEST_F(ChannelManagerTest, RemovePeerFromAllChannels) {
+    channels.Join("#ops");
+    channels.AddMember("#ops", PeerHandle(1));
+    channels.AddMember("#dev", PeerHandle(1));
+    channels.AddMember("#dev", PeerHandle(2));
+    
+    channels.RemovePeer(PeerHandle(1));
+    
+    EXPECT_TRUE(channels.GetMembers(ChannelManager::GetChannelId("#ops")).empty());
+    EXPECT_EQ(channels.GetMembers(ChannelManager::GetChannelId("#dev")),
+              (std::vector<PeerHandle>{PeerHandle(2)}));
+    
+    // Joined channel survives even with no remote members
+    EXPECT_TRUE(channels.IsJoined(ChannelManager::GetChannelId("#ops")));
+}
+
+TEST_F(ChannelManagerTest, ConcurrentMembershipUpdates) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([this, t]() {
+            for (int i = 0; i < 50; ++i) {
+                channels.AddMember("#ops", PeerHandle(static_cast<uint32_t>(t * 50 + i)));
+            }
+        });
+    }
+    
+    for (auto& t : threads) {
+        t.join();
+    }
+    
+    EXPECT_EQ(channels.GetMembers(ChannelManager::GetChannelId("#ops")).size(), 400);
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "Crypto.hpp"
+#include "Executor.hpp"
 #include <set>
 
 using namespace p2p;
@@ -186,4 +187,54 @@ TEST_F(CryptoTest, CrossKeyVerification) {
     EXPECT_TRUE(crypto.Verify(data, sig1, keyPair1.publicKey));
     EXPECT_FALSE(crypto.Verify(data, sig1, keyPair2.publicKey));
     EXPECT_FALSE(crypto.Verify(data, sig1, keyPair3.publicKey));
-}
\ No newline at end of file
+}
+
+TEST_F(CryptoTest, VerifyBatchOnExecutor) {
+    Executor executor(4);
+    executor.Start();
+    
+    auto keyPair1 = crypto.GenerateKeyPair();
+    auto keyPair2 = crypto.GenerateKeyPair();
+    
+    std::vector<std::vector<uint8_t>> data;
+    std::vector<std::vector<uint8_t>> signatures;
+    for (int i = 0; i < 32; ++i) {
+        data.push_back({'m', 's', 'g', static_cast<uint8_t>(i)});
+        signatures.push_back(crypto.Sign(data.back(), keyPair1.privateKey));
+    }
+    
+    // Every third request is checked against the wrong key
+    std::vector<CryptoManager::VerifyRequest> requests;
+    for (size_t i = 0; i < data.size(); ++i) {
+        requests.push_back({data[i], signatures[i], i % 3 == 0 ? keyPair2.publicKey : keyPair1.publicKey});
+    }
+    
+    auto results = crypto.VerifyBatch(requests, executor);
+    ASSERT_EQ(results.size(), requests.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT_EQ(results[i], i % 3 == 0 ? 0 : 1) << "request " << i;
+    }
+}
+
+TEST_F(CryptoTest, RandomBytes) {
+    auto first = crypto.RandomBytes(16);
+    auto second = crypto.RandomBytes(16);
+    EXPECT_EQ(first.size(), 16u);
+    EXPECT_EQ(second.size(), 16u);
+    EXPECT_NE(first, second);
+    EXPECT_TRUE(crypto.RandomBytes(0).empty());
+}
+
+TEST_F(CryptoTest, DeriveKeyIsDeterministicPerContext) {
+    auto keys = crypto.GenerateKeyPair();
+    auto key = crypto.DeriveKey(keys.privateKey, "context-a");
+    EXPECT_EQ(key.size(), 32u);
+    EXPECT_EQ(crypto.DeriveKey(keys.privateKey, "context-a"), key);
+    
+    // Different contexts and different secrets give unrelated keys
+    EXPECT_NE(crypto.DeriveKey(keys.privateKey, "context-b"), key);
+    EXPECT_NE(crypto.DeriveKey(crypto.GenerateKeyPair().privateKey, "context-a"), key);
+    
+    EXPECT_EQ(crypto.DeriveKey(keys.privateKey, "context-a", 64).size(), 64u);
+    EXPECT_TRUE(crypto.DeriveKey({}, "context-a").empty());
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include "Dialer.hpp"
+#include <boost/asio/ip/tcp.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+using namespace p2p;
+using namespace std::chrono_literals;
+using boost::asio::ip::tcp;
+
+namespace {
+
+// A port on 127.0.0.1 that takes connections; the kernel completes them
+// from the backlog, so nothing needs to accept
+class Listener {
+public:
+    Listener() : acceptor_(context_, tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0)) {}
+    uint16_t GetPort() const { return acceptor_.local_endpoint().port(); }
+
+private:
+    boost::asio::io_context context_;
+    tcp::acceptor acceptor_;
+};
+
+struct Result {
+    std::string address;
+    std::exception_ptr error;
+};
+
+Result DialNow(Dialer& dialer, const std::string& host, uint16_t port) {
+    std::promise<Result> result;
+    dialer.Dial(host, port, [&](const std::string& address, std::exception_ptr error) {
+        result.set_value({ address, error });
+    });
+    auto future = result.get_future();
+    if (future.wait_for(10s) != std::future_status::ready) {
+        throw std::runtime_error("Dial never called back");
+    }
+    return future.get();
+}
+
+} // namespace
+
+TEST(DialerTest, InterleavesAddressFamilies) {
+    EXPECT_EQ(Dialer::Interleave({ "::1", "::2", "10.0.0.1", "10.0.0.2", "::3" }),
+              (std::vector<std::string>{ "::1", "10.0.0.1", "::2", "10.0.0.2", "::3" }));
+    EXPECT_EQ(Dialer::Interleave({ "10.0.0.1", "::1", "10.0.0.2" }),
+              (std::vector<std::string>{ "10.0.0.1", "::1", "10.0.0.2" }));
+    EXPECT_TRUE(Dialer::Interleave({}).empty());
+}
+
+TEST(DialerTest, PicksTheAddressThatAnswers) {
+    Listener listener;
+    // Only 127.0.0.1 listens; the rest of 127/8 refuses at once
+    Dialer dialer([](const std::string&) { return ResolverCache::Addresses{ "127.0.0.2", "127.0.0.3", "127.0.0.1" }; });
+
+    auto result = DialNow(dialer, "peer", listener.GetPort());
+    EXPECT_FALSE(result.error);
+    EXPECT_EQ(result.address, "127.0.0.1");
+}
+
+TEST(DialerTest, SlowAddressDoesNotHoldUpTheRest) {
+    Listener listener;
+    // TEST-NET-1 goes nowhere, so its connect hangs or fails; either way the next starts
+    Dialer dialer([](const std::string&) { return ResolverCache::Addresses{ "192.0.2.1", "127.0.0.1" }; });
+    dialer.SetAttemptDelay(50ms);
+    dialer.SetTimeout(5s);
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = DialNow(dialer, "peer", listener.GetPort());
+    EXPECT_FALSE(result.error);
+    EXPECT_EQ(result.address, "127.0.0.1");
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 2s);
+}
+
+TEST(DialerTest, ReportsWhyNothingAnswered) {
+    Listener listener;
+    Dialer dialer([](const std::string& host) -> ResolverCache::Addresses {
+        if (host == "missing") {
+            throw std::runtime_error("NXDOMAIN");
+        }
+        return { "127.0.0.2" };
+    });
+
+    auto refused = DialNow(dialer, "peer", listener.GetPort());
+    EXPECT_TRUE(refused.address.empty());
+    EXPECT_THROW(std::rethrow_exception(refused.error), std::system_error);
+
+    auto missing = DialNow(dialer, "missing", listener.GetPort());
+    EXPECT_THROW(std::rethrow_exception(missing.error), std::runtime_error);
+}
+
+TEST(DialerTest, ThousandDialsRunInParallel) {
+    constexpr int kPeers = 1000;
+    constexpr auto kLatency = 10ms;
+    Listener listener;
+    Dialer dialer([kLatency](const std::string&) {
+        std::this_thread::sleep_for(kLatency);
+        return ResolverCache::Addresses{ "127.0.0.1" };
+    });
+
+    std::atomic<int> connected{0};
+    std::atomic<int> failed{0};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kPeers; ++i) {
+        dialer.Dial("peer-" + std::to_string(i), listener.GetPort(), [&](const std::string&, std::exception_ptr error) {
+            ++(error ? failed : connected);
+        });
+    }
+    while (connected + failed < kPeers && std::chrono::steady_clock::now() - start < 30s) {
+        std::this_thread::sleep_for(1ms);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(connected, kPeers);
+    EXPECT_EQ(failed, 0);
+    EXPECT_LT(elapsed, kLatency * kPeers / 2); // Each lookup in turn would take all of it
+    std::printf("%d dials with %lld ms lookups: %lld ms\n", kPeers, static_cast<long long>(kLatency.count()),
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()));
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "Endpoint.hpp"
+#include <unordered_set>
+
+using namespace p2p;
+
+TEST(EndpointTest, ParsesAndFormatsBothFamilies) {
+    auto v4 = Endpoint::Parse("10.0.0.7:8080");
+    ASSERT_TRUE(v4.has_value());
+    EXPECT_TRUE(v4->IsIpv4());
+    EXPECT_EQ(v4->GetPort(), 8080);
+    EXPECT_EQ(v4->AddressString(), "10.0.0.7");
+    EXPECT_EQ(v4->ToString(), "10.0.0.7:8080");
+
+    auto v6 = Endpoint::Parse("tcp://[2001:db8::1]:9000");
+    ASSERT_TRUE(v6.has_value());
+    EXPECT_FALSE(v6->IsIpv4());
+    EXPECT_EQ(v6->GetPort(), 9000);
+    EXPECT_EQ(v6->ToString(), "[2001:db8::1]:9000");
+
+    // Formatting is canonical, so equal addresses print alike
+    EXPECT_EQ(Endpoint::FromAddress("2001:0db8:0:0::0001", 1)->ToString(), "[2001:db8::1]:1");
+    EXPECT_EQ(Endpoint::FromAddress("[::1]", 2)->ToString(), "[::1]:2");
+}
+
+TEST(EndpointTest, RejectsWhatIsNotAnAddress) {
+    EXPECT_FALSE(Endpoint::FromAddress("localhost", 80));
+    EXPECT_FALSE(Endpoint::FromAddress("", 80));
+    EXPECT_FALSE(Endpoint::FromAddress("10.0.0.256", 80));
+    EXPECT_FALSE(Endpoint::Parse("10.0.0.1"));
+    EXPECT_FALSE(Endpoint::Parse("10.0.0.1:"));
+    EXPECT_FALSE(Endpoint::Parse("10.0.0.1:65536"));
+    EXPECT_FALSE(Endpoint::Parse("10.0.0.1:80x"));
+    EXPECT_FALSE(Endpoint::Parse("::1:80")); // Needs brackets
+    EXPECT_FALSE(Endpoint::Parse("ipc:///tmp/p2pchat.ipc"));
+    EXPECT_FALSE(Endpoint::Parse("inproc://p2pchat-9000"));
+}
+
+TEST(EndpointTest, HoldsIpv4Mapped) {
+    auto mapped = Endpoint::FromAddress("::ffff:192.0.2.1", 7);
+    auto plain = Endpoint::FromAddress("192.0.2.1", 7);
+    ASSERT_TRUE(mapped && plain);
+    EXPECT_EQ(*mapped, *plain);
+    EXPECT_EQ(*plain, Endpoint::FromIpv4(0xC0000201, 7));
+    EXPECT_EQ(plain->GetAddress()[10], 0xFF);
+    EXPECT_EQ(plain->GetAddress()[15], 1);
+}
+
+TEST(EndpointTest, ClassifiesAddresses) {
+    EXPECT_TRUE(Endpoint::Loopback(1).IsLoopback());
+    EXPECT_TRUE(Endpoint::FromAddress("127.3.2.1", 1)->IsLoopback());
+    EXPECT_TRUE(Endpoint::FromAddress("::1", 1)->IsLoopback());
+    EXPECT_FALSE(Endpoint::FromAddress("10.0.0.1", 1)->IsLoopback());
+
+    EXPECT_TRUE(Endpoint().IsUnspecified());
+    EXPECT_TRUE(Endpoint(8080).IsUnspecified());
+    EXPECT_TRUE(Endpoint::FromAddress("0.0.0.0", 1)->IsUnspecified());
+    EXPECT_FALSE(Endpoint::Loopback(1).IsUnspecified());
+    EXPECT_EQ(Endpoint(8080).ToString(), "[::]:8080");
+}
+
+TEST(EndpointTest, ComparesAndHashesByValue) {
+    auto a = *Endpoint::Parse("10.0.0.1:80");
+    auto b = *Endpoint::Parse("10.0.0.1:81");
+    auto c = *Endpoint::Parse("[::2]:80");
+    EXPECT_LT(a, b);
+    EXPECT_NE(a, c);
+
+    std::unordered_set<Endpoint, EndpointHash> set{ a, b, c, *Endpoint::Parse("10.0.0.1:80") };
+    EXPECT_EQ(set.size(), 3u);
+    EXPECT_TRUE(set.count(*Endpoint::FromAddress("::ffff:10.0.0.1", 81)));
+}
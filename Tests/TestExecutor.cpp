@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "Executor.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace p2p;
+
+TEST(ExecutorTest, StopRunsNestedSubmissions) {
+    Executor executor(4);
+    executor.Start();
+
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 100; ++i) {
+        executor.Submit([&]() {
+            ++ran;
+            // Submitted from a worker: lands on its own deque
+            executor.Submit([&]() { ++ran; });
+        });
+    }
+    executor.Stop();
+    EXPECT_EQ(ran, 200);
+}
+
+TEST(ExecutorTest, TasksSubmittedBeforeStartWait) {
+    Executor executor(2);
+    std::atomic<int> ran{0};
+    executor.Submit([&]() { ++ran; });
+    executor.Defer([&]() { ++ran; });
+    EXPECT_EQ(ran, 0);
+
+    executor.Start();
+    executor.Stop();
+    EXPECT_EQ(ran, 2);
+}
+
+TEST(ExecutorTest, ParallelForCoversEachIndexOnce) {
+    Executor executor(4);
+    executor.Start();
+
+    std::vector<std::atomic<int>> hits(10000);
+    executor.ParallelFor(hits.size(), [&](size_t i) { ++hits[i]; });
+    EXPECT_TRUE(std::all_of(hits.begin(), hits.end(), [](const auto& h) { return h == 1; }));
+
+    EXPECT_THROW(executor.ParallelFor(100, [](size_t i) {
+        if (i == 42) throw std::runtime_error("bad index");
+    }), std::runtime_error);
+
+    // Without started workers the caller does everything itself
+    Executor idle(2);
+    std::atomic<int> sum{0};
+    idle.ParallelFor(10, [&](size_t i) { sum += static_cast<int>(i); });
+    EXPECT_EQ(sum, 45);
+}
+
+TEST(ExecutorTest, NestedParallelForDoesNotDeadlock) {
+    Executor executor(2);
+    executor.Start();
+
+    std::atomic<int> total{0};
+    executor.ParallelFor(8, [&](size_t) {
+        executor.ParallelFor(8, [&](size_t) { ++total; });
+    });
+    EXPECT_EQ(total, 64);
+}
+
+TEST(ExecutorTest, IdleWorkersStealLocalWork) {
+    Executor executor(4);
+    executor.Start();
+
+    // One worker fans out; the others can only get the children by stealing
+    std::atomic<int> ran{0};
+    executor.Submit([&]() {
+        for (int i = 0; i < 1000; ++i) {
+            executor.Submit([&]() {
+                std::this_thread::sleep_for(std::chrono::microseconds(20));
+                ++ran;
+            });
+        }
+    });
+    executor.Stop();
+
+    EXPECT_EQ(ran, 1000);
+    EXPECT_GT(executor.GetStealCount(), 0);
+}
+
+TEST(ExecutorTest, PinnedWorkersRunTasks) {
+    Executor executor(2, true);
+    executor.Start();
+    std::atomic<int> ran{0};
+    executor.ParallelFor(64, [&](size_t) { ++ran; });
+    EXPECT_EQ(ran, 64);
+}
+
+TEST(ExecutorTest, ThroughputAndTailLatencyUnderMixedLoad) {
+    using Clock = std::chrono::steady_clock;
+    constexpr int kBatches = 200;
+    constexpr int kBatchSize = 1000;
+    constexpr int kShortTasks = kBatches * kBatchSize;
+
+    Executor executor(4);
+    executor.Start();
+
+    std::mutex mutex;
+    std::vector<int64_t> latencies;
+    latencies.reserve(kShortTasks);
+    std::atomic<int> done{0};
+
+    // Bursts of short tasks, each alongside a long one that hogs a worker the
+    // way a blocking handler or a big verify would
+    auto start = Clock::now();
+    for (int batch = 0; batch < kBatches; ++batch) {
+        executor.Submit([]() { std::this_thread::sleep_for(std::chrono::microseconds(500)); });
+        for (int i = 0; i < kBatchSize; ++i) {
+            auto submitted = Clock::now();
+            executor.Submit([&, submitted]() {
+                auto waited = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - submitted);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    latencies.push_back(waited.count());
+                }
+                ++done;
+            });
+        }
+        while (done < (batch + 1) * kBatchSize) {
+            std::this_thread::yield();
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    executor.Stop();
+
+    ASSERT_EQ(done, kShortTasks);
+    std::sort(latencies.begin(), latencies.end());
+    auto p50 = latencies[latencies.size() / 2];
+    auto p99 = latencies[latencies.size() * 99 / 100];
+    std::printf("Executor: %.0f tasks/s, queue latency p50 %lld us, p99 %lld us, %llu steals\n",
+                kShortTasks / elapsed, static_cast<long long>(p50), static_cast<long long>(p99),
+                static_cast<unsigned long long>(executor.GetStealCount()));
+
+    EXPECT_LT(elapsed, 10.0);
+}
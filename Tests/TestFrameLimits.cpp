@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include "FrameLimits.hpp"
+#include <string>
+#include <vector>
+
+using namespace p2p;
+
+TEST(FrameLimitsTest, AcceptsWellFormedFrames) {
+    FrameLimits limits;
+
+    auto text = Message::CreateTextMessage(std::string(100000, 't')).Serialize();
+    auto header = limits.Validate(text.data(), text.size());
+    ASSERT_TRUE(header);
+    EXPECT_EQ(header->type, MessageType::TEXT);
+    EXPECT_EQ(header->payloadSize, 100000u);
+
+    std::vector<uint8_t> key(512, 0x42);
+    auto handshake = Message::CreateHandshakeMessage(std::string(64, 'p'), key).Serialize();
+    EXPECT_TRUE(limits.Validate(handshake.data(), handshake.size()));
+
+    auto ping = Message::CreatePingMessage().Serialize();
+    EXPECT_TRUE(limits.Validate(ping.data(), ping.size()));
+}
+
+TEST(FrameLimitsTest, RejectsOversizedControlPayloads) {
+    FrameLimits limits;
+
+    // A PING has no payload, so any is too much
+    auto ping = Message(MessageType::PING, std::vector<uint8_t>(1, 0)).Serialize();
+    EXPECT_FALSE(limits.Validate(ping.data(), ping.size()));
+
+    std::vector<uint8_t> key(4096, 0x42);
+    auto handshake = Message::CreateHandshakeMessage("peer", key).Serialize();
+    EXPECT_FALSE(limits.Validate(handshake.data(), handshake.size()));
+
+    limits.SetMaxPayloadSize(MessageType::HANDSHAKE, 8192);
+    EXPECT_TRUE(limits.Validate(handshake.data(), handshake.size()));
+}
+
+TEST(FrameLimitsTest, DeclaredSizeMustMatchTheFrame) {
+    FrameLimits limits;
+    auto frame = Message::CreateTextMessage("hello").Serialize();
+
+    // A header claiming more than arrived, as a hostile peer would send to
+    // make us allocate for it
+    auto claimsMore = frame;
+    claimsMore[1] = 0xFF;
+    claimsMore[2] = 0xFF;
+    claimsMore[3] = 0xFF;
+    claimsMore[4] = 0x7F;
+    EXPECT_FALSE(limits.Validate(claimsMore.data(), claimsMore.size()));
+
+    auto trailing = frame;
+    trailing.push_back(0);
+    EXPECT_FALSE(limits.Validate(trailing.data(), trailing.size()));
+
+    EXPECT_FALSE(limits.Validate(frame.data(), Message::kHeaderSize - 1));
+}
+
+TEST(FrameLimitsTest, FrameLimitCapsEveryType) {
+    FrameLimits limits(Message::kHeaderSize + 1000);
+    EXPECT_EQ(limits.GetMaxPayloadSize(MessageType::TEXT), 1000u);
+    EXPECT_EQ(limits.GetMaxPayloadSize(MessageType::PEER_LIST), 1000u);
+    EXPECT_EQ(limits.GetMaxPayloadSize(MessageType::AUTH_RESPONSE), 256u);
+
+    auto fits = Message::CreateTextMessage(std::string(1000, 'f')).Serialize();
+    auto tooBig = Message::CreateTextMessage(std::string(1001, 'f')).Serialize();
+    EXPECT_TRUE(limits.Validate(fits.data(), fits.size()));
+    EXPECT_FALSE(limits.Validate(tooBig.data(), tooBig.size()));
+
+    // Raising a type's limit can't lift it past the frame limit
+    limits.SetMaxPayloadSize(MessageType::TEXT, 1 << 20);
+    EXPECT_FALSE(limits.Validate(tooBig.data(), tooBig.size()));
+
+    limits.SetMaxFrameSize(0);
+    EXPECT_EQ(limits.GetMaxFrameSize(), Message::kHeaderSize);
+    EXPECT_EQ(limits.GetMaxPayloadSize(MessageType::TEXT), 0u);
+}
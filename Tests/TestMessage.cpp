@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 #include "Message.hpp"
+#include "MessageSchema.hpp"
+#include "AllocationCounter.hpp"
+#include <algorithm>
+#include <memory_resource>
 
 using namespace p2p;
 
@@ -190,4 +194,310 @@ TEST(MessageTest, BinaryDataInPayload) {
     auto deserialized = Message::Deserialize(serialized);
     
     EXPECT_EQ(deserialized.GetPayload(), binaryData);
-}
\ No newline at end of file
+}
+
+TEST(MessageTest, CreateChannelMessages) {
+    auto join = Message::CreateChannelJoinMessage("#ops");
+    EXPECT_EQ(join.GetType(), MessageType::CHANNEL_JOIN);
+    ASSERT_EQ(join.GetPayload().size(), 5);
+    EXPECT_EQ(join.GetPayload()[0], 4);
+    EXPECT_EQ(std::string(join.GetPayload().begin() + 1, join.GetPayload().end()), "#ops");
+    
+    auto part = Message::CreateChannelPartMessage("#ops");
+    EXPECT_EQ(part.GetType(), MessageType::CHANNEL_PART);
+    EXPECT_EQ(part.GetPayload(), join.GetPayload());
+    
+    auto text = Message::CreateChannelTextMessage(0x01020304, "hi");
+    EXPECT_EQ(text.GetType(), MessageType::CHANNEL_TEXT);
+    auto deserialized = Message::Deserialize(text.Serialize());
+    EXPECT_EQ(deserialized.GetPayload(), (std::vector<uint8_t>{1, 2, 3, 4, 'h', 'i'}));
+}
+
+TEST(MessageTest, PeekHeader) {
+    auto msg = Message::CreateTextMessage("Hello");
+    auto serialized = msg.Serialize();
+    
+    auto header = Message::PeekHeader(serialized.data(), serialized.size());
+    ASSERT_TRUE(header.has_value());
+    EXPECT_EQ(header->type, MessageType::TEXT);
+    EXPECT_EQ(header->payloadSize, 5);
+    
+    EXPECT_FALSE(Message::PeekHeader(serialized.data(), Message::kHeaderSize - 1).has_value());
+}
+
+TEST(MessageTest, RelayRouteRoundTrip) {
+    auto inner = Message::CreateTextMessage("via relay");
+    auto relay = Message::CreateRelayMessage("aaaaaaaaaaaaaaaa", "bbbbbbbbbbbbbbbb", inner);
+    EXPECT_EQ(relay.GetType(), MessageType::RELAY);
+    
+    auto serialized = relay.Serialize();
+    auto route = Message::PeekRelayRoute(serialized.data(), serialized.size());
+    ASSERT_TRUE(route.has_value());
+    EXPECT_EQ(route->sourceId, "aaaaaaaaaaaaaaaa");
+    EXPECT_EQ(route->targetId, "bbbbbbbbbbbbbbbb");
+    
+    // Route views point into the frame rather than copying it
+    EXPECT_GE(route->frame, serialized.data());
+    EXPECT_EQ(route->frame + route->frameSize, serialized.data() + serialized.size());
+    
+    auto unwrapped = Message::Deserialize(route->frame, route->frameSize);
+    EXPECT_EQ(unwrapped.GetType(), MessageType::TEXT);
+    EXPECT_EQ(std::string(unwrapped.GetPayload().begin(), unwrapped.GetPayload().end()), "via relay");
+    EXPECT_TRUE(route->signature.empty());
+    
+    // The source's signature rides between the route and the frame
+    const std::vector<uint8_t> signature(64, 0x5a);
+    serialized = Message::CreateRelayMessage("aaaaaaaaaaaaaaaa", "bbbbbbbbbbbbbbbb", inner, signature).Serialize();
+    route = Message::PeekRelayRoute(serialized.data(), serialized.size());
+    ASSERT_TRUE(route.has_value());
+    EXPECT_TRUE(std::ranges::equal(route->signature, signature));
+    EXPECT_EQ(Message::Deserialize(route->frame, route->frameSize).GetType(), MessageType::TEXT);
+}
+
+TEST(MessageTest, MalformedRelayRoute) {
+    // Not a relay frame
+    auto text = Message::CreateTextMessage("x").Serialize();
+    EXPECT_FALSE(Message::PeekRelayRoute(text.data(), text.size()).has_value());
+    
+    // Source length runs past the payload
+    auto bogus = Message(MessageType::RELAY, {200, 'a', 'b'}).Serialize();
+    EXPECT_FALSE(Message::PeekRelayRoute(bogus.data(), bogus.size()).has_value());
+    
+    // Truncated frame
+    auto relay = Message::CreateRelayMessage("a", "b", Message::CreatePingMessage()).Serialize();
+    EXPECT_FALSE(Message::PeekRelayRoute(relay.data(), relay.size() - 1).has_value());
+}
+
+// Counts allocations routed through it, to see which payloads leave inline storage
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+TEST(MessageTest, SmallPayloadsStayInline) {
+    CountingResource resource;
+    std::vector<uint8_t> chat(Payload::kInlineCapacity, 'c');
+    
+    auto ping = Message::CreatePingMessage().Serialize();
+    auto line = Message(MessageType::TEXT, chat).Serialize();
+    
+    auto pingMsg = Message::Deserialize(ping.data(), ping.size(), &resource);
+    auto lineMsg = Message::Deserialize(line.data(), line.size(), &resource);
+    EXPECT_TRUE(pingMsg.GetPayload().IsInline());
+    EXPECT_TRUE(lineMsg.GetPayload().IsInline());
+    EXPECT_EQ(lineMsg.GetPayload(), chat);
+    EXPECT_EQ(resource.allocations, 0);
+    
+    // One byte past the inline capacity goes to the resource
+    chat.push_back('c');
+    auto big = Message(MessageType::TEXT, chat).Serialize();
+    auto bigMsg = Message::Deserialize(big.data(), big.size(), &resource);
+    EXPECT_FALSE(bigMsg.GetPayload().IsInline());
+    EXPECT_EQ(bigMsg.GetPayload(), chat);
+    EXPECT_EQ(resource.allocations, 1);
+}
+
+TEST(MessageTest, PayloadMoveAndCopy) {
+    std::vector<uint8_t> bytes(1000, 0x5A);
+    Payload heap(bytes);
+    const uint8_t* buffer = heap.data();
+    
+    // Moving a heap payload hands over its buffer
+    Payload moved(std::move(heap));
+    EXPECT_EQ(moved.data(), buffer);
+    EXPECT_TRUE(heap.empty());
+    
+    Payload small(std::vector<uint8_t>{1, 2, 3});
+    moved = std::move(small);
+    EXPECT_EQ(moved, (std::vector<uint8_t>{1, 2, 3}));
+    EXPECT_TRUE(moved.IsInline());
+    
+    // Copies are independent and grow as needed
+    Payload copy = moved;
+    copy = Payload(bytes);
+    EXPECT_EQ(copy, bytes);
+    EXPECT_EQ(moved, (std::vector<uint8_t>{1, 2, 3}));
+    
+    copy.assign(bytes.data(), bytes.data() + 10);
+    EXPECT_EQ(copy.size(), 10);
+}
+
+TEST(MessageTest, CreateTextMessageAdoptsString) {
+    std::string longText(500, 'x');
+    const char* buffer = longText.data();
+    
+    auto msg = Message::CreateTextMessage(std::move(longText));
+    EXPECT_EQ(reinterpret_cast<const char*>(msg.GetPayload().data()), buffer);
+    EXPECT_EQ(msg.GetPayload().size(), 500);
+    
+    // Copies of an adopted payload own their bytes
+    Message copy = msg;
+    EXPECT_NE(copy.GetPayload().data(), msg.GetPayload().data());
+    EXPECT_EQ(copy.GetPayload(), msg.GetPayload());
+    
+    auto shortMsg = Message::CreateTextMessage(std::string("short"));
+    EXPECT_TRUE(shortMsg.GetPayload().IsInline());
+    EXPECT_EQ(std::string(shortMsg.GetPayload().begin(), shortMsg.GetPayload().end()), "short");
+}
+
+TEST(MessageTest, AllocationsPerSendAndReceive) {
+    std::vector<uint8_t> publicKey(65, 0x04);
+    std::string peerId = "0123456789abcdef";
+    std::string bigText(1000, 't');
+    
+    // Building small messages stays on the stack
+    size_t before = GetAllocationCount();
+    auto chat = Message::CreateTextMessage("hello there");
+    auto handshake = Message::CreateHandshakeMessage(peerId, publicKey);
+    auto channel = Message::CreateChannelTextMessage(7, "hi channel");
+    auto relay = Message::CreateRelayMessage(peerId, peerId, chat);
+    auto ping = Message::CreatePingMessage();
+    EXPECT_EQ(GetAllocationCount() - before, 0);
+    
+    // Moving a large payload in adopts its buffer
+    std::vector<uint8_t> bigBytes(1000, 'b');
+    before = GetAllocationCount();
+    auto bigTextMessage = Message::CreateTextMessage(std::move(bigText));
+    auto bigBytesMessage = Message(MessageType::FILE_CHUNK, std::move(bigBytes));
+    Message moved = std::move(bigBytesMessage);
+    moved.SetPayload(std::vector<uint8_t>(10, 'x'));
+    EXPECT_EQ(GetAllocationCount() - before, 1); // Only the temporary vector
+    
+    // Send: one allocation for the serialized frame
+    before = GetAllocationCount();
+    auto frame = handshake.Serialize();
+    EXPECT_EQ(GetAllocationCount() - before, 1);
+    
+    // Receive: none for an inline payload, one for a large payload
+    before = GetAllocationCount();
+    auto received = Message::Deserialize(frame);
+    EXPECT_EQ(GetAllocationCount() - before, 0);
+    EXPECT_EQ(received.GetPayload(), handshake.GetPayload());
+    
+    auto bigFrame = bigTextMessage.Serialize();
+    before = GetAllocationCount();
+    auto bigReceived = Message::Deserialize(bigFrame);
+    EXPECT_EQ(GetAllocationCount() - before, 1);
+    EXPECT_EQ(bigReceived.GetPayload().size(), 1000);
+}
+
+TEST(MessageTest, SerializeToMatchesSerialize) {
+    auto inner = Message::CreateTextMessage("inner");
+    auto relay = Message::CreateRelayMessage("src", "dst", inner);
+    
+    std::vector<uint8_t> buffer(relay.GetSerializedSize());
+    relay.SerializeTo(buffer.data());
+    EXPECT_EQ(buffer, relay.Serialize());
+    
+    auto route = Message::PeekRelayRoute(buffer.data(), buffer.size());
+    ASSERT_TRUE(route.has_value());
+    auto unwrapped = Message::Deserialize(route->frame, route->frameSize);
+    EXPECT_EQ(unwrapped.GetPayload(), inner.GetPayload());
+}
+
+TEST(MessageTest, SchemaHandshakeRoundTrip) {
+    std::vector<uint8_t> publicKey = {0x04, 0x01, 0x02};
+    auto msg = Message::CreateHandshakeMessage("0123456789abcdef", publicKey);
+    
+    auto handshake = schema::Handshake::Parse(msg);
+    ASSERT_TRUE(handshake.has_value());
+    EXPECT_EQ(handshake->Get<schema::Handshake::kPeerId>(), "0123456789abcdef");
+    auto key = handshake->Get<schema::Handshake::kPublicKey>();
+    EXPECT_EQ(std::vector<uint8_t>(key.begin(), key.end()), publicKey);
+    
+    // Views point into the message's payload
+    EXPECT_EQ(key.data(), msg.GetPayload().data() + 2 + 16);
+    
+    // Wrong type, or an ID length that runs past the payload
+    auto ping = Message::CreatePingMessage();
+    Message overrun(MessageType::HANDSHAKE, {0, 5, 'a'});
+    Message truncated(MessageType::HANDSHAKE, std::vector<uint8_t>{0});
+    EXPECT_FALSE(schema::Handshake::Parse(ping).has_value());
+    EXPECT_FALSE(schema::Handshake::Parse(overrun).has_value());
+    EXPECT_FALSE(schema::Handshake::Parse(truncated).has_value());
+}
+
+TEST(MessageTest, SchemaAuthRoundTrip) {
+    std::vector<uint8_t> publicKey = {0x04, 0x01, 0x02};
+    std::vector<uint8_t> nonce(16, 0x5A);
+    std::vector<uint8_t> signature = {0x30, 0x44, 0x02};
+    
+    // The opening challenge has no signature
+    auto openingMsg = Message::CreateAuthChallengeMessage("0123456789abcdef", publicKey, nonce);
+    auto opening = schema::AuthChallenge::Parse(openingMsg);
+    ASSERT_TRUE(opening.has_value());
+    EXPECT_EQ(opening->Get<schema::AuthChallenge::kPeerId>(), "0123456789abcdef");
+    EXPECT_EQ(opening->Get<schema::AuthChallenge::kNonce>().size(), 16u);
+    EXPECT_TRUE(opening->Get<schema::AuthChallenge::kSignature>().empty());
+    
+    auto answerMsg = Message::CreateAuthChallengeMessage("0123456789abcdef", publicKey, nonce, signature);
+    auto serialized = answerMsg.Serialize();
+    auto received = Message::Deserialize(serialized.data(), serialized.size());
+    auto answer = schema::AuthChallenge::Parse(received);
+    ASSERT_TRUE(answer.has_value());
+    auto key = answer->Get<schema::AuthChallenge::kPublicKey>();
+    auto sig = answer->Get<schema::AuthChallenge::kSignature>();
+    EXPECT_EQ(std::vector<uint8_t>(key.begin(), key.end()), publicKey);
+    EXPECT_EQ(std::vector<uint8_t>(sig.begin(), sig.end()), signature);
+    
+    auto responseMsg = Message::CreateAuthResponseMessage(signature);
+    auto response = schema::AuthResponse::Parse(responseMsg);
+    ASSERT_TRUE(response.has_value());
+    sig = response->Get<schema::AuthResponse::kSignature>();
+    EXPECT_EQ(std::vector<uint8_t>(sig.begin(), sig.end()), signature);
+    
+    // Truncated before the signature
+    Message truncated(MessageType::AUTH_CHALLENGE, {0, 1, 'a', 0, 0});
+    EXPECT_FALSE(schema::AuthChallenge::Parse(truncated).has_value());
+}
+
+TEST(MessageTest, SchemaPeerList) {
+    std::vector<std::string> peers = {"10.0.0.1:8080", "", "[::1]:9000"};
+    auto msg = Message::CreatePeerListMessage(peers);
+    
+    auto list = schema::PeerList::Parse(msg);
+    ASSERT_TRUE(list.has_value());
+    auto entries = list->Get<schema::PeerList::kPeers>();
+    EXPECT_EQ(entries.size(), 3);
+    
+    std::vector<std::string> parsed;
+    for (auto peer : entries) {
+        parsed.emplace_back(peer);
+    }
+    EXPECT_EQ(parsed, peers);
+    
+    // A count claiming more entries than the payload holds is rejected
+    Message overrun(MessageType::PEER_LIST, {0, 2, 0, 1, 'a'});
+    EXPECT_FALSE(schema::PeerList::Parse(overrun).has_value());
+}
+
+TEST(MessageTest, SchemaSizingAndWriting) {
+    static_assert(schema::Uint<uint32_t>::Read(std::array<uint8_t, 4>{1, 2, 3, 4}.data()) == 0x01020304);
+    
+    std::string longName(300, 'n');
+    EXPECT_EQ(schema::ChannelJoin::SizeOf(std::string_view(longName)), 1 + 255);
+    
+    // Oversized names are truncated to what the length prefix can count
+    auto join = Message::CreateChannelJoinMessage(longName);
+    auto parsed = schema::ChannelJoin::Parse(join);
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_EQ(parsed->Get<schema::ChannelJoin::kChannel>(), longName.substr(0, 255));
+    
+    auto textMsg = Message::CreateChannelTextMessage(0xDEADBEEF, "hello");
+    auto text = schema::ChannelText::Parse(textMsg);
+    ASSERT_TRUE(text.has_value());
+    EXPECT_EQ(text->Get<schema::ChannelText::kChannelId>(), 0xDEADBEEF);
+    EXPECT_EQ(text->Get<schema::ChannelText::kText>(), "hello");
+}
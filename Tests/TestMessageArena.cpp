@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "MessageArena.hpp"
+#include "Message.hpp"
+#include "AllocationCounter.hpp"
+
+using namespace p2p;
+
+TEST(MessageArenaTest, DeserializeIntoArena) {
+    MessageArena arena;
+    auto data = Message::CreateTextMessage("hello arena").Serialize();
+
+    Message msg = Message::Deserialize(data.data(), data.size(), arena.GetResource());
+    EXPECT_EQ(msg.GetPayload().GetResource(), arena.GetResource());
+    EXPECT_EQ(std::string(msg.GetPayload().begin(), msg.GetPayload().end()), "hello arena");
+}
+
+TEST(MessageArenaTest, CopyLeavesArena) {
+    MessageArena arena;
+    auto data = Message::CreateTextMessage("keep me").Serialize();
+
+    Message kept;
+    {
+        Message msg = Message::Deserialize(data.data(), data.size(), arena.GetResource());
+        kept = msg;
+    }
+    arena.Reset();
+
+    EXPECT_EQ(kept.GetPayload().GetResource(), std::pmr::get_default_resource());
+    EXPECT_EQ(std::string(kept.GetPayload().begin(), kept.GetPayload().end()), "keep me");
+}
+
+TEST(MessageArenaTest, CopyAssignmentLeavesArena) {
+    MessageArena arena;
+    std::vector<uint8_t> large(1024, 0x5A);
+    auto data = Message(MessageType::FILE_CHUNK, large).Serialize();
+    Message source(MessageType::FILE_CHUNK, std::vector<uint8_t>(2048, 0x33));
+
+    // Assigning over an arena-backed message mustn't reuse the arena's storage
+    Message kept = Message::Deserialize(data.data(), data.size(), arena.GetResource());
+    ASSERT_EQ(kept.GetPayload().GetResource(), arena.GetResource());
+    kept = source;
+    arena.Reset();
+
+    EXPECT_EQ(kept.GetPayload().GetResource(), std::pmr::get_default_resource());
+    EXPECT_EQ(kept.GetPayload(), source.GetPayload());
+
+    // Likewise for one small enough to fit inline
+    Message text = Message::CreateTextMessage("short");
+    Message small = Message::Deserialize(data.data(), data.size(), arena.GetResource());
+    small = text;
+    EXPECT_EQ(small.GetPayload().GetResource(), std::pmr::get_default_resource());
+    arena.Reset();
+}
+
+TEST(MessageArenaTest, GrowsAfterOverflow) {
+    MessageArena arena(256);
+    std::vector<uint8_t> payload(1024, 0xAB);
+    auto data = Message(MessageType::FILE_CHUNK, payload).Serialize();
+
+    {
+        Message msg = Message::Deserialize(data.data(), data.size(), arena.GetResource());
+        EXPECT_EQ(msg.GetPayload(), payload);
+    }
+    EXPECT_GT(arena.GetOverflowCount(), 0);
+    arena.Reset();
+    EXPECT_GE(arena.GetCapacity(), 256 + 1024);
+
+    // The grown buffer now holds the same batch without spilling
+    auto overflows = arena.GetOverflowCount();
+    {
+        Message msg = Message::Deserialize(data.data(), data.size(), arena.GetResource());
+        EXPECT_EQ(msg.GetPayload(), payload);
+    }
+    arena.Reset();
+    EXPECT_EQ(arena.GetOverflowCount(), overflows);
+}
+
+TEST(MessageArenaTest, GrowsNoFurtherThanItsCap) {
+    MessageArena arena(256, 4096);
+    std::vector<uint8_t> payload(64 * 1024, 0xCD);
+    auto data = Message(MessageType::FILE_CHUNK, payload).Serialize();
+
+    for (int batch = 0; batch < 3; ++batch) {
+        {
+            Message msg = Message::Deserialize(data.data(), data.size(), arena.GetResource());
+            EXPECT_EQ(msg.GetPayload(), payload);
+        }
+        arena.Reset();
+        EXPECT_EQ(arena.GetCapacity(), 4096u);
+    }
+
+    // Past the cap every such batch spills to the heap rather than the buffer growing
+    size_t before = GetAllocationCount();
+    {
+        Message msg = Message::Deserialize(data.data(), data.size(), arena.GetResource());
+    }
+    arena.Reset();
+    EXPECT_GT(GetAllocationCount() - before, 0u);
+    EXPECT_EQ(arena.GetCapacity(), 4096u);
+}
+
+TEST(MessageArenaTest, SteadyStateReceiveDoesNotAllocate) {
+    MessageArena arena;
+    std::vector<std::vector<uint8_t>> frames;
+    for (size_t size : {0, 16, 200, 1500, 8000}) {
+        frames.push_back(Message(MessageType::TEXT, std::vector<uint8_t>(size, 'x')).Serialize());
+    }
+
+    auto receiveBatch = [&]() {
+        size_t bytes = 0;
+        for (int i = 0; i < 8; ++i) {
+            for (const auto& frame : frames) {
+                Message msg = Message::Deserialize(frame.data(), frame.size(), arena.GetResource());
+                bytes += msg.GetPayload().size();
+            }
+        }
+        arena.Reset();
+        return bytes;
+    };
+
+    // Warm up so the arena settles at the batch's high-water mark
+    receiveBatch();
+    receiveBatch();
+
+    size_t before = GetAllocationCount();
+    size_t bytes = 0;
+    for (int batch = 0; batch < 100; ++batch) {
+        bytes += receiveBatch();
+    }
+    size_t allocations = GetAllocationCount() - before;
+
+    EXPECT_EQ(bytes, 100 * 8 * (16 + 200 + 1500 + 8000));
+    EXPECT_EQ(allocations, 0);
+
+    // On the default resource only payloads too big to inline allocate
+    before = GetAllocationCount();
+    size_t heapPayloads = 0;
+    for (const auto& frame : frames) {
+        Message msg = Message::Deserialize(frame);
+        heapPayloads += !msg.GetPayload().IsInline();
+    }
+    EXPECT_EQ(heapPayloads, 3);
+    EXPECT_EQ(GetAllocationCount() - before, heapPayloads);
+}
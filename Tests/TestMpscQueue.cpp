@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "MpscQueue.hpp"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace p2p;
+
+TEST(MpscQueueTest, FifoForOneProducer) {
+    MpscQueue<int> queue;
+    int value = 0;
+    EXPECT_FALSE(queue.Pop(value));
+
+    for (int i = 0; i < 10; ++i) {
+        queue.Push(i);
+    }
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(queue.Pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.Pop(value));
+}
+
+TEST(MpscQueueTest, MoveOnlyValuesAndCleanup) {
+    auto queue = std::make_unique<MpscQueue<std::unique_ptr<int>>>();
+    queue->Push(std::make_unique<int>(7));
+    queue->Push(std::make_unique<int>(8));
+
+    std::unique_ptr<int> value;
+    ASSERT_TRUE(queue->Pop(value));
+    EXPECT_EQ(*value, 7);
+
+    // The remaining value is freed with the queue
+    queue.reset();
+}
+
+TEST(MpscQueueTest, ConcurrentProducersKeepPerProducerOrder) {
+    constexpr int kProducers = 4;
+    constexpr int kPerProducer = 50000;
+
+    struct Item {
+        int producer = 0;
+        int sequence = 0;
+    };
+    MpscQueue<Item> queue;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&queue, p]() {
+            for (int i = 0; i < kPerProducer; ++i) {
+                queue.Push({p, i});
+            }
+        });
+    }
+
+    std::vector<int> next(kProducers, 0);
+    int received = 0;
+    Item item;
+    while (received < kProducers * kPerProducer) {
+        if (!queue.Pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(item.sequence, next[item.producer]);
+        ++next[item.producer];
+        ++received;
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    EXPECT_FALSE(queue.Pop(item));
+}
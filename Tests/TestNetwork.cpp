@@ -3,8 +3,15 @@
 #include "Network.hpp"
 #include "Message.hpp"
 #include "PeerManager.hpp"
+#include "Crypto.hpp"
+#include "ReplayCache.hpp"
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <filesystem>
+#include <future>
 #include <zmq.hpp>
 
 using namespace p2p;
@@ -56,12 +63,12 @@ TEST_F(NetworkTest, MultipleStartStop) {
 
 TEST_F(NetworkTest, SetMessageHandler) {
     bool handlerCalled = false;
-    std::string receivedPeerId;
+    PeerHandle receivedPeer;
     p2p::Message receivedMessage;
     
-    network1->SetMessageHandler([&](const std::string& peerId, const p2p::Message& msg) {
+    network1->SetMessageHandler([&](PeerHandle peer, const p2p::Message& msg) {
         handlerCalled = true;
-        receivedPeerId = peerId;
+        receivedPeer = peer;
         receivedMessage = msg;
     });
     
@@ -73,23 +80,23 @@ TEST_F(NetworkTest, SetMessageHandler) {
     
     // Verify handler was set (we can't directly access it, but we can verify it doesn't crash)
     EXPECT_NO_THROW(network1->SetMessageHandler(nullptr));
-    EXPECT_NO_THROW(network1->SetMessageHandler([](const std::string&, const p2p::Message&){}));
+    EXPECT_NO_THROW(network1->SetMessageHandler([](PeerHandle, const p2p::Message&){}));
 }
 
 TEST_F(NetworkTest, SetConnectionHandler) {
     bool handlerCalled = false;
-    std::string connectedPeerId;
+    PeerHandle connectedPeer;
     bool connectionStatus = false;
     
-    network1->SetConnectionHandler([&](const std::string& peerId, bool connected) {
+    network1->SetConnectionHandler([&](PeerHandle peer, bool connected) {
         handlerCalled = true;
-        connectedPeerId = peerId;
+        connectedPeer = peer;
         connectionStatus = connected;
     });
     
     // Verify handler was set (we can't directly access it, but we can verify it doesn't crash)
     EXPECT_NO_THROW(network1->SetConnectionHandler(nullptr));
-    EXPECT_NO_THROW(network1->SetConnectionHandler([](const std::string&, bool){}));
+    EXPECT_NO_THROW(network1->SetConnectionHandler([](PeerHandle, bool){}));
 }
 
 TEST_F(NetworkTest, ConnectToPeer) {
@@ -101,7 +108,7 @@ TEST_F(NetworkTest, ConnectToPeer) {
     
     // Set up connection handler
     bool connected = false;
-    network1->SetConnectionHandler([&](const std::string& peerId, bool status) {
+    network1->SetConnectionHandler([&](PeerHandle, bool status) {
         connected = status;
     });
     
@@ -228,4 +235,818 @@ TEST_F(NetworkTest, SimultaneousBidirectionalConnect) {
     
     // Should handle gracefully without deadlock
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
-}
\ No newline at end of file
+}
+
+TEST_F(NetworkTest, SendViaRelayWithoutPeers) {
+    network1->SetRelayEnabled(true);
+    network1->Start(9305);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    // Relay peer is unknown, so nothing is sent, but it shouldn't crash
+    p2p::Message testMsg = p2p::Message::CreateTextMessage("Relayed");
+    EXPECT_NO_THROW(network1->SendViaRelay("relay_peer", "target_peer", testMsg));
+    EXPECT_EQ(network1->GetRelayedMessageCount(), 0);
+}
+
+TEST_F(NetworkTest, BidirectionalConnectListsEachPeerOnce) {
+    PeerInfo local1;
+    local1.id = "aaaaaaaaaaaaaaaa";
+    local1.endpoint = Endpoint(9306);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    PeerInfo local2;
+    local2.id = "bbbbbbbbbbbbbbbb";
+    local2.endpoint = Endpoint(9307);
+    local2.isConnected = true;
+    peerManager2->SetLocalPeer(local2);
+    
+    network1->Start(9306);
+    network2->Start(9307);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    // Each side has an outgoing and an incoming connection to the other
+    network1->ConnectToPeer("localhost", 9307);
+    network2->ConnectToPeer("localhost", 9306);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    
+    auto peer2 = peerManager1->FindPeerHandle("bbbbbbbbbbbbbbbb");
+    auto peers = network1->GetConnectedPeers();
+    EXPECT_EQ(std::count(peers.begin(), peers.end(), peer2), 1);
+    EXPECT_EQ(peers.size(), 1);
+    
+    // Outgoing peers are reachable by peer ID, not only by address:port
+    std::atomic<int> received{0};
+    network2->SetMessageHandler([&](PeerHandle peer, const p2p::Message& msg) {
+        if (peerManager2->GetPeerId(peer) == "aaaaaaaaaaaaaaaa" && msg.GetType() == MessageType::TEXT) {
+            ++received;
+        }
+    });
+    network1->BroadcastMessage(p2p::Message::CreateTextMessage("once"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(received, 1);
+}
+
+TEST_F(NetworkTest, TypedHandlersAndPingResponder) {
+    PeerInfo local1;
+    local1.id = "cccccccccccccccc";
+    local1.endpoint = Endpoint(9308);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    PeerInfo local2;
+    local2.id = "dddddddddddddddd";
+    local2.endpoint = Endpoint(9309);
+    local2.isConnected = true;
+    peerManager2->SetLocalPeer(local2);
+    
+    std::atomic<int> texts{0};
+    std::atomic<int> wrongType{0};
+    std::atomic<int> catchAll{0};
+    std::atomic<int> pongs{0};
+    network2->On<MessageType::TEXT>([&](PeerHandle, const p2p::Message& msg) {
+        ++texts;
+        wrongType += msg.GetType() != MessageType::TEXT;
+    });
+    network2->On<MessageType::CHANNEL_TEXT>([&](PeerHandle, const p2p::Message&) {
+        ++wrongType;
+    });
+    network2->SetMessageHandler([&](PeerHandle, const p2p::Message&) {
+        ++catchAll;
+    });
+    network1->On<MessageType::PONG>([&](PeerHandle, const p2p::Message&) {
+        ++pongs;
+    });
+    
+    network1->Start(9308);
+    network2->Start(9309);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network1->ConnectToPeer("localhost", 9309);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    
+    // Handshakes reach the catch-all but no typed handler here
+    int baseline = catchAll;
+    network1->BroadcastMessage(p2p::Message::CreateTextMessage("typed"));
+    network1->BroadcastMessage(p2p::Message::CreatePingMessage());
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    
+    EXPECT_EQ(texts, 1);
+    EXPECT_EQ(wrongType, 0);
+    EXPECT_EQ(catchAll - baseline, 2);
+    // The built-in heartbeat responder answers the PING
+    EXPECT_EQ(pongs, 1);
+}
+
+TEST_F(NetworkTest, ShardedSendsAndReceives) {
+    PeerInfo local1;
+    local1.id = "eeeeeeeeeeeeeeee";
+    local1.endpoint = Endpoint(9310);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    PeerInfo local2;
+    local2.id = "ffffffffffffffff";
+    local2.endpoint = Endpoint(9311);
+    local2.isConnected = true;
+    peerManager2->SetLocalPeer(local2);
+    
+    // Dealers and the router land on different reactors
+    network1->SetShardCount(4);
+    network2->SetShardCount(4);
+    
+    std::atomic<int> received1{0};
+    std::atomic<int> received2{0};
+    network1->On<MessageType::TEXT>([&](PeerHandle, const p2p::Message&) { ++received1; });
+    network2->On<MessageType::TEXT>([&](PeerHandle, const p2p::Message&) { ++received2; });
+    
+    network1->Start(9310);
+    network2->Start(9311);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network1->ConnectToPeer("localhost", 9311);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    
+    // Sends from this thread cross into the owning shard's inbox
+    auto peer1 = peerManager2->FindPeerHandle("eeeeeeeeeeeeeeee");
+    auto peer2 = peerManager1->FindPeerHandle("ffffffffffffffff");
+    for (int i = 0; i < 500; ++i) {
+        network1->SendMessage(peer2, p2p::Message::CreateTextMessage("to 2"));
+        network2->SendMessage(peer1, p2p::Message::CreateTextMessage("to 1"));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    
+    EXPECT_EQ(received2, 500);
+    EXPECT_EQ(received1, 500);
+}
+
+TEST_F(NetworkTest, PipelinedFramesWaitForSlowHandshake) {
+    PeerInfo local1;
+    local1.id = "1212121212121212";
+    local1.endpoint = Endpoint(9312);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    PeerInfo local2;
+    local2.id = "3434343434343434";
+    local2.endpoint = Endpoint(9313);
+    local2.isConnected = true;
+    peerManager2->SetLocalPeer(local2);
+    
+    // Slow verification parks the connection; it mustn't lose what follows the handshake
+    network2->SetHandshakeVerifier([](const std::string&, const std::vector<uint8_t>&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return true;
+    });
+    
+    std::vector<std::string> texts;
+    std::mutex textsMutex;
+    network2->On<MessageType::TEXT>([&](PeerHandle, const p2p::Message& msg) {
+        std::lock_guard<std::mutex> lock(textsMutex);
+        texts.emplace_back(msg.GetPayload().begin(), msg.GetPayload().end());
+    });
+    
+    network1->Start(9312);
+    network2->Start(9313);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network1->ConnectToPeer("localhost", 9313);
+    for (int i = 0; i < 10; ++i) {
+        network1->SendMessage("localhost:9313", p2p::Message::CreateTextMessage(std::to_string(i)));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    
+    std::lock_guard<std::mutex> lock(textsMutex);
+    ASSERT_EQ(texts.size(), 10u);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(texts[i], std::to_string(i));
+    }
+}
+
+TEST_F(NetworkTest, RejectedHandshakeDropsConnection) {
+    PeerInfo local1;
+    local1.id = "5656565656565656";
+    local1.endpoint = Endpoint(9314);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    network2->SetHandshakeVerifier([](const std::string&, const std::vector<uint8_t>&) { return false; });
+    
+    std::atomic<int> received{0};
+    network2->On<MessageType::TEXT>([&](PeerHandle, const p2p::Message&) { ++received; });
+    
+    network1->Start(9314);
+    network2->Start(9315);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network1->ConnectToPeer("localhost", 9315);
+    network1->SendMessage("localhost:9315", p2p::Message::CreateTextMessage("ignored"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    
+    EXPECT_TRUE(network2->GetConnectedPeers().empty());
+    EXPECT_FALSE(peerManager2->FindPeerHandle("5656565656565656"));
+    EXPECT_EQ(received, 0);
+}
+
+TEST_F(NetworkTest, ChallengeResponseHandshake) {
+    CryptoManager crypto;
+    auto keys1 = crypto.GenerateKeyPair();
+    auto keys2 = crypto.GenerateKeyPair();
+    
+    PeerInfo local1;
+    local1.id = crypto.GeneratePeerId(keys1.publicKey);
+    local1.publicKey = keys1.publicKey;
+    local1.endpoint = Endpoint(9316);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    PeerInfo local2;
+    local2.id = crypto.GeneratePeerId(keys2.publicKey);
+    local2.publicKey = keys2.publicKey;
+    local2.endpoint = Endpoint(9317);
+    local2.isConnected = true;
+    peerManager2->SetLocalPeer(local2);
+    
+    network1->SetIdentity(crypto, keys1.privateKey);
+    network2->SetIdentity(crypto, keys2.privateKey);
+    
+    std::atomic<int> received{0};
+    network2->On<MessageType::TEXT>([&](PeerHandle, const p2p::Message&) { ++received; });
+    
+    network1->Start(9316);
+    network2->Start(9317);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network1->ConnectToPeer("localhost", 9317);
+    network1->SendMessage("localhost:9317", p2p::Message::CreateTextMessage("pipelined"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    
+    // Both sides proved their keys; the text waited for the proof
+    EXPECT_EQ(network1->GetConnectedPeers().size(), 1u);
+    EXPECT_EQ(network2->GetConnectedPeers().size(), 1u);
+    EXPECT_TRUE(peerManager2->FindPeerHandle(local1.id));
+    EXPECT_EQ(received, 1);
+    EXPECT_EQ(network2->GetRejectedHandshakeCount(), 0u);
+}
+
+TEST_F(NetworkTest, ChallengeResponseRejectsStolenKey) {
+    CryptoManager crypto;
+    auto victim = crypto.GenerateKeyPair();
+    auto attacker = crypto.GenerateKeyPair();
+    auto keys2 = crypto.GenerateKeyPair();
+    
+    // Claims the victim's identity but can only sign with its own key
+    PeerInfo local1;
+    local1.id = crypto.GeneratePeerId(victim.publicKey);
+    local1.publicKey = victim.publicKey;
+    local1.endpoint = Endpoint(9318);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    PeerInfo local2;
+    local2.id = crypto.GeneratePeerId(keys2.publicKey);
+    local2.publicKey = keys2.publicKey;
+    local2.endpoint = Endpoint(9319);
+    local2.isConnected = true;
+    peerManager2->SetLocalPeer(local2);
+    
+    network1->SetIdentity(crypto, attacker.privateKey);
+    network2->SetIdentity(crypto, keys2.privateKey);
+    
+    network1->Start(9318);
+    network2->Start(9319);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network1->ConnectToPeer("localhost", 9319);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    
+    EXPECT_TRUE(network2->GetConnectedPeers().empty());
+    EXPECT_FALSE(peerManager2->FindPeerHandle(local1.id));
+    EXPECT_GT(network2->GetRejectedHandshakeCount(), 0u);
+}
+
+TEST_F(NetworkTest, PerPeerRateLimitThrottlesFlood) {
+    PeerInfo local1;
+    local1.id = "7878787878787878";
+    local1.endpoint = Endpoint(9320);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    NetworkManager::RateLimits limits;
+    limits.peerMessageRate = 10.0;
+    limits.peerMessageBurst = 20.0;
+    network2->SetRateLimits(limits);
+    
+    std::atomic<int> received{0};
+    network2->On<MessageType::TEXT>([&](PeerHandle, const p2p::Message&) { ++received; });
+    
+    network1->Start(9320);
+    network2->Start(9321);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network1->ConnectToPeer("localhost", 9321);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    
+    for (int i = 0; i < 200; ++i) {
+        network1->SendMessage("localhost:9321", p2p::Message::CreateTextMessage("flood"));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    
+    // The burst, plus whatever refilled while the flood was arriving
+    EXPECT_GT(received, 0);
+    EXPECT_LT(received, 40);
+    EXPECT_EQ(network2->GetThrottleStats().throttledMessages, static_cast<uint64_t>(200 - received));
+}
+
+TEST_F(NetworkTest, ConnectionAdmissionLimit) {
+    PeerInfo local1;
+    local1.id = "9a9a9a9a9a9a9a9a";
+    local1.endpoint = Endpoint(9322);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    PeerManager peerManager3;
+    NetworkManager network3(peerManager3);
+    PeerInfo local3;
+    local3.id = "bcbcbcbcbcbcbcbc";
+    local3.endpoint = Endpoint(9324);
+    local3.isConnected = true;
+    peerManager3.SetLocalPeer(local3);
+    
+    NetworkManager::RateLimits limits;
+    limits.maxConnections = 1;
+    network2->SetRateLimits(limits);
+    
+    network1->Start(9322);
+    network2->Start(9323);
+    network3.Start(9324);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network1->ConnectToPeer("localhost", 9323);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    network3.ConnectToPeer("localhost", 9323);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    
+    // The second peer's frames are refused before it gets a table entry
+    EXPECT_EQ(network2->GetConnectedPeers().size(), 1u);
+    EXPECT_FALSE(peerManager2->FindPeerHandle("bcbcbcbcbcbcbcbc"));
+    EXPECT_GT(network2->GetThrottleStats().refusedConnections, 0u);
+    network3.Stop();
+}
+
+TEST_F(NetworkTest, JunkFromUnidentifiedPeersFreesTheirEntries) {
+    PeerInfo local1;
+    local1.id = "9b9b9b9b9b9b9b9b";
+    local1.endpoint = Endpoint(9358);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    NetworkManager::RateLimits limits;
+    limits.maxConnections = 8;
+    network2->SetRateLimits(limits);
+    network1->Start(9358);
+    network2->Start(9359);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    // Each bare dealer is a new routing ID that never says who it is
+    zmq::context_t context;
+    for (int i = 0; i < 16; ++i) {
+        zmq::socket_t dealer(context, zmq::socket_type::dealer);
+        dealer.set(zmq::sockopt::linger, 200);
+        dealer.connect("tcp://127.0.0.1:9359");
+        zmq::message_t junk("\xde\xad", 3);
+        dealer.send(junk, zmq::send_flags::none);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    
+    // And an honest peer reconnecting comes back under a new routing ID each time
+    for (int i = 0; i < 10; ++i) {
+        network1->ConnectToPeer("localhost", 9359);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ASSERT_EQ(network2->GetConnectedPeers().size(), 1u) << "reconnect " << i;
+        network1->DisconnectPeer("localhost:9359");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    EXPECT_EQ(network2->GetThrottleStats().refusedConnections, 0u);
+}
+
+TEST_F(NetworkTest, UnfinishedHandshakesTimeOut) {
+    CryptoManager crypto;
+    auto keys1 = crypto.GenerateKeyPair();
+    auto keys2 = crypto.GenerateKeyPair();
+    PeerInfo local1;
+    local1.id = crypto.GeneratePeerId(keys1.publicKey);
+    local1.publicKey = keys1.publicKey;
+    local1.endpoint = Endpoint(9360);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    PeerInfo local2;
+    local2.id = crypto.GeneratePeerId(keys2.publicKey);
+    local2.publicKey = keys2.publicKey;
+    local2.endpoint = Endpoint(9361);
+    local2.isConnected = true;
+    peerManager2->SetLocalPeer(local2);
+    network1->SetIdentity(crypto, keys1.privateKey);
+    network2->SetIdentity(crypto, keys2.privateKey);
+    
+    NetworkManager::RateLimits limits;
+    limits.maxConnections = 2;
+    limits.handshakeTimeout = 0.5;
+    network2->SetRateLimits(limits);
+    network1->Start(9360);
+    network2->Start(9361);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    // Dealers that challenge and then never answer hold every slot
+    zmq::context_t context;
+    std::vector<std::unique_ptr<zmq::socket_t>> stalled;
+    for (int i = 0; i < 2; ++i) {
+        auto stranger = crypto.GenerateKeyPair();
+        auto hello = Message::CreateAuthChallengeMessage(
+            crypto.GeneratePeerId(stranger.publicKey), stranger.publicKey, crypto.RandomBytes(ReplayCache::kNonceSize));
+        zmq::message_t frame(hello.GetSerializedSize());
+        hello.SerializeTo(static_cast<uint8_t*>(frame.data()));
+        auto& dealer = *stalled.emplace_back(std::make_unique<zmq::socket_t>(context, zmq::socket_type::dealer));
+        dealer.set(zmq::sockopt::linger, 0);
+        dealer.connect("tcp://127.0.0.1:9361");
+        dealer.send(frame, zmq::send_flags::none);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    network1->ConnectToPeer("localhost", 9361);
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    EXPECT_TRUE(network2->GetConnectedPeers().empty());
+    EXPECT_GT(network2->GetThrottleStats().refusedConnections, 0u);
+    network1->DisconnectPeer("localhost:9361");
+    
+    // Until they time out
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    network1->ConnectToPeer("localhost", 9361);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_EQ(network2->GetConnectedPeers().size(), 1u);
+}
+
+TEST_F(NetworkTest, OversizedFramesAreDroppedUndecoded) {
+    PeerInfo local1;
+    local1.id = "8989898989898989";
+    local1.endpoint = Endpoint(9325);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    network2->SetMaxPayloadSize(MessageType::TEXT, 64);
+    
+    std::vector<std::string> received;
+    std::mutex receivedMutex;
+    network2->On<MessageType::TEXT>([&](PeerHandle, const p2p::Message& msg) {
+        std::lock_guard<std::mutex> lock(receivedMutex);
+        received.emplace_back(msg.GetPayload().begin(), msg.GetPayload().end());
+    });
+    
+    network1->Start(9325);
+    network2->Start(9326);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network1->ConnectToPeer("localhost", 9326);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    
+    network1->SendMessage("localhost:9326", p2p::Message::CreateTextMessage(std::string(65, 'x')));
+    network1->SendMessage("localhost:9326", p2p::Message::CreateTextMessage("fits"));
+    network1->SendMessage("localhost:9326", p2p::Message(MessageType::PING, std::vector<uint8_t>(8, 0)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    
+    // The connection survives the rejected frames
+    std::lock_guard<std::mutex> lock(receivedMutex);
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0], "fits");
+    EXPECT_EQ(network2->GetRejectedFrameCount(), 2u);
+}
+
+namespace {
+
+// A node whose peer ID and challenge-response identity come from a fresh key
+struct CurveNode {
+    PeerManager peers;
+    NetworkManager network{peers};
+    
+    CurveNode(CryptoManager& crypto, uint16_t port, bool curve) {
+        auto keys = crypto.GenerateKeyPair();
+        PeerInfo local;
+        local.id = crypto.GeneratePeerId(keys.publicKey);
+        local.publicKey = keys.publicKey;
+        local.endpoint = Endpoint(port);
+        local.isConnected = true;
+        peers.SetLocalPeer(local);
+        
+        NetworkManager::RateLimits unlimited;
+        unlimited.peerMessageRate = 0.0;
+        unlimited.globalMessageRate = 0.0;
+        network.SetRateLimits(unlimited);
+        network.SetIdentity(crypto, keys.privateKey);
+        network.SetCurveEnabled(curve);
+    }
+};
+
+// Sends `count` messages with at most `window` unacknowledged, so the result
+// reflects the transport rather than queue drops; returns messages per second
+double MeasureThroughput(CurveNode& sender, uint16_t senderPort, CurveNode& receiver, uint16_t port,
+                         int count, size_t size) {
+    std::atomic<int> received{0};
+    receiver.network.On<MessageType::TEXT>([&](PeerHandle, const p2p::Message&) { ++received; });
+    
+    receiver.network.Start(port);
+    sender.network.Start(senderPort);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    sender.network.ConnectToPeer("localhost", port, receiver.network.GetCurvePublicKey());
+    auto ready = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (receiver.network.GetConnectedPeers().empty() && std::chrono::steady_clock::now() < ready) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    
+    constexpr int kWindow = 256;
+    auto message = p2p::Message::CreateTextMessage(std::string(size, 'b'));
+    std::string endpoint = "localhost:" + std::to_string(port);
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(20);
+    for (int i = 0; i < count && std::chrono::steady_clock::now() < deadline; ++i) {
+        while (i - received >= kWindow && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        sender.network.SendMessage(endpoint, message);
+    }
+    while (received < count && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    sender.network.Stop();
+    receiver.network.Stop();
+    EXPECT_EQ(received, count);
+    return received / elapsed;
+}
+
+} // namespace
+
+TEST_F(NetworkTest, CurveEncryptedConnection) {
+    if (!zmq_has("curve")) {
+        GTEST_SKIP() << "libzmq built without CURVE";
+    }
+    
+    CryptoManager crypto;
+    CurveNode server(crypto, 9327, true);
+    CurveNode client(crypto, 9328, true);
+    CurveNode impostor(crypto, 9329, true);
+    EXPECT_EQ(server.network.GetCurvePublicKey().size(), 40u);
+    EXPECT_NE(server.network.GetCurvePublicKey(), client.network.GetCurvePublicKey());
+    
+    std::atomic<int> received{0};
+    server.network.On<MessageType::TEXT>([&](PeerHandle, const p2p::Message&) { ++received; });
+    server.network.Start(9327);
+    client.network.Start(9328);
+    impostor.network.Start(9329);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    // No key, no connection
+    EXPECT_THROW(client.network.ConnectToPeer("localhost", 9327), std::invalid_argument);
+    
+    // Pinning the wrong server key fails the CURVE handshake, so nothing arrives
+    impostor.network.ConnectToPeer("localhost", 9327, client.network.GetCurvePublicKey());
+    impostor.network.SendMessage("localhost:9327", p2p::Message::CreateTextMessage("spoofed"));
+    
+    client.network.ConnectToPeer("localhost", 9327, server.network.GetCurvePublicKey());
+    client.network.SendMessage("localhost:9327", p2p::Message::CreateTextMessage("secret"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    
+    EXPECT_EQ(received, 1);
+    EXPECT_EQ(server.network.GetConnectedPeers().size(), 1u);
+    EXPECT_TRUE(server.peers.FindPeerHandle(client.peers.GetLocalPeer().id));
+    
+    impostor.network.Stop();
+    client.network.Stop();
+    server.network.Stop();
+}
+
+TEST_F(NetworkTest, CurveThroughputBenchmark) {
+    if (!zmq_has("curve")) {
+        GTEST_SKIP() << "libzmq built without CURVE";
+    }
+    
+    constexpr int kMessages = 20000;
+    constexpr size_t kSize = 1024;
+    CryptoManager crypto;
+    
+    CurveNode plainSender(crypto, 9330, false);
+    CurveNode plainReceiver(crypto, 9331, false);
+    double plain = MeasureThroughput(plainSender, 9330, plainReceiver, 9331, kMessages, kSize);
+    
+    CurveNode curveSender(crypto, 9332, true);
+    CurveNode curveReceiver(crypto, 9333, true);
+    double curve = MeasureThroughput(curveSender, 9332, curveReceiver, 9333, kMessages, kSize);
+    
+    std::printf("Throughput, %zu-byte messages: plaintext %.0f msg/s, CURVE %.0f msg/s (%.0f%%)\n",
+                kSize, plain, curve, plain > 0 ? 100.0 * curve / plain : 0.0);
+    EXPECT_GT(curve, 0.0);
+}
+
+TEST_F(NetworkTest, ConnectsOverIpcAndInproc) {
+    PeerInfo local1;
+    local1.id = "9a9a9a9a9a9a9a9a";
+    local1.endpoint = Endpoint(9334);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    std::string ipc = "ipc://" + (std::filesystem::temp_directory_path() / "p2pchat-test-sidecar.ipc").string();
+    network2->AddListenEndpoint(ipc);
+    
+    std::atomic<int> received{0};
+    network2->On<MessageType::TEXT>([&](PeerHandle, const p2p::Message&) { ++received; });
+    
+    network1->Start(9334);
+    network2->Start(9335);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    // The sidecar endpoint, and the inproc one every node listens on
+    network1->ConnectToPeer(ipc);
+    network1->ConnectToPeer("inproc://p2pchat-9335");
+    network1->SendMessage(ipc, p2p::Message::CreateTextMessage("over ipc"));
+    network1->SendMessage("inproc://p2pchat-9335", p2p::Message::CreateTextMessage("over inproc"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    
+    EXPECT_EQ(received, 2);
+    EXPECT_EQ(network2->GetConnectedPeers().size(), 1u);
+    EXPECT_THROW(network1->ConnectToPeer("udp://localhost:9335"), std::invalid_argument);
+}
+
+TEST_F(NetworkTest, ConnectsOverIpv6) {
+    PeerInfo local1;
+    local1.id = "7c7c7c7c7c7c7c7c";
+    local1.endpoint = Endpoint(9352);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    PeerInfo local2;
+    local2.id = "7d7d7d7d7d7d7d7d";
+    local2.endpoint = Endpoint(9353);
+    local2.isConnected = true;
+    peerManager2->SetLocalPeer(local2);
+    
+    network1->SetLocalTransportsEnabled(false);
+    std::atomic<int> received{0};
+    network2->On<MessageType::TEXT>([&](PeerHandle, const p2p::Message&) { ++received; });
+    
+    network1->Start(9352);
+    network2->Start(9353);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    // The listener is dual-stack; the connection is named with the address in brackets
+    network1->ConnectToPeer("::1", 9353);
+    network1->SendMessage("[::1]:9353", p2p::Message::CreateTextMessage("over IPv6"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    
+    EXPECT_EQ(received, 1);
+    ASSERT_EQ(network2->GetConnectedPeers().size(), 1u);
+    auto peers = peerManager1->GetAllPeers();
+    ASSERT_EQ(peers.size(), 1u);
+    EXPECT_EQ(peers[0].endpoint, *Endpoint::FromAddress("::1", 9353));
+}
+
+TEST_F(NetworkTest, ReconnectsToARecordedEndpoint) {
+    PeerInfo local1;
+    local1.id = "7e7e7e7e7e7e7e7e";
+    local1.endpoint = Endpoint(9354);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    PeerInfo local2;
+    local2.id = "7f7f7f7f7f7f7f7f";
+    local2.endpoint = Endpoint(9355);
+    local2.isConnected = true;
+    peerManager2->SetLocalPeer(local2);
+
+    std::atomic<int> received{0};
+    network2->On<MessageType::TEXT>([&](PeerHandle, const p2p::Message&) { ++received; });
+    network1->Start(9354);
+    network2->Start(9355);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // localhost is recorded as the loopback address, which dials straight back
+    network1->ConnectToPeer("localhost", 9355);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto peers = peerManager1->GetAllPeers();
+    ASSERT_EQ(peers.size(), 1u);
+    EXPECT_EQ(peers[0].endpoint, Endpoint::Loopback(9355));
+
+    network1->DisconnectPeer(peers[0].id);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network1->ConnectToPeer(peers[0].endpoint);
+    network1->SendMessage(peers[0].endpoint.ToString(), p2p::Message::CreateTextMessage("again"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_EQ(received, 1);
+}
+
+TEST_F(NetworkTest, ConnectsByNameWithoutALookup) {
+    PeerInfo local1;
+    local1.id = "7d7d7d7d7d7d7d7d";
+    local1.endpoint = Endpoint(9356);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    network1->Start(9356);
+
+    // The name never resolves; that is libzmq's problem, not the caller's
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_NO_THROW(network1->ConnectToPeer("no-such-host.invalid", 9357));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+    EXPECT_TRUE(network1->GetConnectedPeers().empty());
+}
+
+TEST_F(NetworkTest, ConnectsToPeersAsynchronously) {
+    PeerInfo local1;
+    local1.id = "8b8b8b8b8b8b8b8b";
+    local1.endpoint = Endpoint(9349);
+    local1.isConnected = true;
+    peerManager1->SetLocalPeer(local1);
+    
+    // Over tcp, so the address race runs rather than the inproc shortcut
+    network1->SetLocalTransportsEnabled(false);
+    std::atomic<int> received{0};
+    network2->On<MessageType::TEXT>([&](PeerHandle, const p2p::Message&) { ++received; });
+    
+    network1->Start(9349);
+    network2->Start(9350);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    auto connected = network1->ConnectToPeerAsync("localhost", 9350);
+    ASSERT_EQ(connected.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_NO_THROW(connected.get());
+    network1->SendMessage("localhost:9350", p2p::Message::CreateTextMessage("raced"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_EQ(received, 1);
+    EXPECT_EQ(network2->GetConnectedPeers().size(), 1u);
+    
+    // Nothing listening: the error comes back instead of a silent retry loop
+    std::promise<std::exception_ptr> refused;
+    network1->ConnectToPeerAsync("127.0.0.1", 9351, "", [&](std::exception_ptr error) {
+        refused.set_value(error);
+    });
+    auto error = refused.get_future();
+    ASSERT_EQ(error.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_TRUE(error.get() != nullptr);
+    
+    auto unknown = network1->ConnectToPeerAsync("no-such-host.invalid", 9350);
+    ASSERT_EQ(unknown.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_THROW(unknown.get(), std::runtime_error);
+}
+
+namespace {
+
+// Round trips of the built-in PING/PONG, in microseconds, sorted
+std::vector<double> MeasureRoundTrips(PeerManager& peers, NetworkManager& sender, uint16_t port,
+                                      const std::string& endpoint, const std::string& id, int count) {
+    PeerInfo local;
+    local.id = id;
+    local.endpoint = Endpoint(port);
+    local.isConnected = true;
+    peers.SetLocalPeer(local);
+    
+    std::atomic<int> pongs{0};
+    sender.On<MessageType::PONG>([&](PeerHandle, const p2p::Message&) { ++pongs; });
+    sender.Start(port);
+    sender.ConnectToPeer(endpoint);
+    
+    // The first ping waits out the handshake
+    std::vector<double> latencies;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    for (int i = 0; i <= count && std::chrono::steady_clock::now() < deadline; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        sender.SendMessage(endpoint, p2p::Message::CreatePingMessage());
+        while (pongs <= i && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        if (i > 0) {
+            latencies.push_back(std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+    }
+    sender.Stop();
+    
+    EXPECT_EQ(latencies.size(), static_cast<size_t>(count)) << endpoint;
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+} // namespace
+
+TEST_F(NetworkTest, LocalTransportLatencyBenchmark) {
+    constexpr int kRoundTrips = 2000;
+    
+    std::string ipc = "ipc://" + (std::filesystem::temp_directory_path() / "p2pchat-test-bench.ipc").string();
+    network2->AddListenEndpoint(ipc);
+    network2->AddListenEndpoint("inproc://p2pchat-test-bench");
+    network2->Start(9336);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    // A fresh node per transport, so each PONG comes back the way its PING went
+    struct Case { const char* name; std::string endpoint; uint16_t port; const char* id; };
+    std::vector<Case> cases = {
+        { "tcp", "tcp://127.0.0.1:9336", 9337, "b1b1b1b1b1b1b1b1" },
+        { "ipc", ipc, 9338, "b2b2b2b2b2b2b2b2" },
+        { "inproc", "inproc://p2pchat-test-bench", 9339, "b3b3b3b3b3b3b3b3" },
+    };
+    for (const auto& c : cases) {
+        PeerManager peers;
+        NetworkManager sender(peers);
+        auto latencies = MeasureRoundTrips(peers, sender, c.port, c.endpoint, c.id, kRoundTrips);
+        if (latencies.empty()) {
+            continue;
+        }
+        std::printf("%-6s round trip: p50 %.1f us, p99 %.1f us\n", c.name,
+                    latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100]);
+    }
+}
@@ -1,8 +1,10 @@
 #include <gtest/gtest.h>
 #include "PeerManager.hpp"
 #include <filesystem>
+#include <fstream>
 #include <thread>
 #include <set>
+#include <iostream>
 
 using namespace p2p;
 
@@ -13,10 +15,9 @@ protected:
     PeerInfo createTestPeer(const std::string& id) {
         PeerInfo peer;
         peer.id = id;
-        peer.address = "192.168.1." + id;
-        // Use a hash of the ID for port number to handle non-numeric IDs
+        // Use a hash of the ID for the address and port to handle non-numeric IDs
         std::hash<std::string> hasher;
-        peer.port = 8080 + (hasher(id) % 1000);
+        peer.endpoint = Endpoint::FromIpv4(0xC0A80100 | (hasher(id) & 0xFF), 8080 + (hasher(id) % 1000));
         peer.publicKey = {1, 2, 3};
         peer.isConnected = false;
         peer.lastSeen = std::chrono::system_clock::now();
@@ -41,8 +42,7 @@ TEST_F(PeerManagerTest, AddAndGetPeer) {
     auto retrieved = peerManager.GetPeer("1");
     ASSERT_TRUE(retrieved.has_value());
     EXPECT_EQ(retrieved->id, peer.id);
-    EXPECT_EQ(retrieved->address, peer.address);
-    EXPECT_EQ(retrieved->port, peer.port);
+    EXPECT_EQ(retrieved->endpoint, peer.endpoint);
 }
 
 TEST_F(PeerManagerTest, RemovePeer) {
@@ -104,24 +104,21 @@ TEST_F(PeerManagerTest, LocalPeer) {
     
     const auto& retrieved = peerManager.GetLocalPeer();
     EXPECT_EQ(retrieved.id, localPeer.id);
-    EXPECT_EQ(retrieved.address, localPeer.address);
-    EXPECT_EQ(retrieved.port, localPeer.port);
+    EXPECT_EQ(retrieved.endpoint, localPeer.endpoint);
 }
 
 TEST_F(PeerManagerTest, SaveAndLoadPeers) {
     // Create peers with explicit port numbers
     PeerInfo peer1;
     peer1.id = "peer1";
-    peer1.address = "192.168.1.10";
-    peer1.port = 8081;
+    peer1.endpoint = *Endpoint::FromAddress("192.168.1.10", 8081);
     peer1.publicKey = {1, 2, 3, 4};
     peer1.isConnected = false;
     peer1.lastSeen = std::chrono::system_clock::now();
     
     PeerInfo peer2;
     peer2.id = "peer2";
-    peer2.address = "192.168.1.20";
-    peer2.port = 8082;
+    peer2.endpoint = *Endpoint::FromAddress("2001:db8::20", 8082);
     peer2.publicKey = {5, 6, 7, 8};
     peer2.isConnected = false;
     peer2.lastSeen = std::chrono::system_clock::now();
@@ -142,16 +139,59 @@ TEST_F(PeerManagerTest, SaveAndLoadPeers) {
     ASSERT_TRUE(loaded2.has_value());
     
     EXPECT_EQ(loaded1->id, peer1.id);
-    EXPECT_EQ(loaded1->address, peer1.address);
-    EXPECT_EQ(loaded1->port, peer1.port);
+    EXPECT_EQ(loaded1->endpoint, peer1.endpoint);
     EXPECT_EQ(loaded1->publicKey, peer1.publicKey);
     
     EXPECT_EQ(loaded2->id, peer2.id);
-    EXPECT_EQ(loaded2->address, peer2.address);
-    EXPECT_EQ(loaded2->port, peer2.port);
+    EXPECT_EQ(loaded2->endpoint, peer2.endpoint);
     EXPECT_EQ(loaded2->publicKey, peer2.publicKey);
 }
 
+TEST_F(PeerManagerTest, LoadsPeersWithoutALiteralAddress) {
+    {
+        std::ofstream file("test_peers.txt");
+        file << "named|peer.example.com|7000|0102\n"
+             << "inbound||0|0a\n";
+    }
+    peerManager.LoadPeersFromFile("test_peers.txt");
+
+    auto named = peerManager.GetPeer("named");
+    ASSERT_TRUE(named.has_value());
+    EXPECT_TRUE(named->endpoint.IsUnspecified());
+    EXPECT_EQ(named->endpoint.GetPort(), 7000);
+    EXPECT_EQ(named->host, "peer.example.com");
+    EXPECT_EQ(named->publicKey, (std::vector<uint8_t>{1, 2}));
+    EXPECT_EQ(peerManager.GetPeer("inbound")->endpoint, Endpoint());
+    EXPECT_TRUE(peerManager.GetPeer("inbound")->host.empty());
+
+    // Names are written back as they came, unknown addresses empty
+    peerManager.SavePeersToFile("test_peers.txt");
+    std::ifstream file("test_peers.txt");
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_NE(contents.find("named|peer.example.com|7000|"), std::string::npos);
+    EXPECT_NE(contents.find("inbound||0|"), std::string::npos);
+}
+
+TEST_F(PeerManagerTest, SaveAndLoadNamedPeer) {
+    PeerInfo peer;
+    peer.id = "named";
+    peer.endpoint = Endpoint(7000);
+    peer.host = "peer.example.com";
+    peer.publicKey = {1, 2, 3};
+    peer.isConnected = true;
+    peer.lastSeen = std::chrono::system_clock::now();
+    peerManager.AddPeer(peer);
+    peerManager.SavePeersToFile("test_peers.txt");
+
+    PeerManager loaded;
+    loaded.LoadPeersFromFile("test_peers.txt");
+    auto named = loaded.GetPeer("named");
+    ASSERT_TRUE(named.has_value());
+    EXPECT_EQ(named->host, "peer.example.com");
+    EXPECT_EQ(named->endpoint, Endpoint(7000));
+    EXPECT_EQ(named->publicKey, peer.publicKey);
+}
+
 TEST_F(PeerManagerTest, NonExistentPeer) {
     auto retrieved = peerManager.GetPeer("nonexistent");
     EXPECT_FALSE(retrieved.has_value());
@@ -175,8 +215,7 @@ TEST_F(PeerManagerTest, ConcurrentAddPeers) {
             for (int i = 0; i < peersPerThread; ++i) {
                 PeerInfo peer;
                 peer.id = "thread" + std::to_string(t) + "_peer" + std::to_string(i);
-                peer.address = "10.0." + std::to_string(t) + "." + std::to_string(i);
-                peer.port = 5000 + (t * 100) + i;
+                peer.endpoint = Endpoint::FromIpv4(0x0A000000 | (t << 8) | i, 5000 + (t * 100) + i);
                 peer.publicKey = {static_cast<uint8_t>(t), static_cast<uint8_t>(i)};
                 peer.isConnected = false;
                 peer.lastSeen = std::chrono::system_clock::now();
@@ -245,4 +284,141 @@ TEST_F(PeerManagerTest, PeerExpiration) {
             EXPECT_GT(age, std::chrono::minutes(50));
         }
     }
-}
\ No newline at end of file
+}
+
+TEST_F(PeerManagerTest, AddPeerReturnsStableHandle) {
+    auto handle = peerManager.AddPeer(createTestPeer("1"));
+    ASSERT_TRUE(handle.IsValid());
+    
+    // Re-adding and interning resolve to the same handle
+    EXPECT_EQ(peerManager.AddPeer(createTestPeer("1")), handle);
+    EXPECT_EQ(peerManager.InternPeerId("1"), handle);
+    EXPECT_EQ(peerManager.FindPeerHandle("1"), handle);
+    EXPECT_EQ(peerManager.GetPeerId(handle), "1");
+    
+    auto retrieved = peerManager.GetPeer(handle);
+    ASSERT_TRUE(retrieved.has_value());
+    EXPECT_EQ(retrieved->id, "1");
+    EXPECT_EQ(retrieved->handle, handle);
+}
+
+TEST_F(PeerManagerTest, HandleLookups) {
+    auto handle = peerManager.AddPeer(createTestPeer("1"));
+    
+    peerManager.UpdatePeerStatus(handle, true);
+    EXPECT_TRUE(peerManager.GetPeer("1")->isConnected);
+    
+    peerManager.RemovePeer(handle);
+    EXPECT_FALSE(peerManager.GetPeer(handle).has_value());
+    
+    // The handle outlives the peer entry and is reused when it comes back
+    EXPECT_EQ(peerManager.AddPeer(createTestPeer("1")), handle);
+    
+    EXPECT_FALSE(peerManager.FindPeerHandle("unknown").IsValid());
+    EXPECT_FALSE(peerManager.GetPeer(PeerHandle()).has_value());
+    EXPECT_TRUE(peerManager.GetPeerId(PeerHandle()).empty());
+}
+
+TEST_F(PeerManagerTest, RawPeerId) {
+    auto handle = peerManager.InternPeerId("0123456789abcdef");
+    RawPeerId expected = {0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+    EXPECT_EQ(peerManager.GetRawPeerId(handle), expected);
+    
+    // IDs that aren't 16 hex characters are interned by string only
+    auto other = peerManager.InternPeerId("not-hex");
+    EXPECT_EQ(peerManager.GetRawPeerId(other), RawPeerId{});
+}
+
+TEST_F(PeerManagerTest, ConcurrentIntern) {
+    std::vector<std::thread> threads;
+    std::vector<PeerHandle> handles(8);
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([this, t, &handles]() {
+            for (int i = 0; i < 100; ++i) {
+                peerManager.InternPeerId("peer" + std::to_string(i));
+            }
+            handles[t] = peerManager.InternPeerId("peer42");
+        });
+    }
+    
+    for (auto& t : threads) {
+        t.join();
+    }
+    
+    for (auto handle : handles) {
+        EXPECT_EQ(handle, handles[0]);
+    }
+    EXPECT_EQ(peerManager.GetPeerId(handles[0]), "peer42");
+}
+
+TEST_F(PeerManagerTest, RttAndStalePeers) {
+    auto fresh = peerManager.AddPeer(createTestPeer("fresh"));
+    auto stalePeer = createTestPeer("stale");
+    stalePeer.isConnected = true;
+    stalePeer.lastSeen = std::chrono::system_clock::now() - std::chrono::minutes(5);
+    auto stale = peerManager.AddPeer(stalePeer);
+    peerManager.UpdatePeerStatus(fresh, true);
+    
+    peerManager.UpdatePeerRtt(fresh, std::chrono::microseconds(1500));
+    EXPECT_EQ(peerManager.GetPeerRtt(fresh), std::chrono::microseconds(1500));
+    EXPECT_EQ(peerManager.GetPeerRtt(PeerHandle()), std::chrono::microseconds(0));
+    
+    auto cutoff = std::chrono::system_clock::now() - std::chrono::minutes(1);
+    EXPECT_EQ(peerManager.GetStalePeers(cutoff), std::vector<PeerHandle>{stale});
+    
+    peerManager.TouchPeer(stale);
+    EXPECT_TRUE(peerManager.GetStalePeers(cutoff).empty());
+    EXPECT_EQ(peerManager.GetConnectedPeerHandles().size(), 2);
+}
+
+TEST_F(PeerManagerTest, ReAddPeerReplacesColdData) {
+    auto peer = createTestPeer("1");
+    auto handle = peerManager.AddPeer(peer);
+    
+    peer.publicKey = {9, 8, 7, 6, 5, 4};
+    peer.endpoint = *Endpoint::FromAddress("10.1.1.1", 9001);
+    peerManager.AddPeer(peer);
+    for (int i = 0; i < 10; ++i) {
+        peerManager.AddPeer(createTestPeer(std::to_string(100 + i)));
+    }
+    peerManager.RemovePeer("100");
+    
+    auto retrieved = peerManager.GetPeer(handle);
+    ASSERT_TRUE(retrieved.has_value());
+    EXPECT_EQ(retrieved->publicKey, peer.publicKey);
+    EXPECT_EQ(retrieved->endpoint.ToString(), "10.1.1.1:9001");
+    EXPECT_EQ(peerManager.GetPeer("101")->publicKey, (std::vector<uint8_t>{1, 2, 3}));
+}
+
+TEST_F(PeerManagerTest, ScanPerformance) {
+    // Heartbeat-style scans over 100k peers only walk the packed status arrays
+    const int numPeers = 100000;
+    auto now = std::chrono::system_clock::now();
+    size_t expectedStale = 0;
+    for (int i = 0; i < numPeers; ++i) {
+        PeerInfo peer;
+        peer.id = "peer" + std::to_string(i);
+        peer.endpoint = Endpoint::FromIpv4(0x0A000001, 9000);
+        peer.publicKey.assign(65, static_cast<uint8_t>(i));
+        peer.isConnected = i % 2 == 0;
+        peer.lastSeen = now - std::chrono::seconds(i % 120);
+        expectedStale += peer.isConnected && i % 120 > 60;
+        peerManager.AddPeer(peer);
+    }
+    
+    const int iterations = 20;
+    size_t connected = 0;
+    size_t stale = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        connected += peerManager.GetConnectedPeerHandles().size();
+        stale += peerManager.GetStalePeers(now - std::chrono::seconds(60)).size();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    auto perScan = std::chrono::duration_cast<std::chrono::microseconds>(elapsed) / (2 * iterations);
+    
+    EXPECT_EQ(connected, iterations * numPeers / 2);
+    EXPECT_EQ(stale, iterations * expectedStale);
+    std::cout << "100k peer scan: " << perScan.count() << " us" << std::endl;
+    EXPECT_LT(perScan, std::chrono::milliseconds(50));
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "ReplayCache.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace p2p;
+
+namespace {
+
+ReplayCache::Nonce MakeNonce(uint32_t value) {
+    ReplayCache::Nonce nonce{};
+    for (size_t i = 0; i < 4; ++i) {
+        nonce[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+    return nonce;
+}
+
+} // namespace
+
+TEST(ReplayCacheTest, RejectsRepeatedNonces) {
+    ReplayCache cache(8);
+    auto nonce = MakeNonce(1);
+
+    EXPECT_TRUE(cache.Insert(nonce));
+    EXPECT_FALSE(cache.Insert(nonce));
+    EXPECT_TRUE(cache.Contains(nonce));
+    EXPECT_TRUE(cache.Insert(MakeNonce(2)));
+    EXPECT_EQ(cache.GetSize(), 2u);
+
+    // Only full-size nonces are accepted
+    std::vector<uint8_t> shortNonce(ReplayCache::kNonceSize - 1, 0xAA);
+    EXPECT_FALSE(cache.Insert(shortNonce));
+    EXPECT_FALSE(cache.Contains(shortNonce));
+}
+
+TEST(ReplayCacheTest, EvictsOldestWhenFull) {
+    ReplayCache cache(4);
+    for (uint32_t i = 0; i < 6; ++i) {
+        EXPECT_TRUE(cache.Insert(MakeNonce(i)));
+    }
+
+    EXPECT_EQ(cache.GetSize(), 4u);
+    EXPECT_FALSE(cache.Contains(MakeNonce(0)));
+    EXPECT_FALSE(cache.Contains(MakeNonce(1)));
+    for (uint32_t i = 2; i < 6; ++i) {
+        EXPECT_TRUE(cache.Contains(MakeNonce(i)));
+    }
+
+    // An evicted nonce is accepted again
+    EXPECT_TRUE(cache.Insert(MakeNonce(0)));
+    EXPECT_FALSE(cache.Contains(MakeNonce(2)));
+}
+
+TEST(ReplayCacheTest, ConcurrentInsertsAcceptEachNonceOnce) {
+    ReplayCache cache(10000);
+    std::atomic<int> accepted{0};
+
+    // Every thread tries the same nonces; exactly one insert of each wins
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (uint32_t i = 0; i < 2000; ++i) {
+                accepted += cache.Insert(MakeNonce(i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(accepted, 2000);
+    EXPECT_EQ(cache.GetSize(), 2000u);
+}
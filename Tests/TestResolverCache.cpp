@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include "ResolverCache.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace p2p;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct Answer {
+    ResolverCache::Addresses addresses;
+    std::exception_ptr error;
+};
+
+Answer ResolveNow(ResolverCache& cache, const std::string& host,
+                  ResolverCache::Clock::time_point now = ResolverCache::Clock::now()) {
+    std::promise<Answer> answer;
+    cache.Resolve(host, [&](const ResolverCache::Addresses& addresses, std::exception_ptr error) {
+        answer.set_value({ addresses, error });
+    }, now);
+    return answer.get_future().get();
+}
+
+} // namespace
+
+TEST(ResolverCacheTest, AnswersLiteralsWithoutALookup) {
+    ResolverCache cache(1, [](const std::string&) -> ResolverCache::Addresses {
+        throw std::runtime_error("looked up a literal");
+    });
+
+    EXPECT_EQ(ResolveNow(cache, "10.0.0.7").addresses, ResolverCache::Addresses{ "10.0.0.7" });
+    EXPECT_EQ(ResolveNow(cache, "[::1]").addresses, ResolverCache::Addresses{ "::1" });
+    EXPECT_EQ(cache.GetLookupCount(), 0u);
+}
+
+TEST(ResolverCacheTest, KeepsAnswersUntilTheyExpire) {
+    ResolverCache cache(1, [](const std::string&) { return ResolverCache::Addresses{ "::1", "127.0.0.1" }; });
+    cache.SetTtl(30s);
+
+    auto answer = ResolveNow(cache, "peer");
+    EXPECT_EQ(answer.addresses, (ResolverCache::Addresses{ "::1", "127.0.0.1" }));
+    EXPECT_FALSE(answer.error);
+
+    ResolveNow(cache, "peer", ResolverCache::Clock::now() + 20s);
+    EXPECT_EQ(cache.GetLookupCount(), 1u);
+
+    ResolveNow(cache, "peer", ResolverCache::Clock::now() + 31s);
+    EXPECT_EQ(cache.GetLookupCount(), 2u);
+
+    cache.Clear();
+    ResolveNow(cache, "peer");
+    EXPECT_EQ(cache.GetLookupCount(), 3u);
+}
+
+TEST(ResolverCacheTest, KeepsFailuresBriefly) {
+    ResolverCache cache(1, [](const std::string&) -> ResolverCache::Addresses {
+        throw std::runtime_error("NXDOMAIN");
+    });
+    cache.SetFailureTtl(2s);
+
+    auto answer = ResolveNow(cache, "missing");
+    EXPECT_TRUE(answer.addresses.empty());
+    EXPECT_THROW(std::rethrow_exception(answer.error), std::runtime_error);
+
+    EXPECT_TRUE(ResolveNow(cache, "missing").error);
+    EXPECT_EQ(cache.GetLookupCount(), 1u);
+
+    ResolveNow(cache, "missing", ResolverCache::Clock::now() + 3s);
+    EXPECT_EQ(cache.GetLookupCount(), 2u);
+}
+
+TEST(ResolverCacheTest, CallersShareALookupInFlight) {
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    ResolverCache cache(2, [released](const std::string&) {
+        released.wait();
+        return ResolverCache::Addresses{ "192.0.2.1" };
+    });
+
+    constexpr int kCallers = 16;
+    std::atomic<int> answered{0};
+    for (int i = 0; i < kCallers; ++i) {
+        cache.Resolve("busy", [&](const ResolverCache::Addresses& addresses, std::exception_ptr) {
+            if (addresses == ResolverCache::Addresses{ "192.0.2.1" }) {
+                ++answered;
+            }
+        });
+    }
+    EXPECT_EQ(answered, 0);
+    release.set_value();
+
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (answered < kCallers && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(answered, kCallers);
+    EXPECT_EQ(cache.GetLookupCount(), 1u);
+}
+
+TEST(ResolverCacheTest, LooksUpNamesInParallel) {
+    constexpr int kNames = 64;
+    constexpr auto kLatency = 20ms;
+    ResolverCache cache(8, [kLatency](const std::string&) {
+        std::this_thread::sleep_for(kLatency);
+        return ResolverCache::Addresses{ "192.0.2.2" };
+    });
+
+    std::atomic<int> answered{0};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kNames; ++i) {
+        cache.Resolve("host-" + std::to_string(i), [&](const ResolverCache::Addresses&, std::exception_ptr) {
+            ++answered;
+        });
+    }
+    while (answered < kNames && std::chrono::steady_clock::now() - start < 10s) {
+        std::this_thread::sleep_for(1ms);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(answered, kNames);
+    EXPECT_LT(elapsed, kLatency * kNames / 2); // One at a time would take all of it
+}
+
+TEST(ResolverCacheTest, SystemLookupFindsLocalhost) {
+    auto addresses = ResolverCache::SystemLookup("localhost");
+    ASSERT_FALSE(addresses.empty());
+    for (const auto& address : addresses) {
+        EXPECT_TRUE(address == "127.0.0.1" || address == "::1") << address;
+    }
+    EXPECT_THROW(ResolverCache::SystemLookup("no-such-host.invalid"), std::runtime_error);
+}
@@ -0,0 +1,394 @@
+#include <gtest/gtest.h>
+#include "SimulatedNetwork.hpp"
+#include "Message.hpp"
+#include "MessageSchema.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace p2p;
+using namespace std::chrono_literals;
+using Duration = SimulatedNetwork::Duration;
+using ConnectionId = Transport::ConnectionId;
+
+namespace {
+
+std::vector<uint8_t> Frame(const Message& message) {
+    return message.Serialize();
+}
+
+std::string Endpoint(size_t node) {
+    return "sim://node-" + std::to_string(node);
+}
+
+// Nodes listening on sim://node-<i>, each tracking its connections both ways
+struct Topology {
+    struct Dialled {
+        ConnectionId connection;
+        size_t peer;
+    };
+
+    SimulatedNetwork network;
+    std::vector<std::unique_ptr<SimulatedTransport>> nodes;
+    std::vector<std::vector<ConnectionId>> connections;
+    std::vector<std::vector<Dialled>> dialled;
+
+    Topology(size_t count, uint64_t seed, const SimulatedNetwork::Link& link) : network(seed) {
+        network.SetDefaultLink(link);
+        connections.resize(count);
+        dialled.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            nodes.push_back(network.CreateTransport());
+            nodes[i]->Listen(Endpoint(i));
+            nodes[i]->SetConnectionHandler([this, i](ConnectionId connection, bool connected) {
+                if (connected) {
+                    connections[i].push_back(connection);
+                }
+            });
+        }
+    }
+
+    void Connect(size_t from, size_t to) {
+        auto connection = nodes[from]->Connect(Endpoint(to));
+        ASSERT_NE(connection, Transport::kNoConnection);
+        connections[from].push_back(connection);
+        dialled[from].push_back({ connection, to });
+    }
+
+    // Each node dials `degree` others picked at random
+    void ConnectRandomly(size_t degree, uint64_t seed) {
+        std::mt19937_64 random(seed);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            for (size_t d = 0; d < degree; ++d) {
+                size_t j = random() % (nodes.size() - 1);
+                Connect(i, j >= i ? j + 1 : j);
+            }
+        }
+        network.RunUntilIdle();
+    }
+};
+
+struct GossipResult {
+    size_t reached = 0;
+    Duration convergence{0};
+    uint64_t frames = 0;
+
+    bool operator==(const GossipResult&) const = default;
+};
+
+// Floods one rumour from node 0: each node forwards it on every other
+// connection the first time it hears it
+GossipResult RunGossip(size_t count, size_t degree, uint64_t seed) {
+    Topology topology(count, seed, { 5ms, 1e6, 0.01 });
+    topology.ConnectRandomly(degree, seed);
+
+    auto rumour = Frame(Message::CreateTextMessage("rumour"));
+    std::vector<char> seen(count, 0);
+    GossipResult result;
+    Duration start = topology.network.Now();
+    uint64_t framesBefore = topology.network.GetStats().framesSent;
+
+    auto forward = [&](size_t node, ConnectionId except) {
+        for (auto connection : topology.connections[node]) {
+            if (connection != except) {
+                topology.nodes[node]->Send(connection, rumour);
+            }
+        }
+    };
+    for (size_t i = 0; i < count; ++i) {
+        topology.nodes[i]->SetFrameHandler([&, i](ConnectionId connection, std::span<const uint8_t> frame) {
+            auto header = Message::PeekHeader(frame.data(), frame.size());
+            if (!header || header->type != MessageType::TEXT || seen[i]) {
+                return;
+            }
+            seen[i] = 1;
+            ++result.reached;
+            result.convergence = topology.network.Now() - start;
+            forward(i, connection);
+        });
+    }
+
+    seen[0] = 1;
+    result.reached = 1;
+    forward(0, Transport::kNoConnection);
+    topology.network.RunUntilIdle();
+    result.frames = topology.network.GetStats().framesSent - framesBefore;
+    return result;
+}
+
+} // namespace
+
+TEST(SimulatedNetworkTest, LatencyAndBandwidthShapeDelivery) {
+    SimulatedNetwork network;
+    network.SetDefaultLink({ 10ms, 1000.0, 0.0 });
+    auto server = network.CreateTransport();
+    auto client = network.CreateTransport();
+    server->Listen("sim://server");
+
+    std::vector<std::pair<Duration, uint8_t>> arrivals;
+    server->SetFrameHandler([&](ConnectionId, std::span<const uint8_t> frame) {
+        arrivals.emplace_back(network.Now(), frame[0]);
+    });
+
+    auto connection = client->Connect("sim://server");
+    ASSERT_NE(connection, Transport::kNoConnection);
+    EXPECT_TRUE(client->Send(connection, std::vector<uint8_t>(100, 1)));
+    EXPECT_TRUE(client->Send(connection, std::vector<uint8_t>(100, 2)));
+    network.RunUntilIdle();
+
+    // 100 bytes at 1000 B/s take 100 ms each to send, queued behind each other
+    ASSERT_EQ(arrivals.size(), 2u);
+    EXPECT_EQ(arrivals[0], std::make_pair(Duration(110ms), uint8_t{1}));
+    EXPECT_EQ(arrivals[1], std::make_pair(Duration(210ms), uint8_t{2}));
+    EXPECT_EQ(network.GetStats().bytesSent, 200u);
+
+    EXPECT_EQ(client->Connect("sim://nowhere"), Transport::kNoConnection);
+}
+
+TEST(SimulatedNetworkTest, RepliesCloseAndTimers) {
+    SimulatedNetwork network;
+    auto server = network.CreateTransport();
+    auto client = network.CreateTransport();
+    server->Listen("sim://server");
+
+    // The built-in heartbeat shape: answer each PING with a PONG
+    std::vector<std::pair<ConnectionId, bool>> serverEvents;
+    server->SetConnectionHandler([&](ConnectionId connection, bool connected) {
+        serverEvents.emplace_back(connection, connected);
+    });
+    server->SetFrameHandler([&](ConnectionId connection, std::span<const uint8_t>) {
+        server->Send(connection, Frame(Message::CreatePongMessage()));
+    });
+    int pongs = 0;
+    bool clientSawClose = false;
+    client->SetFrameHandler([&](ConnectionId, std::span<const uint8_t>) { ++pongs; });
+    client->SetConnectionHandler([&](ConnectionId, bool connected) { clientSawClose = !connected; });
+
+    auto connection = client->Connect("sim://server");
+    network.Schedule(5ms, [&]() { client->Send(connection, Frame(Message::CreatePingMessage())); });
+    network.RunFor(3ms);
+    EXPECT_EQ(pongs, 0);
+    EXPECT_EQ(network.Now(), Duration(3ms));
+
+    // Sent at 5 ms, a millisecond each way
+    network.RunFor(4ms);
+    EXPECT_EQ(pongs, 1);
+
+    server->Close(serverEvents.at(0).first);
+    network.RunUntilIdle();
+    EXPECT_TRUE(clientSawClose);
+    EXPECT_FALSE(client->Send(connection, Frame(Message::CreatePingMessage())));
+    EXPECT_EQ(serverEvents, (std::vector<std::pair<ConnectionId, bool>>{ { 0, true } }));
+}
+
+TEST(SimulatedNetworkTest, LossAndIsolationAreDeterministic) {
+    auto run = [](uint64_t seed) {
+        SimulatedNetwork network(seed);
+        network.SetDefaultLink({ 1ms, 0.0, 0.3 });
+        auto server = network.CreateTransport();
+        auto client = network.CreateTransport();
+        server->Listen("sim://server");
+        int received = 0;
+        server->SetFrameHandler([&](ConnectionId, std::span<const uint8_t>) { ++received; });
+
+        auto connection = client->Connect("sim://server");
+        for (int i = 0; i < 1000; ++i) {
+            client->Send(connection, std::vector<uint8_t>{ 1 });
+        }
+        network.RunUntilIdle();
+
+        // Nothing gets through to an isolated node, loss or not
+        network.SetIsolated(*server, true);
+        client->Send(connection, std::vector<uint8_t>{ 1 });
+        network.RunUntilIdle();
+        EXPECT_EQ(network.GetStats().framesLost, static_cast<uint64_t>(1001 - received));
+        return received;
+    };
+
+    int first = run(7);
+    EXPECT_EQ(run(7), first);
+    EXPECT_NEAR(first, 700, 60);
+    EXPECT_NE(run(8), first);
+}
+
+TEST(SimulatedNetworkTest, GossipAcrossTenThousandNodes) {
+    constexpr size_t kNodes = 10000;
+    constexpr size_t kDegree = 4;
+
+    auto result = RunGossip(kNodes, kDegree, 42);
+    std::printf("Gossip over %zu nodes: converged in %.1f ms virtual, %.2f frames per node\n",
+                kNodes, result.convergence.count() / 1000.0,
+                static_cast<double>(result.frames) / kNodes);
+
+    // 1% loss, but every node hears it over some path
+    EXPECT_EQ(result.reached, kNodes);
+    // Flooding sends the rumour once down each connection, less the way it came
+    EXPECT_LE(result.frames, kNodes * kDegree * 2);
+    EXPECT_EQ(RunGossip(kNodes, kDegree, 42), result);
+}
+
+TEST(SimulatedNetworkTest, DiscoveryFillsPeerTables) {
+    constexpr size_t kNodes = 10000;
+    constexpr size_t kTargetPeers = 8;
+    constexpr size_t kMaxKnown = 32;
+
+    // Each node starts knowing only the node that bootstrapped it. Both ends
+    // of a new connection send what they know, as a handshake would, and
+    // every second each node sends it to one neighbour picked at random. A
+    // node dials what it learns until it has dialled kTargetPeers peers.
+    Topology topology(kNodes, 3, { 20ms, 0.0, 0.0 });
+    std::mt19937_64 random(3);
+    std::vector<std::unordered_set<size_t>> known(kNodes);
+
+    auto peerList = [&](size_t node) {
+        std::vector<std::string> peers = { Endpoint(node) };
+        for (auto peer : known[node]) {
+            peers.push_back(Endpoint(peer));
+        }
+        return Frame(Message::CreatePeerListMessage(peers));
+    };
+    auto learn = [&](size_t node, size_t peer) {
+        if (peer == node || known[node].size() >= kMaxKnown || !known[node].insert(peer).second) {
+            return;
+        }
+        if (topology.dialled[node].size() < kTargetPeers) {
+            topology.Connect(node, peer);
+            topology.nodes[node]->Send(topology.dialled[node].back().connection, peerList(node));
+        }
+    };
+
+    for (size_t i = 0; i < kNodes; ++i) {
+        topology.nodes[i]->SetConnectionHandler([&, i](ConnectionId connection, bool connected) {
+            if (connected) {
+                topology.connections[i].push_back(connection);
+                topology.nodes[i]->Send(connection, peerList(i));
+            }
+        });
+        topology.nodes[i]->SetFrameHandler([&, i](ConnectionId, std::span<const uint8_t> frame) {
+            auto header = Message::PeekHeader(frame.data(), frame.size());
+            if (!header || header->type != MessageType::PEER_LIST) {
+                return;
+            }
+            auto list = schema::PeerList::Parse(frame.subspan(Message::kHeaderSize));
+            if (!list) {
+                return;
+            }
+            for (auto endpoint : list->Get<schema::PeerList::kPeers>()) {
+                learn(i, std::stoul(std::string(endpoint.substr(std::string_view("sim://node-").size()))));
+            }
+        });
+    }
+    for (size_t i = 1; i < kNodes; ++i) {
+        learn(i, random() % i);
+    }
+
+    auto converged = [&]() {
+        for (size_t i = 0; i < kNodes; ++i) {
+            if (known[i].size() < kTargetPeers) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Checked every 100 ms, gossiped every second
+    Duration elapsed{0};
+    while (!converged() && elapsed < 60s) {
+        if (elapsed % 1s == Duration(0)) {
+            for (size_t i = 0; i < kNodes; ++i) {
+                const auto& connections = topology.connections[i];
+                if (!connections.empty()) {
+                    topology.nodes[i]->Send(connections[random() % connections.size()], peerList(i));
+                }
+            }
+        }
+        topology.network.RunFor(100ms);
+        elapsed += 100ms;
+    }
+
+    std::printf("Discovery over %zu nodes: %zu peers each within %lld ms virtual, %.1f frames per node\n",
+                kNodes, kTargetPeers, static_cast<long long>(elapsed.count() / 1000),
+                static_cast<double>(topology.network.GetStats().framesSent) / kNodes);
+    EXPECT_TRUE(converged());
+}
+
+TEST(SimulatedNetworkTest, HeartbeatsDetectSilentFailures) {
+    constexpr size_t kNodes = 10000;
+    constexpr size_t kFailed = 100;
+    constexpr int kMissedBeats = 3;
+
+    constexpr size_t kDegree = 4;
+
+    Topology topology(kNodes, 11, { 10ms, 0.0, 0.0 });
+    topology.ConnectRandomly(kDegree, 11);
+
+    // Each node pings the peers it dialled every second and declares one dead
+    // once it's missed kMissedBeats pongs in a row
+    std::vector<std::vector<int>> missed(kNodes, std::vector<int>(kDegree, 0));
+    std::vector<std::vector<char>> dead(kNodes, std::vector<char>(kDegree, 0));
+    for (size_t i = 0; i < kNodes; ++i) {
+        topology.nodes[i]->SetFrameHandler([&, i](ConnectionId connection, std::span<const uint8_t> frame) {
+            auto header = Message::PeekHeader(frame.data(), frame.size());
+            if (header && header->type == MessageType::PING) {
+                topology.nodes[i]->Send(connection, Frame(Message::CreatePongMessage()));
+                return;
+            }
+            for (size_t d = 0; d < kDegree; ++d) {
+                if (header && header->type == MessageType::PONG && topology.dialled[i][d].connection == connection) {
+                    missed[i][d] = 0;
+                }
+            }
+        });
+    }
+
+    std::vector<size_t> failed;
+    for (size_t i = 0; i < kFailed; ++i) {
+        failed.push_back(i * (kNodes / kFailed));
+    }
+    size_t expectedDetections = 0;
+    size_t detections = 0;
+    size_t falseDetections = 0;
+    Duration lastDetection{0};
+    auto ping = Frame(Message::CreatePingMessage());
+
+    Duration failureTime = 5s;
+    for (Duration t{0}; t < 15s; t += 1s) {
+        if (t == failureTime) {
+            for (auto node : failed) {
+                topology.network.SetIsolated(*topology.nodes[node], true);
+            }
+        }
+        for (size_t i = 0; i < kNodes; ++i) {
+            for (size_t d = 0; d < kDegree; ++d) {
+                if (!dead[i][d] && ++missed[i][d] > kMissedBeats) {
+                    dead[i][d] = 1;
+                    ++detections;
+                    lastDetection = topology.network.Now();
+                }
+                if (!dead[i][d]) {
+                    topology.nodes[i]->Send(topology.dialled[i][d].connection, ping);
+                }
+            }
+        }
+        topology.network.RunFor(1s);
+    }
+
+    // Every link touching a failed node should be declared dead, and no other
+    std::unordered_set<size_t> failedSet(failed.begin(), failed.end());
+    for (size_t i = 0; i < kNodes; ++i) {
+        for (size_t d = 0; d < kDegree; ++d) {
+            bool touchesFailure = failedSet.count(i) || failedSet.count(topology.dialled[i][d].peer);
+            expectedDetections += touchesFailure;
+            falseDetections += dead[i][d] && !touchesFailure;
+        }
+    }
+
+    std::printf("Heartbeats over %zu nodes: %zu links declared dead, last %.1f s after the failure, %llu frames\n",
+                kNodes, detections, (lastDetection - failureTime).count() / 1e6,
+                static_cast<unsigned long long>(topology.network.GetStats().framesSent));
+    EXPECT_EQ(detections, expectedDetections);
+    EXPECT_EQ(falseDetections, 0u);
+}
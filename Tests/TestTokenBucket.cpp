@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include "TokenBucket.hpp"
+
+using namespace p2p;
+using namespace std::chrono_literals;
+
+TEST(TokenBucketTest, StartsFullAndRefillsAtRate) {
+    TokenBucket bucket(10.0, 5.0);
+    auto now = TokenBucket::Clock::now();
+
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(bucket.TryTake(now));
+    }
+    EXPECT_FALSE(bucket.TryTake(now));
+
+    // 10 per second: one token back every 100 ms
+    EXPECT_TRUE(bucket.TryTake(now + 100ms));
+    EXPECT_FALSE(bucket.TryTake(now + 100ms));
+
+    // Refill stops at the burst size
+    auto later = now + 10s;
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(bucket.TryTake(later));
+    }
+    EXPECT_FALSE(bucket.TryTake(later));
+}
+
+TEST(TokenBucketTest, ZeroRateIsUnlimited) {
+    TokenBucket bucket;
+    EXPECT_TRUE(bucket.IsUnlimited());
+
+    auto now = TokenBucket::Clock::now();
+    for (int i = 0; i < 100000; ++i) {
+        ASSERT_TRUE(bucket.TryTake(now));
+    }
+}
+
+TEST(TokenBucketTest, WeightedTakesAndClockSkew) {
+    TokenBucket bucket(100.0, 10.0);
+    auto now = TokenBucket::Clock::now();
+
+    EXPECT_FALSE(bucket.TryTake(now, 11.0));
+    EXPECT_TRUE(bucket.TryTake(now, 7.5));
+    EXPECT_FALSE(bucket.TryTake(now, 3.0));
+
+    // A time earlier than the last refill adds nothing
+    EXPECT_TRUE(bucket.TryTake(now - 1s, 2.5));
+    EXPECT_FALSE(bucket.TryTake(now - 1s));
+    EXPECT_TRUE(bucket.TryTake(now + 10ms));
+}
+
+TEST(TokenBucketTest, TakeUpToHandsOutWhatIsLeft) {
+    TokenBucket bucket(10.0, 20.0);
+    auto now = TokenBucket::Clock::now();
+
+    EXPECT_DOUBLE_EQ(bucket.TakeUpTo(now, 16.0), 16.0);
+    EXPECT_DOUBLE_EQ(bucket.TakeUpTo(now, 16.0), 4.0);
+    EXPECT_DOUBLE_EQ(bucket.TakeUpTo(now, 16.0), 0.0);
+    EXPECT_NEAR(bucket.TakeUpTo(now + 500ms, 16.0), 5.0, 1e-9);
+
+    TokenBucket unlimited;
+    EXPECT_DOUBLE_EQ(unlimited.TakeUpTo(now, 16.0), 16.0);
+}
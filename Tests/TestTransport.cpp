@@ -0,0 +1,652 @@
+#include <gtest/gtest.h>
+#include "AsioTransport.hpp"
+#include "SimulatedNetwork.hpp"
+#include "Network.hpp"
+#include "Message.hpp"
+#include "PeerManager.hpp"
+#include "Crypto.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace p2p;
+using namespace std::chrono_literals;
+
+namespace {
+
+template <class Predicate>
+bool WaitFor(Predicate done, std::chrono::milliseconds timeout = 5000ms) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+// What a transport hands its handlers, from whichever thread it calls them on
+struct Recorder {
+    std::mutex mutex;
+    std::vector<std::pair<Transport::ConnectionId, std::vector<uint8_t>>> frames;
+    std::vector<std::pair<Transport::ConnectionId, bool>> connections;
+
+    Transport& transport;
+
+    explicit Recorder(Transport& transport) : transport(transport) {
+        transport.SetFrameHandler([this](Transport::ConnectionId connection, std::span<const uint8_t> frame) {
+            std::lock_guard<std::mutex> lock(mutex);
+            frames.emplace_back(connection, std::vector<uint8_t>(frame.begin(), frame.end()));
+        });
+        transport.SetConnectionHandler([this](Transport::ConnectionId connection, bool connected) {
+            std::lock_guard<std::mutex> lock(mutex);
+            connections.emplace_back(connection, connected);
+        });
+    }
+
+    // Declared after the transport, so it goes first; once stopped, nothing calls back into it
+    ~Recorder() { transport.Stop(); }
+
+    size_t FrameCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return frames.size();
+    }
+
+    size_t ConnectionCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return connections.size();
+    }
+};
+
+std::vector<uint8_t> NumberedFrame(uint32_t number, size_t size) {
+    std::vector<uint8_t> frame(size, static_cast<uint8_t>(number));
+    for (size_t i = 0; i < 4 && i < size; ++i) {
+        frame[i] = static_cast<uint8_t>(number >> (8 * i));
+    }
+    return frame;
+}
+
+// Sends frames of every size up to a megabyte each way, and checks they
+// arrive whole and in order
+void ExpectFramesRoundTrip(Transport& server, Recorder& serverLog, Transport& client, Recorder& clientLog,
+                           Transport::ConnectionId connection) {
+    constexpr uint32_t kFrames = 500;
+    for (uint32_t i = 0; i < kFrames; ++i) {
+        auto frame = NumberedFrame(i, i == kFrames - 1 ? 1024 * 1024 : (i * 37) % 3000);
+        ASSERT_TRUE(client.Send(connection, frame));
+    }
+    ASSERT_TRUE(WaitFor([&]() { return serverLog.FrameCount() == kFrames; }));
+    {
+        std::lock_guard<std::mutex> lock(serverLog.mutex);
+        ASSERT_EQ(serverLog.connections.size(), 1u);
+        EXPECT_TRUE(serverLog.connections[0].second);
+        for (uint32_t i = 0; i < kFrames; ++i) {
+            EXPECT_EQ(serverLog.frames[i].first, serverLog.connections[0].first);
+            EXPECT_EQ(serverLog.frames[i].second, NumberedFrame(i, i == kFrames - 1 ? 1024 * 1024 : (i * 37) % 3000));
+        }
+    }
+
+    auto incoming = serverLog.connections[0].first;
+    ASSERT_TRUE(server.Send(incoming, NumberedFrame(7, 100)));
+    ASSERT_TRUE(WaitFor([&]() { return clientLog.FrameCount() == 1; }));
+    std::lock_guard<std::mutex> lock(clientLog.mutex);
+    EXPECT_EQ(clientLog.frames[0].first, connection);
+    EXPECT_EQ(clientLog.frames[0].second, NumberedFrame(7, 100));
+}
+
+// A peer with an identity of its own, over the given transport or, without
+// one, the built-in ZMQ reactors
+struct Node {
+    PeerManager peers;
+    NetworkManager network{peers};
+    std::atomic<int> received{0};
+
+    Node(CryptoManager& crypto, uint16_t port, std::unique_ptr<Transport> transport) {
+        auto keys = crypto.GenerateKeyPair();
+        PeerInfo local;
+        local.id = crypto.GeneratePeerId(keys.publicKey);
+        local.publicKey = keys.publicKey;
+        local.endpoint = Endpoint(port);
+        local.isConnected = true;
+        peers.SetLocalPeer(local);
+
+        NetworkManager::RateLimits unlimited;
+        unlimited.peerMessageRate = 0.0;
+        unlimited.globalMessageRate = 0.0;
+        network.SetRateLimits(unlimited);
+        network.SetIdentity(crypto, keys.privateKey);
+        if (transport) {
+            network.SetTransport(std::move(transport));
+        }
+        network.On<MessageType::TEXT>([this](PeerHandle, const p2p::Message&) { ++received; });
+    }
+};
+
+// Runs a simulated network's clock on a thread of its own, a millisecond of
+// virtual time per turn, for nodes whose worker threads send into it
+class Pump {
+public:
+    explicit Pump(SimulatedNetwork& network)
+        : thread_([this, &network]() {
+              while (!stop_) {
+                  network.RunFor(1ms);
+                  std::this_thread::yield();
+              }
+          }) {}
+
+    ~Pump() {
+        stop_ = true;
+        thread_.join();
+    }
+
+private:
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+// Connects the sender to the receiver's endpoint, authenticates both ways,
+// and exchanges a message each way
+void ExpectPeersAuthenticate(Node& a, Node& b, const std::string& endpoint) {
+    b.network.ConnectToPeer(endpoint);
+    ASSERT_TRUE(WaitFor([&]() {
+        return a.network.GetConnectedPeers().size() == 1 && b.network.GetConnectedPeers().size() == 1;
+    }));
+    EXPECT_EQ(a.peers.GetPeerId(a.network.GetConnectedPeers()[0]), b.peers.GetLocalPeer().id);
+    EXPECT_EQ(b.peers.GetPeerId(b.network.GetConnectedPeers()[0]), a.peers.GetLocalPeer().id);
+
+    b.network.SendMessage(endpoint, p2p::Message::CreateTextMessage("to a"));
+    a.network.BroadcastMessage(p2p::Message::CreateTextMessage("to b"));
+    EXPECT_TRUE(WaitFor([&]() { return a.received == 1 && b.received == 1; }));
+    EXPECT_EQ(a.network.GetRejectedHandshakeCount(), 0u);
+}
+
+// Sends `count` messages with at most a window of them unacknowledged, so
+// the result reflects the backend rather than queue drops; messages per second
+double MeasureThroughput(Node& sender, uint16_t senderPort, Node& receiver, uint16_t port,
+                         const std::string& endpoint, int count, size_t size) {
+    receiver.network.Start(port);
+    sender.network.Start(senderPort);
+    sender.network.ConnectToPeer(endpoint);
+    WaitFor([&]() { return receiver.network.GetConnectedPeers().size() == 1; });
+
+    constexpr int kWindow = 256;
+    auto message = p2p::Message::CreateTextMessage(std::string(size, 'b'));
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + 20s;
+    for (int i = 0; i < count && std::chrono::steady_clock::now() < deadline; ++i) {
+        while (i - receiver.received >= kWindow && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        sender.network.SendMessage(endpoint, message);
+    }
+    WaitFor([&]() { return receiver.received >= count; }, 20s);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    sender.network.Stop();
+    receiver.network.Stop();
+    EXPECT_EQ(receiver.received, count);
+    return receiver.received / elapsed;
+}
+
+// Wraps a transport and runs the connection handler from inside Connect()
+// and Close(), as a backend that reports on the caller's thread might. What
+// it reports is a connection that never opened, which the network ignores.
+class InlineReportingTransport : public Transport {
+public:
+    explicit InlineReportingTransport(std::unique_ptr<Transport> inner) : inner_(std::move(inner)) {
+        inner_->SetFrameHandler([this](ConnectionId connection, std::span<const uint8_t> frame) {
+            frameHandler_(connection, frame);
+        });
+        inner_->SetConnectionHandler([this](ConnectionId connection, bool connected) {
+            connectionHandler_(connection, connected);
+        });
+    }
+
+    void Listen(const std::string& endpoint) override {
+        inner_->SetMaxFrameSize(GetMaxFrameSize());
+        inner_->Listen(endpoint);
+    }
+    ConnectionId Connect(const std::string& endpoint) override {
+        auto connection = inner_->Connect(endpoint);
+        Report();
+        return connection;
+    }
+    bool Send(ConnectionId connection, std::span<const uint8_t> frame) override { return inner_->Send(connection, frame); }
+    void Close(ConnectionId connection) override {
+        inner_->Close(connection);
+        Report();
+    }
+    void Stop() override { inner_->Stop(); }
+
+    std::atomic<int> reports{0};
+
+private:
+    void Report() {
+        connectionHandler_(kNoConnection - 1, false);
+        ++reports;
+    }
+
+    std::unique_ptr<Transport> inner_;
+};
+
+// Wraps a transport and runs a hook once it listens on the given endpoint,
+// before Listen() returns, for a backend whose threads deliver frames as soon
+// as the socket is bound
+class ListenHookTransport : public Transport {
+public:
+    ListenHookTransport(std::unique_ptr<Transport> inner, std::string endpoint, std::function<void()> hook)
+        : inner_(std::move(inner)), endpoint_(std::move(endpoint)), hook_(std::move(hook)) {
+        inner_->SetFrameHandler([this](ConnectionId connection, std::span<const uint8_t> frame) {
+            frameHandler_(connection, frame);
+        });
+        inner_->SetConnectionHandler([this](ConnectionId connection, bool connected) {
+            connectionHandler_(connection, connected);
+        });
+    }
+
+    void Listen(const std::string& endpoint) override {
+        inner_->SetMaxFrameSize(GetMaxFrameSize());
+        inner_->Listen(endpoint);
+        if (endpoint == endpoint_) {
+            hook_();
+        }
+    }
+    ConnectionId Connect(const std::string& endpoint) override { return inner_->Connect(endpoint); }
+    bool Send(ConnectionId connection, std::span<const uint8_t> frame) override { return inner_->Send(connection, frame); }
+    void Close(ConnectionId connection) override { inner_->Close(connection); }
+    void Stop() override { inner_->Stop(); }
+
+private:
+    std::unique_ptr<Transport> inner_;
+    std::string endpoint_;
+    std::function<void()> hook_;
+};
+
+} // namespace
+
+TEST(AsioTransportTest, FramesArriveWholeAndInOrder) {
+    AsioTransport server;
+    AsioTransport client;
+    Recorder serverLog(server);
+    Recorder clientLog(client);
+    server.Listen("tcp://127.0.0.1:0");
+    ASSERT_NE(server.GetListenPort(), 0);
+
+    auto connection = client.Connect("tcp://127.0.0.1:" + std::to_string(server.GetListenPort()));
+    ASSERT_NE(connection, Transport::kNoConnection);
+    ExpectFramesRoundTrip(server, serverLog, client, clientLog, connection);
+
+    // Closing our end tells the other side, but not us
+    client.Close(connection);
+    EXPECT_FALSE(client.Send(connection, NumberedFrame(1, 10)));
+    ASSERT_TRUE(WaitFor([&]() { return serverLog.ConnectionCount() == 2; }));
+    std::lock_guard<std::mutex> lock(serverLog.mutex);
+    EXPECT_FALSE(serverLog.connections[1].second);
+    EXPECT_EQ(clientLog.ConnectionCount(), 0u);
+}
+
+TEST(AsioTransportTest, OversizedFrameDropsTheConnection) {
+    AsioTransport server;
+    AsioTransport client;
+    Recorder serverLog(server);
+    Recorder clientLog(client);
+    server.SetMaxFrameSize(1024);
+    server.Listen("tcp://127.0.0.1:0");
+
+    auto connection = client.Connect("tcp://127.0.0.1:" + std::to_string(server.GetListenPort()));
+    client.Send(connection, NumberedFrame(1, 1024));
+    client.Send(connection, NumberedFrame(2, 1025));
+
+    // The stream can't be resynchronised past a frame that isn't read, so both ends hear it close
+    ASSERT_TRUE(WaitFor([&]() { return serverLog.ConnectionCount() == 2 && clientLog.ConnectionCount() == 1; }));
+    EXPECT_EQ(serverLog.FrameCount(), 1u);
+    std::lock_guard<std::mutex> lock(clientLog.mutex);
+    EXPECT_EQ(clientLog.connections[0], std::make_pair(connection, false));
+}
+
+TEST(AsioTransportTest, ListensOnIpv4AndIpv6) {
+    {
+        boost::asio::io_context context;
+        boost::asio::ip::tcp::socket probe(context);
+        boost::system::error_code ec;
+        probe.open(boost::asio::ip::tcp::v6(), ec);
+        if (ec) {
+            GTEST_SKIP() << "No IPv6 on this host";
+        }
+    }
+
+    AsioTransport server;
+    AsioTransport client;
+    Recorder serverLog(server);
+    Recorder clientLog(client);
+    server.Listen("tcp://*:0");
+    auto port = std::to_string(server.GetListenPort());
+
+    auto v4 = client.Connect("tcp://127.0.0.1:" + port);
+    auto v6 = client.Connect("tcp://[::1]:" + port);
+    ASSERT_NE(v4, Transport::kNoConnection);
+    ASSERT_NE(v6, Transport::kNoConnection);
+    EXPECT_TRUE(client.Send(v4, NumberedFrame(1, 10)));
+    EXPECT_TRUE(client.Send(v6, NumberedFrame(2, 10)));
+    EXPECT_TRUE(WaitFor([&]() { return serverLog.FrameCount() == 2; }));
+    EXPECT_EQ(serverLog.ConnectionCount(), 2u);
+}
+
+TEST(AsioTransportTest, BadEndpointsFail) {
+    AsioTransport transport;
+    Recorder log(transport);
+    EXPECT_EQ(transport.Connect("127.0.0.1:9000"), Transport::kNoConnection);
+    EXPECT_EQ(transport.Connect("tcp://127.0.0.1"), Transport::kNoConnection);
+    EXPECT_THROW(transport.Listen("ipc:///tmp/nowhere"), std::invalid_argument);
+    EXPECT_FALSE(transport.Send(12345, NumberedFrame(1, 10)));
+
+    // Nobody listening: the connect is reported closed
+    AsioTransport probe;
+    probe.Listen("tcp://127.0.0.1:0");
+    auto port = probe.GetListenPort();
+    probe.Stop();
+    auto connection = transport.Connect("tcp://127.0.0.1:" + std::to_string(port));
+    ASSERT_TRUE(WaitFor([&]() { return log.ConnectionCount() == 1; }));
+    std::lock_guard<std::mutex> lock(log.mutex);
+    EXPECT_EQ(log.connections[0], std::make_pair(connection, false));
+}
+
+TEST(AsioTransportTest, IncomingConnectionsSpreadOverAcceptors) {
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<int> frames{0};
+    AsioTransport server(4);
+    server.SetConnectionHandler([](Transport::ConnectionId, bool) {});
+    server.SetFrameHandler([&](Transport::ConnectionId, std::span<const uint8_t>) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+        ++frames;
+    });
+    server.Listen("tcp://127.0.0.1:0");
+
+    AsioTransport client(1);
+    Recorder clientLog(client);
+    constexpr int kConnections = 64;
+    for (int i = 0; i < kConnections; ++i) {
+        auto connection = client.Connect("tcp://127.0.0.1:" + std::to_string(server.GetListenPort()));
+        ASSERT_TRUE(client.Send(connection, NumberedFrame(i, 16)));
+    }
+    ASSERT_TRUE(WaitFor([&]() { return frames == kConnections; }));
+
+    // Each connection is read on the acceptor thread the kernel gave it to
+    std::lock_guard<std::mutex> lock(mutex);
+    if (AcceptorPool::IsReusePortSupported()) {
+        EXPECT_GT(threads.size(), 1u);
+    } else {
+        EXPECT_EQ(threads.size(), 1u);
+    }
+}
+
+TEST(AsioTransportTest, SendsPastTheQueueCapAreDropped) {
+    // A listener that takes connections and never reads them. The sockets
+    // go before the pool whose io_context they're on.
+    AcceptorPool server(1);
+    std::mutex mutex;
+    std::vector<boost::asio::ip::tcp::socket> stalled;
+    server.Start(0, [&](boost::asio::ip::tcp::socket socket) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stalled.push_back(std::move(socket));
+    });
+
+    AsioTransport client(1);
+    Recorder clientLog(client);
+    client.SetMaxQueuedBytes(1024 * 1024);
+    auto connection = client.Connect("tcp://127.0.0.1:" + std::to_string(server.GetPort()));
+
+    // The socket buffers take some, then the queue fills and stays full
+    auto frame = NumberedFrame(1, 64 * 1024);
+    int sent = 0;
+    ASSERT_TRUE(WaitFor([&]() {
+        if (!client.Send(connection, frame)) {
+            return true;
+        }
+        ++sent;
+        return false;
+    }, 10000ms));
+    EXPECT_GT(sent, 0);
+    EXPECT_FALSE(client.Send(connection, frame));
+    EXPECT_EQ(clientLog.ConnectionCount(), 0u);
+
+    client.Stop();
+    server.Stop();
+}
+
+TEST(TransportNetworkTest, PeersAuthenticateOverSimulatedNetwork) {
+    CryptoManager crypto;
+    SimulatedNetwork network;
+    Node a(crypto, 9000, network.CreateTransport());
+    Node b(crypto, 9001, network.CreateTransport());
+    a.network.AddListenEndpoint("sim://a");
+    a.network.Start(9000);
+    b.network.Start(9001);
+    Pump pump(network);
+
+    ExpectPeersAuthenticate(a, b, "sim://a");
+    EXPECT_GT(network.GetStats().framesDelivered, 4u);
+}
+
+TEST(TransportNetworkTest, LostConnectionDropsThePeer) {
+    CryptoManager crypto;
+    SimulatedNetwork network;
+    Node a(crypto, 9000, network.CreateTransport());
+    Node b(crypto, 9001, network.CreateTransport());
+    std::atomic<int> disconnects{0};
+    a.network.SetConnectionHandler([&](PeerHandle, bool connected) {
+        if (!connected) ++disconnects;
+    });
+    a.network.AddListenEndpoint("sim://a");
+    a.network.Start(9000);
+    b.network.Start(9001);
+    Pump pump(network);
+
+    ExpectPeersAuthenticate(a, b, "sim://a");
+    b.network.Stop();
+    EXPECT_TRUE(WaitFor([&]() { return disconnects == 1; }));
+    EXPECT_TRUE(a.network.GetConnectedPeers().empty());
+}
+
+TEST(TransportNetworkTest, PeersDialledByNameKeepTheName) {
+    CryptoManager crypto;
+    SimulatedNetwork network;
+    Node a(crypto, 9000, network.CreateTransport());
+    Node b(crypto, 9001, network.CreateTransport());
+    a.network.AddListenEndpoint("tcp://node-a.example:9000");
+    a.network.Start(9000);
+    b.network.Start(9001);
+    Pump pump(network);
+
+    // The transport resolves the name, so only the name is known
+    b.network.ConnectToPeer("node-a.example", 9000);
+    ASSERT_TRUE(WaitFor([&]() { return b.network.GetConnectedPeers().size() == 1; }));
+    auto peer = b.peers.GetPeer(a.peers.GetLocalPeer().id);
+    ASSERT_TRUE(peer.has_value());
+    EXPECT_EQ(peer->host, "node-a.example");
+    EXPECT_EQ(peer->endpoint, Endpoint(9000));
+
+    b.peers.SavePeersToFile("named_peers.txt");
+    PeerManager reloaded;
+    reloaded.LoadPeersFromFile("named_peers.txt");
+    std::remove("named_peers.txt");
+    peer = reloaded.GetPeer(a.peers.GetLocalPeer().id);
+    ASSERT_TRUE(peer.has_value());
+    EXPECT_EQ(peer->host, "node-a.example");
+    EXPECT_EQ(peer->endpoint.GetPort(), 9000);
+}
+
+TEST(TransportNetworkTest, RelayFramesNeedAHandshakenPeer) {
+    CryptoManager crypto;
+    SimulatedNetwork network;
+    Node a(crypto, 9000, network.CreateTransport());
+    a.network.AddListenEndpoint("sim://a");
+    a.network.Start(9000);
+
+    // A bare connection that never handshakes, claiming to relay from a made-up peer
+    auto stranger = network.CreateTransport();
+    Recorder strangerLog(*stranger);
+    auto connection = stranger->Connect("sim://a");
+    ASSERT_NE(connection, Transport::kNoConnection);
+    const std::string forged = "0123456789abcdef";
+    auto relay = p2p::Message::CreateRelayMessage(forged, a.peers.GetLocalPeer().id,
+                                                  p2p::Message::CreateTextMessage("injected")).Serialize();
+    ASSERT_TRUE(stranger->Send(connection, relay));
+    network.RunUntilIdle();
+    std::this_thread::sleep_for(100ms);
+
+    EXPECT_GE(network.GetStats().framesDelivered, 1u);
+    EXPECT_EQ(a.received, 0);
+    EXPECT_FALSE(a.peers.FindPeerHandle(forged));
+}
+
+// Three nodes on a simulated network: C reaches A both directly and through
+// B, which relays. A notes who each text came from.
+struct RelayTriangle {
+    CryptoManager crypto;
+    SimulatedNetwork network;
+    Node a{crypto, 9000, network.CreateTransport()};
+    Node b{crypto, 9001, network.CreateTransport()};
+    Node c{crypto, 9002, network.CreateTransport()};
+    std::mutex mutex;
+    std::vector<std::string> senders;
+
+    RelayTriangle() {
+        a.network.On<MessageType::TEXT>([this](PeerHandle sender, const p2p::Message&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            senders.push_back(a.peers.GetPeerId(sender));
+        });
+        a.network.AddListenEndpoint("sim://a");
+        b.network.AddListenEndpoint("sim://b");
+        b.network.SetRelayEnabled(true);
+        a.network.Start(9000);
+        b.network.Start(9001);
+        c.network.Start(9002);
+    }
+
+    std::vector<std::string> Senders() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return senders;
+    }
+};
+
+TEST(TransportNetworkTest, RelayedFramesNeedTheSourcesSignature) {
+    RelayTriangle nodes;
+    Pump pump(nodes.network);
+    nodes.b.network.ConnectToPeer("sim://a");
+    nodes.c.network.ConnectToPeer("sim://a");
+    nodes.c.network.ConnectToPeer("sim://b");
+    ASSERT_TRUE(WaitFor([&]() {
+        return nodes.a.network.GetConnectedPeers().size() == 2 && nodes.c.network.GetConnectedPeers().size() == 2;
+    }));
+    const auto& aId = nodes.a.peers.GetLocalPeer().id;
+    const auto& bId = nodes.b.peers.GetLocalPeer().id;
+    const auto& cId = nodes.c.peers.GetLocalPeer().id;
+
+    // B is a direct peer of A's and claims a frame it made up comes from C
+    nodes.b.network.SendMessage(aId, p2p::Message::CreateRelayMessage(cId, aId,
+                                                                     p2p::Message::CreateTextMessage("forged")));
+    ASSERT_TRUE(WaitFor([&]() { return nodes.Senders().size() == 1; }));
+    EXPECT_EQ(nodes.Senders()[0], cId + "@" + bId);
+
+    // C signs for B, so what B relays for it is C's
+    nodes.c.network.SendViaRelay(bId, aId, p2p::Message::CreateTextMessage("relayed"));
+    ASSERT_TRUE(WaitFor([&]() { return nodes.Senders().size() == 2; }));
+    EXPECT_EQ(nodes.Senders()[1], cId);
+    EXPECT_EQ(nodes.b.network.GetRelayedMessageCount(), 1u);
+}
+
+TEST(TransportNetworkTest, TransportMayCallBackFromConnectAndClose) {
+    CryptoManager crypto;
+    SimulatedNetwork network;
+    auto transport = std::make_unique<InlineReportingTransport>(network.CreateTransport());
+    auto& reporting = *transport;
+    Node a(crypto, 9000, network.CreateTransport());
+    Node b(crypto, 9001, std::move(transport));
+    a.network.AddListenEndpoint("sim://a");
+    a.network.Start(9000);
+    b.network.Start(9001);
+    Pump pump(network);
+
+    ExpectPeersAuthenticate(a, b, "sim://a");
+    EXPECT_EQ(reporting.reports, 1);
+
+    b.network.DisconnectPeer(b.network.GetConnectedPeers()[0]);
+    EXPECT_EQ(reporting.reports, 2);
+    EXPECT_TRUE(b.network.GetConnectedPeers().empty());
+}
+
+TEST(TransportNetworkTest, HandshakesArrivingDuringStartAreHandled) {
+    CryptoManager crypto;
+    SimulatedNetwork network;
+    Node b(crypto, 9001, network.CreateTransport());
+    b.network.Start(9001);
+
+    // B's challenge reaches A from inside A's Listen(), before Start() returns
+    auto transport = std::make_unique<ListenHookTransport>(network.CreateTransport(), "sim://a", [&]() {
+        b.network.ConnectToPeer("sim://a");
+        network.RunUntilIdle();
+    });
+    Node a(crypto, 9000, std::move(transport));
+    a.network.AddListenEndpoint("sim://a");
+    a.network.Start(9000);
+    Pump pump(network);
+
+    EXPECT_TRUE(WaitFor([&]() {
+        return a.network.GetConnectedPeers().size() == 1 && b.network.GetConnectedPeers().size() == 1;
+    }));
+    EXPECT_EQ(a.network.GetRejectedHandshakeCount(), 0u);
+}
+
+TEST(TransportNetworkTest, PeersAuthenticateOverAsio) {
+    CryptoManager crypto;
+    Node a(crypto, 9341, std::make_unique<AsioTransport>());
+    Node b(crypto, 9342, std::make_unique<AsioTransport>());
+    a.network.Start(9341);
+    b.network.Start(9342);
+
+    ExpectPeersAuthenticate(a, b, "tcp://127.0.0.1:9341");
+}
+
+TEST(TransportNetworkTest, BackendThroughputBenchmark) {
+    constexpr int kMessages = 20000;
+    constexpr size_t kSize = 256;
+    CryptoManager crypto;
+
+    Node reactorSender(crypto, 9343, nullptr);
+    Node reactorReceiver(crypto, 9344, nullptr);
+    double reactors = MeasureThroughput(reactorSender, 9343, reactorReceiver, 9344,
+                                        "tcp://127.0.0.1:9344", kMessages, kSize);
+
+    Node asioSender(crypto, 9347, std::make_unique<AsioTransport>());
+    Node asioReceiver(crypto, 9348, std::make_unique<AsioTransport>());
+    double asio = MeasureThroughput(asioSender, 9347, asioReceiver, 9348, "tcp://127.0.0.1:9348", kMessages, kSize);
+
+    // No sockets at all: what the node itself costs per message
+    SimulatedNetwork network;
+    network.SetDefaultLink({ SimulatedNetwork::Duration(0), 0.0, 0.0 });
+    Node simulatedSender(crypto, 9000, network.CreateTransport());
+    Node simulatedReceiver(crypto, 9001, network.CreateTransport());
+    simulatedReceiver.network.AddListenEndpoint("sim://receiver");
+    double simulated;
+    {
+        Pump pump(network);
+        simulated = MeasureThroughput(simulatedSender, 9000, simulatedReceiver, 9001, "sim://receiver",
+                                      kMessages, kSize);
+    }
+
+    std::printf("Throughput, %zu-byte messages: ZMQ reactors %.0f msg/s, AsioTransport %.0f msg/s, simulated %.0f msg/s\n",
+                kSize, reactors, asio, simulated);
+    EXPECT_GT(asio, 0.0);
+    EXPECT_GT(simulated, 0.0);
+}